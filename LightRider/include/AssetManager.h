@@ -12,11 +12,13 @@
 #include "ComputeProgram.h"
 #include "Shape.h"
 #include "Texture.h"
+#include "GeometryArena.h"
+#include "DrawBatch.h"
+#include "DrawList.h"
+#include "CullingBounds.h"
+#include "OcclusionCuller.h"
 
-// Represents the render heirarchy, sorted first by shader, then by texture.
-typedef std::vector<Renderable*> TextureNode;
-typedef std::map<Texture*, TextureNode*> ProgramNode;
-typedef std::map<Program*, ProgramNode*> RenderTree;
+class InstanceCuller;
 
 // Contains data necessary to render a Renderable with blending enabled.
 struct BlendedNode
@@ -24,6 +26,8 @@ struct BlendedNode
     Renderable* pRenderable;
     Program* pShaderProgram;
     Texture* pTexture;
+    DrawPass passes;
+    uint32_t boundsSlot;
 };
 
 // Represents commonly used shader uniforms.
@@ -37,8 +41,10 @@ enum class ShaderUniform : unsigned
     TEXTURE_1 = 16,
     TEXTURE_2 = 32,
     TEXTURE_3 = 64,
-    DEFAULT = 15,
-    ALL = 127,
+    VIEW_UNIFORMS = 128,
+    DRAW_DATA = 256,
+    DEFAULT = 12,
+    ALL = 511,
 };
 
 // Bitwise ORs two shader uniforms together, returning the resulting ShaderUniform.
@@ -63,10 +69,12 @@ public:
     Program* loadShaderProgram(const std::string& id, const std::string& vertexShaderFileName,
         const std::string& fragmentShaderFileName, ShaderUniform defaultUniforms = ShaderUniform::DEFAULT);
 
-    // Loads a shader program from the given vertex and fragment shader file names.
+    // Loads a shader program from the given vertex and fragment shader file names. If a voxelization geometry
+    // shader file name is given, the program gets a ProgramVariant::VOXELIZE variant with that geometry shader.
     // Uniforms will be added according to the specified defaultUniforms argument.
     Program* loadShaderProgram(const std::string& id, const std::string& vertexShaderFileName,
-        const std::vector<std::string>& fragmentShaderFileNames, ShaderUniform defaultUniforms = ShaderUniform::DEFAULT);
+        const std::vector<std::string>& fragmentShaderFileNames, ShaderUniform defaultUniforms = ShaderUniform::DEFAULT,
+        const std::string& voxelizeGeometryShaderFileName = "");
 
     // Loads a compute shader program from the given file name.
     ComputeProgram* loadComputeShaderProgram(const std::string& id, const std::string& fileName);
@@ -75,6 +83,9 @@ public:
     // texture will be used.
     Texture* loadTexture(const std::string& id, const std::string& fileName, TextureType textureType);
 
+    // Creates an empty cubic 3D texture with the given dimension and internal format, to be filled on the GPU.
+    Texture* createVolumeTexture(const std::string& id, int dimension, GLenum internalFormat);
+
     // Loads a shape from the given file name.
     Shape* loadShape(const std::string& id, const std::string& fileName);
 
@@ -90,23 +101,56 @@ public:
     // Returns a loaded shape by ID.
     Shape* getShape(const std::string& id) const { return m_shapes.at(id); }
 
-    // Gets the generated render tree.
-    RenderTree& getRenderTree() { return m_renderTree; }
+    // Returns the arena holding the geometry of every loaded shape.
+    GeometryArena* getGeometryArena() const { return m_pGeometryArena; }
+
+    // Returns the batch used to submit draws of shapes in the geometry arena.
+    DrawBatch* getDrawBatch() const { return m_pDrawBatch; }
+
+    // Gets the sorted list of unblended draws.
+    DrawList& getDrawList() { return m_drawList; }
+
+    // Gets the world-space bounds of every registered Renderable.
+    CullingBounds& getCullingBounds() { return m_cullingBounds; }
+
+    // Gets a number that changes whenever a static Renderable is added to or removed from the draw list.
+    unsigned getStaticRevision() const { return m_staticRevision; }
+
+    // Culls the instances of every registered InstanceCuller against the given frustum, testing them
+    // against the given OcclusionCuller's depth pyramid during the given phase.
+    void cullInstances(const ViewFrustum& frustum, OcclusionCuller* pOcclusionCuller = nullptr, OcclusionPhase phase = OcclusionPhase::NONE);
+
+    // Gets every registered InstanceCuller.
+    const std::vector<InstanceCuller*>& getInstanceCullers() const { return m_instanceCullers; }
 
     // Gets the latest sorted list of blending renderables.
     std::vector<BlendedNode*>& getSortedBlendedRenderables() { return m_sortedBlendedNodes; }
 
-    // Sorts the Renderables 
+    // Sorts the Renderables with blending enabled from back to front relative to the given camera.
+    // The previous order is reused if it was already sorted for the same camera during this tick.
     void sortBlendedRenderables(Camera* pCamera);
 
-    // Registers a renderable, adding it to the render tree.
+    // Registers a renderable, adding it to the draw list.
     void _registerRenderable(Renderable* pRenderable);
     
-    // Unregisters a renderable, removing it from the render tree.
+    // Unregisters a renderable, removing it from the draw list.
     void _unregisterRenderable(Renderable* pRenderable);
 
+    // Registers an InstanceCuller so that it runs for every render pass.
+    void _registerInstanceCuller(InstanceCuller* pInstanceCuller);
+
+    // Unregisters an InstanceCuller.
+    void _unregisterInstanceCuller(InstanceCuller* pInstanceCuller);
+
 private:
 
+    // A blended node paired with a key that sorts it from back to front.
+    struct BlendedSortEntry
+    {
+        uint32_t key;
+        BlendedNode* pNode;
+    };
+
     // Maps shader program IDs to loaded shader programs.
     std::map<std::string, Program*> m_shaderPrograms;
 
@@ -122,20 +166,59 @@ private:
     // The global game configuration.
     GameConfig& m_gameConfig;
 
-    // The render tree generated when Renderables are registered.
-    RenderTree m_renderTree;
+    // The arena holding the geometry of every loaded shape.
+    GeometryArena* m_pGeometryArena;
+
+    // The batch used to submit draws of shapes in the geometry arena.
+    DrawBatch* m_pDrawBatch;
 
-    // A set of Renderables with blending enabled.
-    std::unordered_map<Renderable*, BlendedNode*> m_blendedNodes;
+    // The sorted list of unblended draws, updated when Renderables are registered.
+    DrawList m_drawList;
+
+    // The world-space bounds of every registered Renderable.
+    CullingBounds m_cullingBounds;
+
+    // Changes whenever a static Renderable is added to or removed from the draw list.
+    unsigned m_staticRevision;
+
+    // Maps each registered Renderable to its culling bounds slot.
+    std::unordered_map<Renderable*, uint32_t> m_boundsSlots;
+
+    // The InstanceCullers run for every render pass.
+    std::vector<InstanceCuller*> m_instanceCullers;
+
+    // The nodes of every Renderable with blending enabled, in no particular order.
+    std::vector<BlendedNode*> m_blendedNodes;
+
+    // Maps each Renderable with blending enabled to the index of its node.
+    std::unordered_map<Renderable*, size_t> m_blendedNodeIndices;
+
+    // The blended nodes paired with their depth keys, reused between sorts.
+    std::vector<BlendedSortEntry> m_blendedSortEntries;
+
+    // The scratch buffer used to radix sort the blended nodes.
+    std::vector<BlendedSortEntry> m_blendedSortBuffer;
 
     // A sorted list of Renderables with blending enabled.
     std::vector<BlendedNode*> m_sortedBlendedNodes;
 
+    // The camera the blended nodes were last sorted for.
+    Camera* m_pBlendedSortCamera;
+
+    // The tick during which the blended nodes were last sorted.
+    long m_blendedSortTick;
+
+    // If true, blended nodes have been added since the last sort.
+    bool m_areBlendedNodesDirty;
+
+    // Creates and initializes a shader program from the given shader file names, returning nullptr on failure.
+    Program* createShaderProgram(const std::string& vertexShaderFileName, const std::vector<std::string>& fragmentShaderFileNames,
+        ShaderUniform defaultUniforms, const std::string& geometryShaderFileName);
+
     // Registers a texture uniform to the given shader program.
     void registerTextureUniform(Program* pProgram, const std::string& shaderId, unsigned textureUniformId);
 
-    // Visits a node in the render tree, returning the child node of the given parent, matching the
-    // provided value.
-    template<typename T, typename U, typename V>
-    T* visitRenderTreeNode(U* pParentNode, V* value);
+    // Returns the asset with the given ID from the given map, or nullptr if it has not been loaded.
+    template<typename T>
+    static T* findAsset(const std::map<std::string, T*>& assets, const std::string& id);
 };
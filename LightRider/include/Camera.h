@@ -5,11 +5,16 @@
 #include "Texture.h"
 #include "Shape.h"
 #include "RenderConfiguration.h"
+#include "ViewFrustum.h"
+#include "OcclusionCuller.h"
+#include "UniformBuffer.h"
+#include "ProgramOutputMode.h"
 
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
 class AssetManager;
+struct DrawItem;
 
 // Used for rendering the scene.
 // Usage: addComponent(bool enabled = true, float layerDepth = 0.0f)
@@ -64,7 +69,16 @@ public:
 
     // Gets the PV matrix of the sun.
     const glm::mat4& getSunPvMatrix() const { return m_sunPvMatrix; }
+
+    // Gets the distance from the sun to the camera.
+    float getSunDistance() const { return m_sunDistance; }
+
+    // Returns true if the camera samples the scene's shared shadow map, which must then render a view for it.
+    virtual bool usesSharedShadowMap() const { return false; }
     
+    // Gets the frustum that Renderables should be culled against in the current render pass.
+    const ViewFrustum& getCullingFrustum() const { return m_cullingFrustum; }
+
     // Gets the render configuration used for the primary render pass.
     const RenderConfiguration& getPrimaryRenderConfiguration() const { return m_primaryRenderConfiguration; }
 
@@ -91,6 +105,9 @@ public:
 
     // Gets the shadow map texture ID if it exists, otherwise 0.
     virtual GLuint getShadowMapTextureId() const { return 0; }
+
+    // Gets the occlusion culler used by the primary pass, or nullptr if the camera does no occlusion culling.
+    virtual OcclusionCuller* getOcclusionCuller() { return nullptr; }
     
 protected:
 
@@ -100,12 +117,47 @@ protected:
     // Called just after the camera renders the scene.
     virtual void postRender() { }
 
+    // Sets the frustum that Renderables should be culled against in the current render pass, and culls
+    // every registered Renderable against it. Unless the phase is NONE, the latest occlusion results are
+    // also applied, and instances are culled against the camera's occlusion culler.
+    void setCullingFrustum(const ViewFrustum& cullingFrustum, OcclusionPhase occlusionPhase = OcclusionPhase::NONE);
+
+    // Returns true if the Renderable in the given culling bounds slot survived the last culling pass.
+    bool isVisible(uint32_t boundsSlot) const { return boundsSlot >= m_visibility.size() || m_visibility[boundsSlot]; }
+
+    // Fills in the matrices that map world space into each of the camera's shadow cascades, and the shadow
+    // map layer holding the first of them.
+    virtual void getShadowMapping(CameraUniforms& cameraUniforms) const;
+
+    // Returns the world-space center of the voxel light map, if the camera renders one.
+    virtual glm::vec3 getVoxelCenterPosition() const { return glm::vec3(0.0f); }
+
+    // Writes the given pass matrices and output mode into a slot of the provided buffer, then binds it
+    // as the active "ViewUniforms" block.
+    void bindViewUniforms(UniformBuffer& buffer, int slot, const glm::mat4& perspectiveMatrix, const glm::mat4& viewMatrix,
+        ProgramOutputMode outputMode);
+
+    // Writes the given block into a slot of the provided buffer, then binds it as the active "ViewUniforms" block.
+    void bindViewUniforms(UniformBuffer& buffer, int slot, const ViewUniforms& viewUniforms);
+
+    // Returns true if any Renderable taking part in the configuration's pass survived the last culling pass.
+    bool hasVisibleRenderables(const RenderConfiguration& configuration);
+
     // Renders Renderables with blending disabled.
     void renderUnblendedRenderables(const RenderConfiguration& configuration);
 
+    // The second occlusion phase. Renders the unblended Renderables that the first phase hid, with batched
+    // draws skipped on the GPU if the occlusion culler's latest test still finds them hidden. Renderables
+    // that can't be batched are drawn regardless. Afterwards the hidden slots count as visible again, so that
+    // blended Renderables, which can't be tested this way, are drawn as well.
+    void renderRevealedRenderables(const RenderConfiguration& configuration, OcclusionCuller* pOcclusionCuller);
+
     // Renders Renderables with blending enabled.
     void renderBlendedRenderables(const RenderConfiguration& configuration);
 
+    // Renders a single draw item with its program and textures.
+    void renderDrawItem(const DrawItem& item);
+
     // Finds and sets up a texture for use.
     void findAndSetUpTexture(AssetManager* pAssets, TextureType type, const std::string& textureId);
 
@@ -117,6 +169,11 @@ protected:
 
 private:
 
+    // Renders the unblended Renderables taking part in the configuration's pass whose culling bounds slots
+    // the given predicate selects.
+    template<typename SlotFilter>
+    void renderUnblendedItems(const RenderConfiguration& configuration, SlotFilter isSelected);
+
     // The shader program used to render the sky.
     Program* m_pSkyShaderProgram;
 
@@ -129,6 +186,12 @@ private:
     // The render configuration used for the primary render pass.
     RenderConfiguration m_primaryRenderConfiguration;
 
+    // The "ViewUniforms" block used for the primary render pass.
+    UniformBuffer m_viewUniformBuffer;
+
+    // The "CameraUniforms" block shared by every pass of the camera's frame.
+    UniformBuffer m_cameraUniformBuffer;
+
     // If true, the camera is enabled and actively rendering in the current scene.
     bool m_isEnabled;
 
@@ -157,6 +220,15 @@ private:
     // The PV matrix of the sun.
     glm::mat4 m_sunPvMatrix;
 
+    // The frustum that Renderables should be culled against in the current render pass.
+    ViewFrustum m_cullingFrustum;
+
+    // The visibility of each culling bounds slot in the current render pass.
+    std::vector<uint8_t> m_visibility;
+
+    // For each culling bounds slot, 1 if the first occlusion phase of the primary pass hid it.
+    std::vector<uint8_t> m_occludedSlots;
+
     // The focal length of the camera.
     glm::vec2 m_focalLength;
 
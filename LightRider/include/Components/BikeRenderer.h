@@ -9,7 +9,7 @@ class BikeRenderer : public MeshRenderer
 public:
 
     // Creates a new bike renderer, rendering using the specified bike color.
-    BikeRenderer(int playerId) : MeshRenderer("bikeShader", "bikeTexture", "bikeShape", false, true),
+    BikeRenderer(int playerId) : MeshRenderer("bikeShader", "bikeTexture", "bikeShape", false, false, "drawDataShadowShader"),
         m_playerId(playerId),
         m_transitionAmount(0.0)
     {
@@ -24,8 +24,10 @@ public:
     // The ID of the player being rendered.
     int getPlayerId() const { return m_playerId; }
 
-    // Renders the bike body.
-    virtual void render();
+protected:
+
+    // Fills in the bike's player ID and transition amount.
+    virtual void fillDrawData(DrawData& drawData) const;
 
 private:
 
@@ -15,8 +15,9 @@ public:
         setCullingEnabled(false);
     }
 
-    // Renders the chunk.
-    virtual void render();
+protected:
+    // Fills in the ID of the player that the chunk was spawned from.
+    virtual void fillDrawData(DrawData& drawData) const;
 
 private:
     // The ID of the player that this chunk was spawned from.
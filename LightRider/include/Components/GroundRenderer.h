@@ -10,7 +10,7 @@ class GroundRenderer : public MeshRenderer
 public:
     // Creates a new ramp renderer.
     GroundRenderer() :
-        MeshRenderer("groundShader", "groundTexture", "planeShape", true),
+        MeshRenderer("groundShader", "groundTexture", "planeShape", true, false, "", true),
         m_pSkyTexture(nullptr)
     {
     }
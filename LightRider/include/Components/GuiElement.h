@@ -53,6 +53,8 @@ public:
 
     virtual float getDepth(Camera* pCamera) const;
 
+    virtual float getSortDepth(Camera* pCamera) const { return getDepth(pCamera); }
+
 private:
 
     HorizontalAnchor m_horizontalAnchor;
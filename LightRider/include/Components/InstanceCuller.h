@@ -0,0 +1,60 @@
+#pragma once
+
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "Component.h"
+#include "ComputeProgram.h"
+#include "ViewFrustum.h"
+#include "OcclusionCuller.h"
+#include "Components/MeshRenderer.h"
+
+// Culls the instances of the GameObject's instanced MeshRenderer on the GPU whenever a render pass sets its
+// culling frustum, so that only the visible instances are drawn.
+// Usage: addComponent(const std::vector<glm::vec4>& instances), after instance data has been generated
+// for the mesh with the same (position, scale) instances.
+class InstanceCuller : public Component
+{
+public:
+
+    // Creates a new InstanceCuller instance.
+    InstanceCuller(const std::vector<glm::vec4>& instances);
+
+    // Destroys the InstanceCuller, restoring the mesh to drawing every instance.
+    virtual ~InstanceCuller();
+
+    // Initializes the InstanceCuller. Fails if the GameObject has no instanced MeshRenderer.
+    virtual bool initialize();
+
+    // Compacts the instances that intersect the given frustum into the mesh's instance buffer and updates
+    // the mesh's indirect draw commands to match. If an occlusion culler is given, the instances are also
+    // culled against its visibility history or depth pyramid, depending on the phase.
+    void cull(const ViewFrustum& frustum, OcclusionCuller* pOcclusionCuller = nullptr, OcclusionPhase phase = OcclusionPhase::NONE);
+
+    // Gets the MeshRenderer whose instances are culled.
+    MeshRenderer* getMeshRenderer() const { return m_pMeshRenderer; }
+
+private:
+
+    // The work group size of the instance culling compute shader.
+    static constexpr GLuint WORK_GROUP_SIZE = 64;
+
+    // Every instance of the mesh, as (position, scale).
+    std::vector<glm::vec4> m_instances;
+
+    // The MeshRenderer whose instances are culled.
+    MeshRenderer* m_pMeshRenderer;
+
+    // The instanced shape drawn by the MeshRenderer.
+    Shape* m_pShape;
+
+    // The compute shader that culls and compacts the instances.
+    ComputeProgram* m_pCullShader;
+
+    // The storage buffer holding every instance.
+    GLuint m_instanceBuffer;
+
+    // The indirect draw commands, one per object in the mesh's shape.
+    GLuint m_commandBuffer;
+};
@@ -4,6 +4,7 @@
 #include <btBulletDynamicsCommon.h>
 
 #include "Renderable.h"
+#include "Texture.h"
 
 // Updates and renders a light trail on the attached GameObject.
 // Usage: addComponent(const glm::vec3& color)
@@ -44,6 +45,9 @@ private:
     // The shader program used to render the trail.
     Program* m_pShaderProgram;
 
+    // The tileable noise volume sampled by the trail shader.
+    Texture* m_pNoiseTexture;
+
     // The rigid body of the light trail.
     btRigidBody* m_pRigidBody;
 
@@ -73,46 +77,63 @@ private:
     // The bottom vertex of the leading edge of the trail.
     glm::vec3 m_lastVertex2;
 
-    // The game tick when the last segment was created.
-    float m_lastTimeStamp;
-
-    // The vertices in the trail.
-    std::vector<glm::vec3> m_trailVertices;
-
-    // The height values of the vertices in the trail.
-    std::vector<float> m_trailHeights;
-
-    // The time stamps of the vertices in the trail.
-    std::vector<float> m_trailTimeStamps;
-
-    // The vertex array object ID for the trail.
+    // A single edge of the trail, laid out to match the std430 TrailEdge struct in trail_vertex.glsl.
+    // Consecutive edges are drawn as a triangle strip.
+    struct TrailEdge
+    {
+        glm::vec3 top;
+        float timeStamp;
+        glm::vec3 bottom;
+        float padding;
+    };
+
+    // The bounds of a run of GC::trailBlockEdgeCount segments, used for culling.
+    struct TrailBlock
+    {
+        glm::vec3 min;
+        glm::vec3 max;
+    };
+
+    // A fixed-size block of trail edges with its own storage buffer. Pages are filled append-only
+    // and are never reallocated. Each page begins with a copy of the previous page's last edge so
+    // no segment spans two pages.
+    struct TrailPage
+    {
+        GLuint edgeBuffer;
+        int edgeCount;
+        std::vector<TrailBlock> blocks;
+    };
+
+    // The pages holding the trail's committed edges. The last page always has room for the head edge.
+    std::vector<TrailPage> m_trailPages;
+
+    // The top vertex of the head edge.
+    glm::vec3 m_headTop;
+
+    // The bottom vertex of the head edge.
+    glm::vec3 m_headBottom;
+
+    // The first vertex of each visible range in the page being drawn.
+    std::vector<GLint> m_drawFirsts;
+
+    // The vertex count of each visible range in the page being drawn.
+    std::vector<GLsizei> m_drawCounts;
+
+    // The vertex array object ID for the trail. Vertices are pulled from the page buffers, so it has no attributes.
     GLuint m_trailVertexArray;
 
-    // The vertex buffer object ID for the trail vertices.
-    GLuint m_trailVertexBuffer;
-
-    // The vertex buffer object ID for the trail heights.
-    GLuint m_trailHeightBuffer;
-
-    // The vertex buffer object ID for the trail vertex time stamps.
-    GLuint m_trailTimeStampBuffer;
-
-    // The trail vertex count.
-    int m_trailVertexCount;
-    
-    // The trail buffer size.
-    int m_trailBufferSize;
-
     // Calculates the positions of the latest trail edge.
     void calculateTrailEdge(glm::vec3& vertex1, glm::vec3& vertex2);
 
-    // Generates segment vertex and height data from the given leading edge.
-    void generateSegmentData(const glm::vec3& edgeVertex1, const glm::vec3& edgeVertex2,
-        glm::vec3* pSegmentVertices, float* pSegmentHeights, float* pSegmentTimeStamps);
+    // Writes the given edge to the provided page at the given edge index.
+    void writeEdge(const TrailPage& page, int index, const glm::vec3& top, const glm::vec3& bottom, float timeStamp);
+
+    // Appends the given edge to the trail, moving the head edge to the next free slot.
+    void appendEdge(const glm::vec3& top, const glm::vec3& bottom, float timeStamp);
 
-    // Writes the given segment data to the vertex and height buffers at the provided offset.
-    void writeSegmentData(int offset, glm::vec3* pSegmentVertices, float* pSegmentHeights, float* pSegmentTimeStamps);
+    // Grows the bounds of the blocks containing the edge at the given index in the provided page.
+    void expandTrailBlocks(TrailPage& page, int index, const glm::vec3& top, const glm::vec3& bottom);
 
-    // Copies the trail buffer to a new buffer of the provided size.
-    void reallocateTrailBuffer(int size);
+    // Allocates a new, empty trail page.
+    void addTrailPage();
 };
@@ -3,6 +3,7 @@
 #include "Renderable.h"
 #include "Program.h"
 #include "Shape.h"
+#include "DrawBatch.h"
 
 // Renders a mesh located at the attached GameObject.
 // Usage: addComponent(const std::string& shaderProgramId, const std::string& primaryTextureId, const std::string& shapeId).
@@ -16,7 +17,9 @@ public:
         const std::string& primaryTextureId,
         const std::string& shapeId,
         bool useBlending = false,
-        bool useDetailedShadows = false);
+        bool useDetailedShadows = false,
+        const std::string& depthProgramId = "",
+        bool isStatic = false);
 
     // Gets the transform of the mesh relative to the parent GameObject.
     glm::mat4& getLocalTransform() { return m_localTransform; }
@@ -24,6 +27,9 @@ public:
     // Gets the shape representing the mesh.
     Shape* getShape() const { return m_pShape; }
 
+    // Returns the shape representing the mesh.
+    virtual const Shape* getMesh() const { return m_pShape; }
+
     // Gets the ID of the normal texture for this mesh.
     virtual const std::string& getNormalTextureId() const { return m_normalTextureId; }
 
@@ -43,20 +49,32 @@ public:
     // This is intended for objects that use blending or otherwise don't participate in deferred shading.
     void setUsingForwardShadowRendering(bool isUsingForwardShadowRendering) { m_isUsingForwardShadowRendering = isUsingForwardShadowRendering; }
 
+    // Gets the world-space bounding box of the mesh. Instanced meshes have no bounds.
+    virtual bool getWorldBounds(glm::vec3& min, glm::vec3& max) const;
+
     // Renders the mesh.
     virtual void render();
 
+    // Adds the mesh to the given batch if its shader program reads per-draw data.
+    virtual bool addToBatch(DrawBatch& batch);
+
     // Renders the mesh to a depth buffer given the shader program to do so.
     virtual bool renderDepth(Program* pDepthProgram);
 
     // Gets the depth of this mesh renderer relative to the given camera.
     virtual float getDepth(Camera* pCamera) const;
 
+    // Gets the sort depth of this mesh renderer relative to the given camera.
+    virtual float getSortDepth(Camera* pCamera) const;
+
 protected:
 
     // Returns the shader program used to render the mesh.
     Program* getShaderProgram() const { return m_pShaderProgram; }
 
+    // Fills in the per-object parameters of the mesh's draw data. The model matrix has already been set.
+    virtual void fillDrawData(DrawData& drawData) const { }
+
 private:
 
     // The string ID of the shape being rendered.
@@ -80,6 +98,9 @@ private:
     // Whether forward shadow rendering is being used.
     bool m_isUsingForwardShadowRendering;
 
+    // Whether the shader program reads its model matrix and parameters from per-draw data.
+    bool m_usesDrawData;
+
     // A custom depth function that can be used to override the default depth function.
     float (*m_pDepthFunc)(Camera*);
 };
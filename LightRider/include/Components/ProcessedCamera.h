@@ -3,8 +3,10 @@
 #include "GameObject.h"
 #include "ComputeProgram.h"
 #include "Camera.h"
+#include "GameConfig.h"
 #include "Program.h"
 #include "Texture.h"
+#include "ShadowMapService.h"
 
 // Extends the Camera component, integrating post processing.
 class ProcessedCamera : public Camera
@@ -35,8 +37,14 @@ public:
     // Returns the size ratio of the camera to screen size.
     glm::vec2 getSizeRatio() const { return m_sizeRatio; }
     
-    // Gets the shadow map texture ID.
-    virtual GLuint getShadowMapTextureId() const { return m_shadowMapDepthBuffer; }
+    // Gets the ID of the scene's shared shadow map array texture.
+    virtual GLuint getShadowMapTextureId() const { return m_pShadowMapService->getDepthTexture(); }
+
+    // Returns true, as processed cameras light the scene with the shared shadow map.
+    virtual bool usesSharedShadowMap() const { return true; }
+
+    // Gets the occlusion culler used by the primary pass.
+    virtual OcclusionCuller* getOcclusionCuller() { return m_pOcclusionCuller; }
 
     virtual void update(float deltaTime);
 
@@ -56,13 +64,43 @@ protected:
     // Draws the processed frame buffer to the screen.
     virtual void postRender();
 
+    // Gets the cascades of the shared shadow map view rendered for this camera.
+    virtual void getShadowMapping(CameraUniforms& cameraUniforms) const;
+
+    // Returns the subject position snapped to the voxel grid.
+    virtual glm::vec3 getVoxelCenterPosition() const { return m_snappedSubjectPosition; }
+
 private:
 
+    // The number of levels in the voxel map. Must match VOXEL_LEVEL_COUNT in gi_fragment.glsl.
+    static constexpr int VOXEL_LEVEL_COUNT = 3;
+
+    // One level of the voxel map. Each level covers twice the extent of the previous one at the same
+    // resolution, and is addressed toroidally so that it can follow the subject without being rebuilt.
+    struct VoxelLevel
+    {
+        // The 3D texture storing the lit voxels of the level, dynamic objects included, with a full mip chain.
+        GLuint radianceTexture;
+
+        // The 3D texture storing the lit voxels of static objects, which are kept between frames. With packed
+        // storage, each voxel is a single running average written directly by voxelization.
+        GLuint staticTexture;
+
+        // The grid coordinates of the level's first voxel, in voxels of the level.
+        glm::ivec3 origin;
+
+        // If false, the static texture holds nothing and must be filled entirely.
+        bool isValid;
+
+        // If true, dynamic voxels were combined into the radiance texture when the level was last updated.
+        bool hasDynamicVoxels;
+    };
+
     // The subject of the camera. This dictates where the voxel light map should be centered.
     GameObject* m_pSubject;
 
-    // The shader used to render objects that cast shadows.
-    Program* m_pShadowShader;
+    // The scene's shared shadow map.
+    ShadowMapService* m_pShadowMapService;
 
     // The shader program used for deferred rendering.
     Program* m_pDeferredShader;
@@ -89,18 +127,36 @@ private:
     // The sky texture used for environment sampling.
     Texture* m_pSkyTexture;
 
+    // The "ViewUniforms" blocks used for each pass of the voxel map.
+    UniformBuffer m_voxelViewUniformBuffer;
+
+    // The next unused slot of the voxel map's "ViewUniforms" blocks in the current frame.
+    int m_voxelViewSlot;
+
     // The compute shader used to determine the overall luminance of the scene.
     ComputeProgram* m_pLuminanceComputeShader;
 
     // The compute shader used to clear the voxel texture.
     ComputeProgram* m_pVoxelClearComputeShader;
 
-    // The compute shader used to combine each voxel map component texture.
+    // The compute shader used to combine each voxel map component texture with a level's static voxels.
     ComputeProgram* m_pVoxelCombineComputeShader;
 
+    // The compute shader used to store each voxel map component texture as a level's static voxels.
+    ComputeProgram* m_pVoxelStoreStaticComputeShader;
+
     // The compute shader used to generate a mipmap for the voxel texture.
     ComputeProgram* m_pVoxelMipmapComputeShader;
 
+    // The compute shader used to count the covered voxels for timing reports.
+    ComputeProgram* m_pVoxelCoverageComputeShader;
+
+    // The compute shader used to clear a region of a packed voxel texture.
+    ComputeProgram* m_pVoxelClearPackedComputeShader;
+
+    // The compute shader used to combine the packed dynamic voxels with a level's packed static voxels.
+    ComputeProgram* m_pVoxelCombinePackedComputeShader;
+
     // The frame buffer that the scene gets rendered to.
     GLuint m_primaryFrameBuffer;
 
@@ -116,9 +172,6 @@ private:
     // The material info buffer for the primary frame buffer.
     GLuint m_primaryMaterialBuffer;
 
-    // The frame buffer used to store the shadow map.
-    GLuint m_shadowMapFrameBuffer;
-
     // The frame buffer that handles deferred rendering.
     GLuint m_deferredFrameBuffer;
 
@@ -155,11 +208,8 @@ private:
     // The color buffers used to process bloom.
     GLuint m_pingPongColorBuffers[2];
 
-    // The depth render buffer.
-    GLuint m_depthRenderBuffer;
-
-    // The depth render buffer for the shadow map.
-    GLuint m_shadowMapDepthBuffer;
+    // The depth texture for the primary frame buffer.
+    GLuint m_primaryDepthBuffer;
 
     // The framebuffer used to render to the voxel light map.
     GLuint m_voxelFrameBuffer;
@@ -168,12 +218,30 @@ private:
     // This buffer is only attached in order to make the framebuffer valid - we don't write to it.
     GLuint m_voxelColorBuffer;
 
-    // The 3D texture storing the voxel light map.
-    GLuint m_voxelMapTexture;
+    // The levels of the voxel light map, from finest to coarsest.
+    VoxelLevel m_voxelLevels[VOXEL_LEVEL_COUNT];
 
-    // The 3D textures representing each component in the voxel light map.
+    // The 3D textures representing each component of the static voxels being added to a level. Each pass
+    // that reads them leaves them empty.
     GLuint m_voxelMapTextureComponents[4];
 
+    // The 3D textures representing each component of the dynamic voxels of a level, at half its resolution
+    // since they only hold a few moving emitters. Each pass that reads them leaves them empty.
+    GLuint m_dynamicVoxelMapTextureComponents[4];
+
+    // The 3D texture holding the packed dynamic voxels of a level, used in place of the dynamic component
+    // textures when voxel storage is packed. Each pass that reads it leaves it empty.
+    GLuint m_packedDynamicVoxelMapTexture;
+
+    // If true, voxels are stored packed, one running average per voxel, rather than as component textures.
+    bool m_isVoxelMapPacked;
+
+    // If false, the component textures have just been created and must be cleared before use.
+    bool m_areVoxelComponentsClear;
+
+    // The static revision of the asset manager when the voxel map's static voxels were last updated.
+    unsigned m_voxelStaticRevision;
+
     // The VAO for the quad to display the texture.
     GLuint m_quadVertexArrayObject;
 
@@ -199,8 +267,11 @@ private:
     // needs to be recreated.
     bool m_areFrameBuffersDirty;
 
-    // The render configuration used to render the voxel map.
-    RenderConfiguration m_voxelMapRenderConfiguration;
+    // The render configuration used to voxelize static objects.
+    RenderConfiguration m_staticVoxelRenderConfiguration;
+
+    // The render configuration used to voxelize dynamic objects.
+    RenderConfiguration m_dynamicVoxelRenderConfiguration;
 
     // The offset ratio of the camera to screen size.
     glm::vec2 m_offsetRatio;
@@ -214,31 +285,73 @@ private:
     // The target exposure level.
     float m_targetExposure;
 
-    // The subject position snapped to the voxel grid.
+    // The center of the voxel map's finest level.
     glm::vec3 m_snappedSubjectPosition;
 
-    // The current perspective matrix used to render the voxel map.
-    glm::mat4 m_voxelPerspectiveMatrix;
+    // Tests the primary pass against its own depth to cull occluded geometry.
+    OcclusionCuller* m_pOcclusionCuller;
+
+    // The timer queries used to measure the voxel map pass. Two are used so the previous frame's result
+    // can be read without stalling.
+    GLuint m_voxelTimerQueries[2];
+
+    // The index of the timer query used in the current frame.
+    int m_currentVoxelTimerQuery;
+
+    // If true, the other timer query has been issued and its result can be read.
+    bool m_hasPreviousVoxelTimerQuery;
 
-    // The current view matrix used to render the voxel map.
-    glm::mat4 m_voxelViewMatrix;
+    // The number of frames measured since the last voxel timing report. Negative while frames are skipped.
+    int m_voxelTimedFrameCount;
+
+    // The total GPU time of the voxel map pass since the last report, in milliseconds.
+    double m_voxelGpuTime;
 
     // Creates a new frame buffer, freeing the old one if it exists.
     void createFrameBuffers();
 
     // Deltes all frame buffers and textures.
     inline void deleteBuffers();
+
+    // Creates the textures that voxels are accumulated and cached in, in the layout chosen by m_isVoxelMapPacked.
+    // Every level is rebuilt afterwards.
+    void createVoxelStorage();
+
+    // Deletes the textures created by createVoxelStorage.
+    void deleteVoxelStorage();
     
-    // Renders the current scene to the shadow map.
-    void renderShadowMap();
+    // Builds the depth pyramid from the primary pass, starts testing Renderables against it, and draws
+    // the instances it reveals.
+    void renderOcclusionPass();
 
     // Performs a deferred rendering pass.
     void renderDeferred();
 
-    // Renders the scene from the given camera matrices into the voxel light map.
+    // Updates each level of the voxel light map around the subject.
     void renderToVoxelMap();
 
-    glm::vec3 getVoxelSnappedSubjectPosition() const;
+    // Voxelizes the static objects in the parts of a level that it has moved into since it was last updated.
+    // Returns true if any part of the level was updated.
+    bool updateStaticVoxels(int level, bool isSinglePass);
+
+    // Voxelizes the objects of the given configuration into the bound voxel textures, which cover the
+    // given level with the given number of voxels along each axis. Only voxels between regionMin (inclusive)
+    // and regionMax (exclusive) are written. Returns false if no object was visible in the region.
+    bool voxelizeRegion(int level, GLsizei dimension, const glm::ivec3& regionMin, const glm::ivec3& regionMax,
+        const RenderConfiguration& configuration, bool isSinglePass);
+
+    // Binds the given component textures to the image units read and written by voxelization.
+    void bindVoxelComponents(const GLuint* pComponents);
+
+    // Accumulates the GPU time of the voxel map pass, reporting the average every reportInterval frames along
+    // with the voxels covered in each level. Returns true if a report was made.
+    bool reportVoxelTiming(int reportInterval, bool isSinglePass, bool isPacked);
+
+    // Switches to the next voxelization mode and storage layout being compared, rebuilding every level in the new mode.
+    void switchVoxelMode(GameConfig& config);
+
+    // Gets the grid coordinates of the first voxel of the given level, centered on the subject.
+    glm::ivec3 getVoxelLevelOrigin(int level) const;
 
     void generateNoise(glm::vec3* noise, unsigned int size);
 };
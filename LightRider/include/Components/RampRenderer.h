@@ -10,7 +10,7 @@ class RampRenderer : public MeshRenderer
 public:
 
     // Creates a new ramp renderer.
-    RampRenderer() : MeshRenderer("rampShader", "", "rampShape"),
+    RampRenderer() : MeshRenderer("rampShader", "", "rampShape", false, false, "", true),
         m_totalTime(0.0f)
     {
     }
@@ -18,8 +18,10 @@ public:
     // Updates the ramp.
     virtual void update(float deltaTime);
 
-    // Renders the ramp.
-    virtual void render();
+protected:
+
+    // Fills in the ramp's animation time.
+    virtual void fillDrawData(DrawData& drawData) const;
 
 private:
 
@@ -15,7 +15,8 @@ public:
     ContainerGroupBuilder(float scale, float spacing);
 
     void addGroup(const glm::vec2& position, const glm::ivec3& dimensions);
-    GameObject* build(const std::string& shaderProgramId, const std::string& primaryTextureId, const std::string& shapeId);
+    GameObject* build(const std::string& shaderProgramId, const std::string& primaryTextureId, const std::string& shapeId,
+        const std::string& depthProgramId);
 
 private:
     float m_scale;
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "ViewFrustum.h"
+#include "Renderable.h"
+
+// Holds the world-space bounding box of every registered Renderable in a single list, so that each render
+// pass can cull all of them against its frustum in one sweep.
+class CullingBounds
+{
+public:
+
+    // Creates a new CullingBounds instance.
+    CullingBounds();
+
+    // Reserves a bounds slot for the given Renderable, returning its index. The slot is never culled until
+    // its bounds are first updated.
+    uint32_t allocate(Renderable* pRenderable);
+
+    // Frees the given bounds slot.
+    void release(uint32_t slot);
+
+    // Tests every slot against the given frustum, writing 1 for visible slots and 0 for culled ones.
+    // Bounds are refreshed first if they have not been refreshed during the current tick.
+    void cull(const ViewFrustum& frustum, std::vector<uint8_t>& visibility);
+
+    // Gets the bounding box of every slot, as of the last cull.
+    const AabbList& getBounds() const { return m_bounds; }
+
+    // Gets the generation of every slot. A slot's generation changes whenever it is released, so results
+    // gathered for one owner of a slot can be told apart from those of the next.
+    const std::vector<uint32_t>& getGenerations() const { return m_generations; }
+
+private:
+
+    // The Renderable owning each slot, or nullptr if the slot is free.
+    std::vector<Renderable*> m_renderables;
+
+    // The indices of free slots.
+    std::vector<uint32_t> m_freeSlots;
+
+    // The generation of each slot.
+    std::vector<uint32_t> m_generations;
+
+    // The world-space bounding box of each slot.
+    AabbList m_bounds;
+
+    // The tick during which the bounds were last refreshed.
+    long m_updateTick;
+
+    // Recomputes the bounds of every allocated slot.
+    void update();
+
+    // Makes the given slot visible in every frustum.
+    void setUnbounded(uint32_t slot);
+};
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "ComputeProgram.h"
+#include "GeometryArena.h"
+#include "Shape.h"
+
+// The shader storage binding point of the per-draw data buffer.
+constexpr GLuint DRAW_DATA_STORAGE_BINDING = 1;
+
+// The vertex attribute location of the draw index used to look up per-draw data.
+constexpr GLuint DRAW_INDEX_LOCATION = 4;
+
+// Mirrors the std430 "DrawData" struct in draw_data.glsl, read by shaders drawn through a DrawBatch.
+struct DrawData
+{
+    // The model matrix of the draw.
+    glm::mat4 modelMatrix;
+
+    // The ID of the player the draw belongs to.
+    GLint playerId;
+
+    // The transition amount of a bike.
+    GLfloat transitionAmount;
+
+    // The animation time of the draw.
+    GLfloat time;
+
+    // Pads the struct to a multiple of 16 bytes, as required by std430 arrays of structs.
+    GLfloat padding;
+};
+
+// Mirrors the layout of the commands read by glMultiDrawElementsIndirect.
+struct DrawElementsIndirectCommand
+{
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+// Collects draws of shapes stored in a GeometryArena and submits them with a single
+// glMultiDrawElementsIndirect call. Each draw's data is written to a shader storage buffer and
+// located by the shader through the draw index attribute, which each command's base instance selects.
+class DrawBatch
+{
+public:
+
+    // Creates a new DrawBatch instance drawing from the given arena, holding up to drawCapacity draws.
+    DrawBatch(const GeometryArena& arena, int drawCapacity);
+
+    // Destroys the DrawBatch instance.
+    ~DrawBatch();
+
+    // Returns the number of draws waiting to be submitted.
+    int getDrawCount() const { return (int)m_commands.size(); }
+
+    // Adds a draw of every object in the given shape. The batch is submitted first if it is full or
+    // if the draw needs a different face culling state. Returns false if the shape isn't in the arena.
+    bool add(const Shape* pShape, const DrawData& drawData, bool isCullingEnabled);
+
+    // Sets the culling bounds slot of the draws added next, by which the visibility buffer is indexed.
+    void setBoundsSlot(uint32_t boundsSlot) { m_boundsSlot = boundsSlot; }
+
+    // While a visibility buffer is set, each submitted draw is skipped on the GPU unless the buffer holds a
+    // nonzero value for its bounds slot. The given compute shader applies the buffer to the pending commands.
+    // Pass a buffer of 0 to draw everything again.
+    void setVisibilityTest(ComputeProgram* pVisibilityShader, GLuint visibilityBuffer);
+
+    // Draws everything added since the last submission using the currently bound program.
+    void submit();
+
+    // Submits the pending draws, then makes the given draw data the only entry read by the next draw made
+    // outside the batch, such as a shape drawn with its own vertex array.
+    void bindSingleDrawData(const DrawData& drawData);
+
+private:
+
+    // The work group size of the visibility compute shader.
+    static constexpr GLuint VISIBILITY_WORK_GROUP_SIZE = 64;
+
+    // The vertex array that reads from the arena's buffers.
+    GLuint m_vertexArray;
+
+    // The buffer of sequential draw indices fed to the draw index attribute.
+    GLuint m_drawIndexBuffer;
+
+    // The buffer holding the indirect draw commands.
+    GLuint m_commandBuffer;
+
+    // The shader storage buffer holding the per-draw data.
+    GLuint m_drawDataBuffer;
+
+    // The shader storage buffer holding the bounds slot of each draw, used by the visibility test.
+    GLuint m_boundsSlotBuffer;
+
+    // The compute shader applying the visibility buffer to the pending commands.
+    ComputeProgram* m_pVisibilityShader;
+
+    // The buffer holding the visibility of each bounds slot, or 0 if every draw is made.
+    GLuint m_visibilityBuffer;
+
+    // The bounds slot of the draws added next.
+    uint32_t m_boundsSlot;
+
+    // The maximum number of draws in a single submission.
+    int m_drawCapacity;
+
+    // Whether face culling is enabled for the pending draws.
+    bool m_isCullingEnabled;
+
+    // The pending draw commands.
+    std::vector<DrawElementsIndirectCommand> m_commands;
+
+    // The pending per-draw data, parallel to m_commands.
+    std::vector<DrawData> m_drawData;
+
+    // The bounds slot of each pending draw, parallel to m_commands.
+    std::vector<GLuint> m_boundsSlots;
+};
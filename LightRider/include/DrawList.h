@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+
+#include "RenderConfiguration.h"
+#include "Renderable.h"
+#include "Program.h"
+#include "Texture.h"
+
+// A single entry in the draw list.
+struct DrawItem
+{
+    // The sort key, packed from most to least significant as pass mask, program, texture, and mesh.
+    uint64_t key;
+
+    // The passes the item takes part in.
+    DrawPass passes;
+
+    // The Renderable to draw, or nullptr if the item has been removed but not yet compacted.
+    Renderable* pRenderable;
+
+    // The shader program used to draw the Renderable.
+    Program* pShaderProgram;
+
+    // The image texture used to draw the Renderable.
+    Texture* pTexture;
+
+    // The program used to draw the Renderable to depth-only passes, or nullptr to use the pass's own.
+    Program* pDepthProgram;
+
+    // The index of the Renderable's slot in the scene's culling bounds.
+    uint32_t boundsSlot;
+};
+
+// A flat list of unblended draws, kept sorted by a packed key so that passes can iterate it linearly
+// while switching programs and textures as rarely as possible.
+class DrawList
+{
+public:
+
+    // Creates a new DrawList instance.
+    DrawList();
+
+    // Adds a Renderable to the list. Its key is computed the next time the list is sorted, so that
+    // derived Renderables have finished construction by then.
+    void add(Renderable* pRenderable, DrawPass passes, Program* pShaderProgram, Texture* pTexture, Program* pDepthProgram,
+        uint32_t boundsSlot);
+
+    // Removes a Renderable from the list. The item is left in place with a null Renderable until the
+    // next sort compacts the list.
+    void remove(Renderable* pRenderable);
+
+    // Returns the sorted draw items, sorting them first if the list has changed.
+    // Items with a null Renderable must be skipped.
+    const std::vector<DrawItem>& getItems();
+
+    // Returns the item of the given Renderable, or nullptr if it is not in the list.
+    const DrawItem* find(Renderable* pRenderable) const;
+
+    // Returns the number of live items in the list.
+    size_t getCount() const { return m_indices.size(); }
+
+private:
+
+    // The number of bits used by each field of the sort key.
+    static constexpr int PASS_BITS = 8;
+    static constexpr int PROGRAM_BITS = 16;
+    static constexpr int TEXTURE_BITS = 16;
+    static constexpr int MESH_BITS = 24;
+
+    // The draw items, sorted by key unless the list is dirty.
+    std::vector<DrawItem> m_items;
+
+    // The scratch buffer used by the radix sort.
+    std::vector<DrawItem> m_sortBuffer;
+
+    // Maps each live Renderable to the index of its item.
+    std::unordered_map<Renderable*, size_t> m_indices;
+
+    // Maps programs, textures, and meshes to the small integer IDs packed into sort keys.
+    std::unordered_map<const void*, uint32_t> m_sortIds;
+
+    // The number of items at the end of the list whose keys have not been computed.
+    size_t m_unkeyedCount;
+
+    // If true, items have been added or removed since the last sort.
+    bool m_isDirty;
+
+    // Returns the sort ID of the given resource, assigning a new one if necessary. Null resources have ID 0.
+    uint32_t getSortId(const void* pResource, int bits);
+
+    // Computes the sort key of the given item.
+    void computeKey(DrawItem& item);
+
+    // Removes dead items, computes pending keys, and radix sorts the list.
+    void sort();
+};
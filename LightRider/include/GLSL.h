@@ -25,9 +25,21 @@ namespace GLSL
     void enableVertexAttribArray(const GLint handle);
     void disableVertexAttribArray(const GLint handle);
     void vertexAttribPointer(const GLint handle, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const GLvoid *pointer);
+
+    // Installs a GL_KHR_debug message callback that reports errors along with the name of the pass that was
+    // active. Unless synchronous is true, the driver reports messages asynchronously and does not stall.
+    void enableDebugOutput(bool synchronous);
+
+    // Marks the start of a named pass for debug output and graphics debuggers. Passes may be nested.
+    void pushDebugGroup(const char *name);
+
+    // Marks the end of the innermost named pass.
+    void popDebugGroup();
 }
 
 
+// Define DISABLE_OPENGL_ERROR_CHECKS (the default in Release builds) to strip the glGetError round-trips
+// around every checked call. Errors are still reported through GLSL::enableDebugOutput.
 #ifndef DISABLE_OPENGL_ERROR_CHECKS
 #define CHECKED_GL_CALL(x) do { GLSL::printOpenGLErrors("{{BEFORE}} "#x, __FILE__, __LINE__); (x); GLSL::printOpenGLErrors(#x, __FILE__, __LINE__); } while (0)
 #else
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <ostream>
+#include <glad/glad.h>
+
+// Counts of the OpenGL state changes requested through GLState over a single frame.
+struct GLStateStats
+{
+    // The number of program changes issued to OpenGL.
+    int programChanges;
+
+    // The number of program changes skipped because the program was already in use.
+    int programChangesAvoided;
+
+    // The number of texture unit and texture binding changes issued to OpenGL.
+    int textureChanges;
+
+    // The number of texture unit and texture binding changes skipped because they were redundant.
+    int textureChangesAvoided;
+
+    // The number of vertex array changes issued to OpenGL.
+    int vertexArrayChanges;
+
+    // The number of vertex array changes skipped because the vertex array was already bound.
+    int vertexArrayChangesAvoided;
+
+    // The number of capability, cull face, depth mask and blend function changes issued to OpenGL.
+    int renderStateChanges;
+
+    // The number of capability, cull face, depth mask and blend function changes skipped because they were redundant.
+    int renderStateChangesAvoided;
+
+    // Returns the total number of state changes issued to OpenGL.
+    int getTotalChanges() const { return programChanges + textureChanges + vertexArrayChanges + renderStateChanges; }
+
+    // Returns the total number of redundant state changes that were skipped.
+    int getTotalChangesAvoided() const
+    {
+        return programChangesAvoided + textureChangesAvoided + vertexArrayChangesAvoided + renderStateChangesAvoided;
+    }
+
+    // Returns the changes counted since the given earlier statistics of the same frame.
+    GLStateStats operator-(const GLStateStats& start) const
+    {
+        return
+        {
+            programChanges - start.programChanges,
+            programChangesAvoided - start.programChangesAvoided,
+            textureChanges - start.textureChanges,
+            textureChangesAvoided - start.textureChangesAvoided,
+            vertexArrayChanges - start.vertexArrayChanges,
+            vertexArrayChangesAvoided - start.vertexArrayChangesAvoided,
+            renderStateChanges - start.renderStateChanges,
+            renderStateChangesAvoided - start.renderStateChangesAvoided,
+        };
+    }
+};
+
+// Tracks the OpenGL state set by the engine and skips redundant changes. All engine code should change
+// programs, texture bindings, vertex arrays, capabilities and blending through here so the tracked state
+// never diverges from the real state.
+namespace GLState
+{
+    // Starts a new frame, recording the statistics of the previous one. Tracked state is invalidated so
+    // any state set outside of GLState between frames is re-established on first use.
+    void beginFrame();
+
+    // Forgets all tracked state so that the next request of each kind is issued to OpenGL. Call this
+    // after deleting objects that may still be tracked as bound.
+    void invalidate();
+
+    // Returns the statistics of the most recently completed frame.
+    const GLStateStats& getFrameStats();
+
+    // Returns the statistics gathered so far during the current frame.
+    const GLStateStats& getCurrentStats();
+
+    // Writes the given statistics to the provided stream on a single line.
+    void writeStats(std::ostream& stream, const GLStateStats& stats);
+
+    // Makes the given program current.
+    void useProgram(GLuint program);
+
+    // Returns the program last made current through GLState.
+    GLuint getProgram();
+
+    // Marks the current program as no longer needed. The program stays current until another is used,
+    // which avoids round-trips through program 0 between draws.
+    void releaseProgram();
+
+    // Selects the active texture unit (e.g. GL_TEXTURE0).
+    void activeTexture(GLenum unit);
+
+    // Binds a texture to the given target of the active texture unit.
+    void bindTexture(GLenum target, GLuint texture);
+
+    // Binds the given vertex array object.
+    void bindVertexArray(GLuint vertexArray);
+
+    // Enables the given capability.
+    void enable(GLenum capability);
+
+    // Disables the given capability.
+    void disable(GLenum capability);
+
+    // Selects which polygon faces are culled.
+    void cullFace(GLenum mode);
+
+    // Enables or disables writing to the depth buffer.
+    void depthMask(GLboolean flag);
+
+    // Sets the blend function for the given draw buffer.
+    void blendFunc(GLuint buffer, GLenum sourceFactor, GLenum destinationFactor);
+}
@@ -33,6 +33,45 @@ struct GameConfig
     // The maximum number of physics ticks per frame.
     int maxPhysicsSubSteps = 10;
 
+    // The number of physics ticks kept in the physics profiler's rolling log.
+    int physicsStatsLogSize = 600;
+
+    // The physics tick duration, in milliseconds, above which the tick's statistics are reported.
+    // A value of zero or less disables spike reporting.
+    float physicsSpikeThreshold = 0.0f;
+
+    // The number of frames between reports of the state changes issued by the shadow pass.
+    // A value of zero or less disables reporting.
+    int shadowStatsReportInterval = 0;
+
+    // If true, shadow casters with their own programs are drawn grouped by program. Otherwise casters are drawn in
+    // draw list order exactly as the shadow pass did before grouping. Only meant for comparing the two.
+    bool groupShadowCasters = true;
+
+    // If true, a debug OpenGL context is created and GL_KHR_debug messages are reported with the active pass name.
+    bool glDebugOutput = false;
+
+    // If true, debug messages are reported synchronously. This gives exact call stacks at the cost of frame time.
+    bool glDebugOutputSynchronous = false;
+
+    // If true, the voxel map is filled in a single pass, with a geometry shader projecting each triangle along
+    // its dominant axis. Otherwise the scene is rendered once along each axis.
+    bool singlePassVoxelization = true;
+
+    // The number of frames over which the GPU time of the voxel map pass is averaged and reported.
+    // A value of zero or less disables reporting.
+    int voxelTimingReportInterval = 0;
+
+    // If true, each voxel timing report switches between single-pass and three-pass voxelization, and every
+    // second report between packed and unpacked storage, so that all four combinations are measured in one run.
+    // The frames just after a switch, which rebuild every level, aren't measured.
+    bool compareVoxelModes = false;
+
+    // If true, voxels are accumulated as a running average packed into one 32-bit texel, with a single atomic
+    // per fragment. Otherwise each color component and the fragment count are summed in their own texture.
+    // May be changed at runtime.
+    bool packedVoxelStorage = true;
+
     // The root directory from where game resources (shaders, objects, etc.) are loaded.
     std::string resourceDirectory = std::string();
 };
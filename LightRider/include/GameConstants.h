@@ -122,6 +122,12 @@ namespace GameConstants
     constexpr float bikeDeathFriction = 0.6f;
     constexpr float bikeDismantleTransitionRate = 0.8f;
 
+    // Light trail constants.
+    constexpr int trailPageEdgeCount = 2048;
+    constexpr int trailBlockEdgeCount = 64;
+    constexpr int trailNoiseVolumeDimension = 128;
+    constexpr bool trailUseNoiseVolume = true;
+
     // FX constants.
     constexpr int maxChunkCount = 100;
     constexpr float chunkLifetime = 5.0f;
@@ -131,4 +137,9 @@ namespace GameConstants
     constexpr float minChunkscale = 0.05f;
     constexpr float maxChunkScale = 0.1f;
     constexpr float deathChunkSpawnCount = 50;
+
+    // Render batching constants.
+    constexpr int geometryArenaVertexCapacity = 262144;
+    constexpr int geometryArenaIndexCapacity = 524288;
+    constexpr int drawBatchCapacity = 1024;
 }
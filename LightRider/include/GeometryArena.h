@@ -0,0 +1,76 @@
+#pragma once
+
+#include <glad/glad.h>
+
+// The location of a single mesh within a GeometryArena.
+struct GeometryRange
+{
+    // The index of the mesh's first element in the shared element buffer.
+    GLuint firstIndex;
+
+    // The number of elements in the mesh.
+    GLuint indexCount;
+
+    // The index of the mesh's first vertex in the shared vertex buffer.
+    GLint baseVertex;
+};
+
+// Packs the geometry of many meshes into a single shared vertex buffer and element buffer, so
+// that draws of different meshes don't need to switch buffers.
+// Vertices are interleaved as position (3 floats), normal (3 floats) and texture coordinates (2 floats).
+class GeometryArena
+{
+public:
+
+    // The number of floats in each vertex.
+    static constexpr GLsizei VERTEX_COMPONENTS = 8;
+
+    // The size of each vertex in bytes.
+    static constexpr GLsizei VERTEX_SIZE = VERTEX_COMPONENTS * sizeof(float);
+
+    // Creates a new GeometryArena instance with room for the given number of vertices and elements.
+    GeometryArena(GLsizei vertexCapacity, GLsizei indexCapacity);
+
+    // Destroys the GeometryArena instance.
+    ~GeometryArena();
+
+    // Returns the ID of the shared vertex buffer.
+    GLuint getVertexBuffer() const { return m_vertexBuffer; }
+
+    // Returns the ID of the shared element buffer.
+    GLuint getElementBuffer() const { return m_elementBuffer; }
+
+    // Returns the number of vertices currently stored.
+    GLsizei getVertexCount() const { return m_vertexCount; }
+
+    // Returns the number of elements currently stored.
+    GLsizei getIndexCount() const { return m_indexCount; }
+
+    // Returns true if the given number of vertices and elements fit in the room left, reporting it otherwise.
+    bool hasRoom(GLsizei vertexCount, GLsizei indexCount) const;
+
+    // Copies the given interleaved vertices and elements into the arena, writing their location to range.
+    // Returns false if there is not enough room left.
+    bool allocate(const float* pVertexData, GLsizei vertexCount, const unsigned int* pIndices, GLsizei indexCount,
+        GeometryRange& range);
+
+private:
+
+    // The ID of the shared vertex buffer.
+    GLuint m_vertexBuffer;
+
+    // The ID of the shared element buffer.
+    GLuint m_elementBuffer;
+
+    // The maximum number of vertices the arena can hold.
+    GLsizei m_vertexCapacity;
+
+    // The maximum number of elements the arena can hold.
+    GLsizei m_indexCapacity;
+
+    // The number of vertices currently stored.
+    GLsizei m_vertexCount;
+
+    // The number of elements currently stored.
+    GLsizei m_indexCount;
+};
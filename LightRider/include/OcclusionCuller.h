@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "ComputeProgram.h"
+#include "ViewFrustum.h"
+
+class CullingBounds;
+class InstanceCuller;
+
+// The stages of two-phase occlusion culling within a camera's primary pass.
+enum class OcclusionPhase
+{
+    // Cull against the frustum only.
+    NONE,
+
+    // Draw what was visible to the previous occlusion test, before the depth pyramid is rebuilt.
+    FIRST,
+
+    // Test what the first phase hid against the rebuilt depth pyramid, drawing what has been newly revealed.
+    SECOND,
+};
+
+// Builds a hierarchical depth pyramid from a camera's primary depth buffer and tests bounding boxes against it,
+// so that geometry hidden behind nearer geometry can be skipped.
+class OcclusionCuller
+{
+public:
+
+    // Creates a new OcclusionCuller instance.
+    OcclusionCuller();
+
+    // Destroys the OcclusionCuller instance.
+    ~OcclusionCuller();
+
+    // Recreates the depth pyramid to match a depth buffer of the given size. The pyramid is not ready
+    // again until it is next built.
+    void resize(int width, int height);
+
+    // Returns true if the depth pyramid has been built since it was last resized.
+    bool isReady() const { return m_isPyramidBuilt; }
+
+    // Builds the depth pyramid from the given depth texture, rendered with the given projection-view matrix.
+    void buildPyramid(GLuint depthTexture, const glm::mat4& pvMatrix);
+
+    // Binds the depth pyramid to texture unit 0 and sets the pyramid uniforms of the given compute program.
+    void bindPyramid(ComputeProgram* pProgram) const;
+
+    // Tests the box of every slot against the depth pyramid on the GPU. The results can be applied to draws
+    // on the GPU right away through getResultBuffer(), and are read back for the next frame's first phase.
+    void testBounds(const CullingBounds& cullingBounds);
+
+    // Returns the buffer holding the results of the latest test, 1 for each slot that may be visible and 0
+    // for each hidden one, or 0 if the pyramid could not be tested against.
+    GLuint getResultBuffer() const { return m_resultBuffer; }
+
+    // Returns the compute shader that applies the results of a test to a DrawBatch's draws.
+    ComputeProgram* getDrawVisibilityShader() const { return m_pDrawVisibilityShader; }
+
+    // Clears the visibility of every slot hidden in the previous frame's test, marking it in occluded.
+    // Nothing is cleared if those results aren't ready, nor for slots that have changed owner since.
+    void removeOccluded(const CullingBounds& cullingBounds, std::vector<uint8_t>& visibility, std::vector<uint8_t>& occluded);
+
+    // Returns the buffer holding the visibility history of the given InstanceCuller's instances for this
+    // camera, creating it with every instance visible if necessary.
+    GLuint getInstanceHistoryBuffer(const InstanceCuller* pInstanceCuller, size_t instanceCount);
+
+private:
+
+    // The number of occlusion result buffers cycled through, so that reading one back never waits for the GPU.
+    static constexpr int RESULT_BUFFER_COUNT = 3;
+
+    // The work group size of the pyramid and occlusion compute shaders.
+    static constexpr GLuint WORK_GROUP_SIZE = 8;
+    static constexpr GLuint TEST_WORK_GROUP_SIZE = 64;
+
+    // The compute shader that builds each level of the depth pyramid.
+    ComputeProgram* m_pDownsampleShader;
+
+    // The compute shader that tests boxes against the depth pyramid.
+    ComputeProgram* m_pTestShader;
+
+    // The compute shader that applies test results to the draws of a DrawBatch.
+    ComputeProgram* m_pDrawVisibilityShader;
+
+    // The depth pyramid texture, storing the farthest depth of each texel's footprint.
+    GLuint m_pyramidTexture;
+
+    // The size of the pyramid's first level.
+    glm::ivec2 m_pyramidSize;
+
+    // The number of levels in the pyramid.
+    int m_pyramidMipCount;
+
+    // The projection-view matrix the pyramid was built with.
+    glm::mat4 m_pyramidPvMatrix;
+
+    // If true, the pyramid has been built since it was last resized.
+    bool m_isPyramidBuilt;
+
+    // The buffer the tested bounds are uploaded into.
+    GLuint m_boundsBuffer;
+
+    // The buffers the occlusion results are written into.
+    GLuint m_resultBuffers[RESULT_BUFFER_COUNT];
+
+    // The fence signaled when each result buffer has been written, or nullptr if it holds no pending results.
+    GLsync m_resultFences[RESULT_BUFFER_COUNT];
+
+    // The number of boxes tested into each result buffer.
+    size_t m_resultCounts[RESULT_BUFFER_COUNT];
+
+    // The generation of each slot when it was tested into each result buffer.
+    std::vector<uint32_t> m_resultGenerations[RESULT_BUFFER_COUNT];
+
+    // The result buffer written by the next test.
+    int m_nextResultBuffer;
+
+    // The result buffer written by the latest test, or 0 if the latest frame made no test.
+    GLuint m_resultBuffer;
+
+    // The occlusion results read back from the GPU.
+    std::vector<uint32_t> m_results;
+
+    // The visibility history buffer of each InstanceCuller's instances.
+    std::unordered_map<const InstanceCuller*, GLuint> m_instanceHistoryBuffers;
+
+    // Deletes the depth pyramid texture.
+    void deletePyramid();
+};
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <deque>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <ostream>
+#include <btBulletDynamicsCommon.h>
+#include <LinearMath/btQuickprof.h>
+
+// Statistics gathered over a single internal physics tick.
+struct PhysicsTickStats
+{
+    // The index of the physics tick since the profiler was created.
+    int tick;
+
+    // The game frame in which the tick was simulated.
+    long frame;
+
+    // The number of overlapping pairs reported by the broadphase.
+    int overlappingPairs;
+
+    // The number of contact manifolds held by the dispatcher.
+    int manifolds;
+
+    // The total number of contact points across all manifolds.
+    int contactPoints;
+
+    // The number of solver iterations performed across all simulation islands.
+    int solverIterations;
+
+    // The number of child shapes in all light trail compound shapes.
+    int trailSegments;
+
+    // The number of chunks spawned during the tick.
+    int chunksSpawned;
+
+    // The number of non-static bodies that are awake.
+    int activeBodies;
+
+    // The number of non-static bodies that are sleeping.
+    int sleepingBodies;
+
+    // The time spent computing overlapping pairs, in milliseconds.
+    float broadphaseTime;
+
+    // The time spent dispatching collision pairs, in milliseconds.
+    float narrowphaseTime;
+
+    // The time spent solving constraints, in milliseconds.
+    float solverTime;
+
+    // The time spent integrating transforms, in milliseconds.
+    float integrationTime;
+
+    // The time spent in Scene::invokeCollisionCallbacks, in milliseconds.
+    float collisionCallbackTime;
+
+    // The time spent in GameObject physics tick handlers, in milliseconds.
+    float gameObjectTickTime;
+
+    // The total time spent in the tick, in milliseconds.
+    float totalTime;
+
+    // Gameplay events (deaths, chunk bursts, etc.) that occurred during the tick.
+    std::vector<std::string> events;
+};
+
+// Collects per-tick physics statistics from Bullet's profile zones and the scene's own counters,
+// keeping a rolling log of recent ticks.
+class PhysicsProfiler
+{
+public:
+
+    // Creates a new PhysicsProfiler instance.
+    PhysicsProfiler(int logSize);
+
+    // Destroys the PhysicsProfiler instance.
+    ~PhysicsProfiler();
+
+    // Returns whether the profiler is collecting statistics.
+    bool getEnabled() const { return m_isEnabled; }
+
+    // Enables or disables statistics collection.
+    void setEnabled(bool enabled) { m_isEnabled = enabled; }
+
+    // Sets the total tick time, in milliseconds, above which a tick is reported as a spike.
+    // A value of zero or less disables spike reporting.
+    void setSpikeThreshold(float spikeThreshold) { m_spikeThreshold = spikeThreshold; }
+
+    // Returns the statistics of the most recently completed tick.
+    const PhysicsTickStats& getLastTickStats() const { return m_lastTickStats; }
+
+    // Returns the rolling log of recently completed ticks, oldest first.
+    const std::deque<PhysicsTickStats>& getLog() const { return m_log; }
+
+    // Records a gameplay event. Events outside of a physics tick are attributed to the next tick.
+    void recordEvent(const std::string& event);
+
+    // Adds to the number of trail segments counted in the current tick.
+    void recordTrailSegments(int trailSegments);
+
+    // Adds to the number of chunks spawned in the current tick.
+    void recordChunksSpawned(int chunksSpawned);
+
+    // Begins collecting statistics for a new physics tick.
+    void beginTick();
+
+    // Samples the broadphase, dispatcher, and body counts from the given world.
+    void sampleWorld(btDiscreteDynamicsWorld* pDynamicsWorld);
+
+    // Marks the start of the collision callback stage.
+    void beginCollisionCallbacks();
+
+    // Marks the end of the collision callback stage.
+    void endCollisionCallbacks();
+
+    // Finishes the current tick, appending it to the rolling log.
+    void endTick();
+
+    // Writes the given tick statistics to the provided stream on a single line.
+    static void writeTickStats(std::ostream& stream, const PhysicsTickStats& stats);
+
+    // Writes the entire rolling log to the provided stream.
+    void dumpLog(std::ostream& stream) const;
+
+private:
+
+    typedef std::chrono::high_resolution_clock Clock;
+
+    // A Bullet profile zone that has been entered but not yet left.
+    struct ProfileZone
+    {
+        const char* name;
+        Clock::time_point startTime;
+    };
+
+    // The profiler currently collecting a tick, or nullptr outside of a tick.
+    static PhysicsProfiler* s_pActiveProfiler;
+
+    // The profile zone callbacks that were installed before ours.
+    static btEnterProfileZoneFunc* s_pPreviousEnterFunc;
+    static btLeaveProfileZoneFunc* s_pPreviousLeaveFunc;
+
+    // The stack of currently open Bullet profile zones. Zones are tracked even outside of a tick
+    // so that enter and leave calls stay balanced.
+    static std::vector<ProfileZone> s_zoneStack;
+
+    // The maximum number of ticks held in the rolling log.
+    int m_logSize;
+
+    // The number of ticks completed since the profiler was created.
+    int m_tickCount;
+
+    // If true, statistics are being collected.
+    bool m_isEnabled;
+
+    // The spike reporting threshold, in milliseconds.
+    float m_spikeThreshold;
+
+    // The statistics of the tick being collected.
+    PhysicsTickStats m_currentTickStats;
+
+    // The statistics of the most recently completed tick.
+    PhysicsTickStats m_lastTickStats;
+
+    // The rolling log of recently completed ticks.
+    std::deque<PhysicsTickStats> m_log;
+
+    // The time at which the current tick began.
+    Clock::time_point m_tickStartTime;
+
+    // The time at which the collision callback stage began.
+    Clock::time_point m_callbackStartTime;
+
+    // The time at which the collision callback stage ended.
+    Clock::time_point m_callbackEndTime;
+
+    // Resets the statistics of the tick being collected, keeping any pending events.
+    void resetCurrentTickStats();
+
+    // Accumulates the time spent in the given zone into the current tick's statistics.
+    void accumulateZone(const ProfileZone& zone, Clock::time_point endTime);
+
+    // Returns the number of milliseconds between the two time points.
+    static float elapsedMilliseconds(Clock::time_point startTime, Clock::time_point endTime);
+
+    // Installs the profile zone callbacks if they have not yet been installed.
+    static void installZoneCallbacks();
+
+    // Called by Bullet when a profile zone is entered.
+    static void enterProfileZone(const char* name);
+
+    // Called by Bullet when a profile zone is left.
+    static void leaveProfileZone();
+};
@@ -10,19 +10,56 @@
 
 #include <glad/glad.h>
 
+#include "UniformId.h"
+
 
 std::string readFileAsString(const std::string &fileName);
 
+// The variants a program may be built in. One variant is selected for every program at once.
+enum class ProgramVariant
+{
+    // The program as it was loaded.
+    DEFAULT,
+
+    // The program with a geometry shader that voxelizes each triangle in a single pass.
+    VOXELIZE,
+
+    COUNT,
+};
+
 class Program
 {
 
 public:
 
+    Program();
+    virtual ~Program();
+
     void setVerbose(const bool v) { verbose = v; }
     bool isVerbose() const { return verbose; }
 
     void setShaderNames(const std::string &v, const std::string &f);
     void setShaderNames(const std::string &v, const std::vector<std::string> &f);
+
+    // Adds a geometry shader between the vertex and fragment shaders. The outputs of the vertex shader are
+    // passed through to the fragment shader under the same names, declared by the VERTEX_OUTPUTS macro and
+    // copied for a given input vertex by the COPY_VERTEX_OUTPUTS(i) macro.
+    void setGeometryShaderName(const std::string &g);
+
+    // Adds a file whose source is inserted after the #version directive of every shader stage, so that
+    // declarations shared between stages, like uniform blocks, are written once.
+    void addIncludeName(const std::string &i);
+
+    // Gives the program a variant, used in its place while that variant is selected. The program takes ownership
+    // of the variant, which must have been initialized. Attributes and uniforms added afterwards are added to both.
+    void setVariant(ProgramVariant variant, Program* pProgram);
+
+    // Returns the given variant of the program, or nullptr if it has none. The default variant is the program itself.
+    Program* getVariant(ProgramVariant variant) const;
+
+    // Selects the variant bound by every program from now on, for those that have it.
+    static void selectVariant(ProgramVariant variant);
+
     virtual bool init();
     virtual void bind();
     virtual void unbind();
@@ -31,6 +68,7 @@ public:
     void addUniform(const std::string &name);
     GLint getAttribute(const std::string &name) const;
     GLint getUniform(const std::string &name) const;
+    GLint getUniform(UniformId id) const { return getSelectedVariant().uniformTable[(unsigned)id]; }
     GLuint getPid() const;
 
     void* getUserPointer() const { return userPointer; }
@@ -40,12 +78,25 @@ protected:
 
     std::string vShaderName;
     std::vector<std::string> fShaderNames;
+    std::string gShaderName;
+    std::vector<std::string> includeNames;
 
 private:
 
+    // Returns the variant that is currently selected, or the program itself if it doesn't have that variant.
+    const Program& getSelectedVariant() const
+    {
+        const Program* pVariant = variants[(unsigned)selectedVariant];
+        return pVariant ? *pVariant : *this;
+    }
+
+    static ProgramVariant selectedVariant;
+
+    Program* variants[(unsigned)ProgramVariant::COUNT] = {};
     GLuint pid = 0;
     std::map<std::string, GLint> attributes;
     std::map<std::string, GLint> uniforms;
+    GLint uniformTable[(unsigned)UniformId::COUNT];
     bool verbose = true;
     void* userPointer = nullptr;
 };
@@ -1,7 +1,37 @@
 #pragma once
 
+#include <cstdint>
+
+#include "Program.h"
+
+// Flags stored in a shader program's user pointer describing how it should be used.
 enum class ProgramMetadata
 {
     NONE = 0,
     USES_DYNAMIC_OUTPUT = 1,
+    USES_DRAW_DATA = 2,
 };
+
+// Bitwise ORs two metadata flags together, returning the resulting ProgramMetadata.
+inline ProgramMetadata operator|(ProgramMetadata lhs, ProgramMetadata rhs)
+{
+    return static_cast<ProgramMetadata>(static_cast<unsigned>(lhs) | static_cast<unsigned>(rhs));
+}
+
+// Returns the metadata flags of the given shader program.
+inline ProgramMetadata getProgramMetadata(const Program* pProgram)
+{
+    return (ProgramMetadata)(uintptr_t)pProgram->getUserPointer();
+}
+
+// Adds the given metadata flags to the given shader program.
+inline void addProgramMetadata(Program* pProgram, ProgramMetadata metadata)
+{
+    pProgram->setUserPointer((void*)(uintptr_t)(getProgramMetadata(pProgram) | metadata));
+}
+
+// Returns true if the given shader program has all of the given metadata flags.
+inline bool hasProgramMetadata(const Program* pProgram, ProgramMetadata metadata)
+{
+    return ((unsigned)getProgramMetadata(pProgram) & (unsigned)metadata) == (unsigned)metadata;
+}
@@ -1,7 +1,9 @@
 #pragma once
 
+// What a program's fragments are written to. Must match the OUTPUT_MODE values in view_uniforms.glsl.
 enum class ProgramOutputMode
 {
     STATIC = 0,
     DYNAMIC = 1,
+    VOXELIZE = 2,
 };
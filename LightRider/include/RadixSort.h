@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Stably sorts the given items in ascending order of the unsigned integer key returned by getKey, using a
+// least significant digit radix sort over 8-bit digits. Digits that are identical across every item are
+// skipped. The buffer is used as scratch space, and is kept by the caller to avoid reallocating it.
+template<typename T, typename KeyFunc>
+void radixSort(std::vector<T>& items, std::vector<T>& buffer, int keyBits, KeyFunc getKey)
+{
+    if (items.empty())
+        return;
+
+    buffer.resize(items.size());
+
+    for (int shift = 0; shift < keyBits; shift += 8)
+    {
+        size_t counts[256] = {};
+
+        for (const T& item : items)
+            counts[(uint64_t)getKey(item) >> shift & 0xFF]++;
+
+        // Every item has the same digit, so this pass would not change the order.
+        if (counts[(uint64_t)getKey(items[0]) >> shift & 0xFF] == items.size())
+            continue;
+
+        size_t offset = 0;
+
+        for (size_t& count : counts)
+        {
+            size_t digitCount = count;
+            count = offset;
+            offset += digitCount;
+        }
+
+        for (const T& item : items)
+            buffer[counts[(uint64_t)getKey(item) >> shift & 0xFF]++] = item;
+
+        items.swap(buffer);
+    }
+}
@@ -1,11 +1,34 @@
 #pragma once
 
-#include <functional>
-
 #include "Program.h"
 
+// Identifies the passes a Renderable takes part in.
+enum class DrawPass : unsigned
+{
+    NONE = 0,
+    PRIMARY = 1,
+    VOXEL_STATIC = 2,
+    SHADOW_DEPTH = 4,
+    SHADOW_DETAILED = 8,
+    SHADOW = 12,
+    VOXEL_DYNAMIC = 16,
+    VOXEL = 18,
+};
+
+// Bitwise ORs two draw passes together, returning the resulting DrawPass.
+inline DrawPass operator|(DrawPass lhs, DrawPass rhs)
+{
+    return static_cast<DrawPass>(static_cast<unsigned>(lhs) | static_cast<unsigned>(rhs));
+}
+
+// Bitwise ANDs two draw passes together, returning the result as an unsigned integer.
+inline unsigned operator&(DrawPass lhs, DrawPass rhs)
+{
+    return static_cast<unsigned>(lhs) & static_cast<unsigned>(rhs);
+}
+
 struct RenderConfiguration
 {
-    std::function<bool(Program*)> canUseShader;
-    std::function<void(Program*)> configureShader;
+    // The pass being rendered. Renderables that do not take part in it are skipped.
+    DrawPass pass;
 };
@@ -4,18 +4,23 @@
 #include "Camera.h"
 #include "Program.h"
 
+class DrawBatch;
+class Shape;
+
 // A base Component that exposes render functionality.
 class Renderable : public Component
 {
 public:
-    // Instantiates a new Renderable instance, adding it to the scene's asset manager render tree.
+    // Instantiates a new Renderable instance, adding it to the scene's asset manager draw list.
     Renderable(
         const std::string& shaderProgramId,
         const std::string& imageTextureId,
         bool useBlending = false,
-        bool useDetailedShadows = false);
+        bool useDetailedShadows = false,
+        const std::string& depthProgramId = "",
+        bool isStatic = false);
 
-    // Destroys a Renderable instance, removing it from the scene's asset manager render tree.
+    // Destroys a Renderable instance, removing it from the scene's asset manager draw list.
     virtual ~Renderable();
 
     // Gets the ID of the shader program used.
@@ -24,8 +29,12 @@ public:
     // Gets the ID of the image texture used.
     const std::string& getImageTextureId() const { return m_imageTextureId; }
 
+    // Gets the ID of the program used to render the Renderable to depth-only passes, or an empty string if
+    // the pass's own depth program should be used.
+    const std::string& getDepthProgramId() const { return m_depthProgramId; }
+
     // Gets the ID of the normal texture used.
-    virtual const std::string& getNormalTextureId() const { return ""; }
+    virtual const std::string& getNormalTextureId() const { static const std::string none; return none; }
 
     // If true, the renderable uses alpha blending and will be added to the dynamic render tree.
     bool usesBlending() { return m_useBlending; }
@@ -33,15 +42,33 @@ public:
     // If true, the renderable uses detailed shadows using its specified shader rather than the depth pass shader.
     bool usesDetailedShadows() { return m_useDetailedShadows; }
 
+    // If true, the renderable never moves or changes shape, so its shadows and voxels are cached between frames.
+    bool isStatic() const { return m_isStatic; }
+
+    // Returns the mesh drawn by the Renderable, used to group draws of the same mesh. May be nullptr.
+    virtual const Shape* getMesh() const { return nullptr; }
+
+    // Gets the world-space bounding box of the Renderable. Returns false if the Renderable has no bounds,
+    // in which case it is never culled.
+    virtual bool getWorldBounds(glm::vec3& min, glm::vec3& max) const { return false; }
+
     // Renders the Renderable.
     virtual void render() = 0;
 
+    // Adds the Renderable to the given batch so that it is drawn when the batch is submitted, using the
+    // currently bound program. Returns false if the Renderable must be drawn individually with render().
+    virtual bool addToBatch(DrawBatch& batch) { return false; }
+
     // Renders the Renderable to a depth buffer given the shader program to do so.
     virtual bool renderDepth(Program* pDepthProgram) { return false; }
 
     // Returns the depth of the object relative to the camera provided.
     virtual float getDepth(Camera* pCamera) const;
 
+    // Returns a value that orders the object by depth relative to the camera provided, without needing
+    // to be the depth itself. Defaults to the squared distance, which avoids a square root.
+    virtual float getSortDepth(Camera* pCamera) const;
+
 private:
 
     // The shader program ID.
@@ -54,4 +81,10 @@ private:
     bool m_useBlending;
 
     bool m_useDetailedShadows;
+
+    // The ID of the program used to render depth-only passes.
+    std::string m_depthProgramId;
+
+    // If true, the renderable never moves or changes shape.
+    bool m_isStatic;
 };
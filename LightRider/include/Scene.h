@@ -10,6 +10,8 @@
 #include "ContactHandler.h"
 #include "Camera.h"
 #include "DebugDrawer.h"
+#include "PhysicsProfiler.h"
+#include "ShadowMapService.h"
 
 class Scene
 {
@@ -32,6 +34,12 @@ public:
     // Returns the physics simulation world.
     btDynamicsWorld* getDynamicsWorld() const { return m_pDynamicsWorld; }
 
+    // Returns the profiler collecting per-tick physics statistics.
+    PhysicsProfiler* getPhysicsProfiler() const { return m_pPhysicsProfiler; }
+
+    // Returns the scene's shared shadow map, creating it on first use.
+    ShadowMapService* getShadowMapService();
+
     // Returns the Scene's active camera. This will be null except during the render stage.
     Camera* getActiveCamera() const { return m_pActiveCamera; };
 
@@ -117,6 +125,12 @@ private:
     // Draws the simulation world when in debug mode.
     DebugDrawer* m_pDebugDrawer;
 
+    // Collects per-tick physics statistics.
+    PhysicsProfiler* m_pPhysicsProfiler;
+
+    // Renders sun shadows once per frame for every camera that samples them. Null until first requested.
+    ShadowMapService* m_pShadowMapService;
+
     // Invokes collision callbacks for all RigidBodyComponents in the world.
     void invokeCollisionCallbacks();
 
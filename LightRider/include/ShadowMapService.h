@@ -0,0 +1,180 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "Program.h"
+#include "UniformBuffer.h"
+#include "GLState.h"
+
+class Camera;
+struct DrawItem;
+
+// A view of the sun covering one slice of a camera's view frustum.
+struct ShadowCascade
+{
+    // The world-space center of the sphere bounding the slice, snapped to the cascade's texel grid.
+    glm::vec3 center;
+
+    // The radius of the sphere bounding the slice.
+    float radius;
+
+    // The projection matrix of the sun.
+    glm::mat4 pMatrix;
+
+    // The view matrix of the sun.
+    glm::mat4 vMatrix;
+
+    // The PV matrix of the sun.
+    glm::mat4 pvMatrix;
+};
+
+// The shadow cascades rendered for one or more cameras, each stored in its own layer of the shared shadow map.
+struct ShadowView
+{
+    // The cascades of the view, from nearest to farthest.
+    ShadowCascade cascades[SHADOW_CASCADE_COUNT];
+
+    // The shadow map layer holding the nearest cascade. The other cascades follow it in order.
+    int firstLayer;
+};
+
+// Renders sun shadows once per frame into a shadow map array shared by every camera in the scene. Each
+// distinct view gets a set of cascades fitted to its camera's frustum, and cameras whose cascades nearly
+// coincide share a view. Static casters are cached in a separate array that is only re-rendered when a
+// cascade moves, and each frame only dynamic casters are drawn over a copy of it.
+class ShadowMapService
+{
+public:
+
+    // Creates a new ShadowMapService instance.
+    ShadowMapService();
+
+    // Destroys the ShadowMapService instance.
+    ~ShadowMapService();
+
+    // Forgets the views of the previous frame.
+    void beginFrame();
+
+    // Fits cascades to the given camera's frustum and adds them as a view, or shares an existing view if
+    // its cascades are close enough.
+    void addView(const Camera* pCamera);
+
+    // Assigns each view its shadow map layers and renders every cascade.
+    void render();
+
+    // Gets the view used by the given camera during the current frame, or nullptr if it has none.
+    const ShadowView* getView(const Camera* pCamera) const;
+
+    // Gets the shared shadow map array texture ID.
+    GLuint getDepthTexture() const { return m_depthTexture; }
+
+    // Gets the state changes issued by the most recent shadow pass.
+    const GLStateStats& getStats() const { return m_stats; }
+
+private:
+
+    // The cascade a layer of the static shadow map was last rendered for.
+    struct StaticShadowLayer
+    {
+        // If false, the layer holds nothing and must be rendered.
+        bool isValid;
+
+        // The PV matrix the layer was rendered with.
+        glm::mat4 pvMatrix;
+
+        // The static revision of the asset manager when the layer was rendered.
+        unsigned staticRevision;
+    };
+
+    // The width and height of each cascade.
+    static constexpr GLsizei CASCADE_SIZE = 2048;
+
+    // The maximum number of views.
+    static constexpr int MAX_VIEWS = 4;
+
+    // The number of texels a cascade moves by at a time. Larger steps re-render static casters less often,
+    // but pad each cascade more to keep its slice covered in between.
+    static constexpr int CASCADE_STEP_TEXELS = 64;
+
+    // The distance from the camera that cascades cover.
+    static constexpr float SHADOW_DISTANCE = 80.0f;
+
+    // Blends between uniform (0) and logarithmic (1) cascade splits.
+    static constexpr float SPLIT_LAMBDA = 0.8f;
+
+    // The largest offset between two views' cascade centers, relative to the cascade radius, at which the
+    // views are shared.
+    static constexpr float VIEW_MERGE_TOLERANCE = 0.1f;
+
+    // The shader used to render objects that cast shadows.
+    Program* m_pShadowShader;
+
+    // The frame buffer each cascade is rendered through.
+    GLuint m_frameBuffer;
+
+    // The shadow map array texture, with one layer per cascade of each view.
+    GLuint m_depthTexture;
+
+    // The shadow map array texture holding only static casters, matching the layers of m_depthTexture.
+    GLuint m_staticDepthTexture;
+
+    // The cascade each layer of the static shadow map was rendered for.
+    std::vector<StaticShadowLayer> m_staticLayers;
+
+    // The number of layers allocated in the shadow map array.
+    int m_layerCount;
+
+    // The "ViewUniforms" blocks used for each cascade.
+    UniformBuffer m_viewUniformBuffer;
+
+    // The views of the current frame.
+    std::vector<ShadowView> m_views;
+
+    // The index of the view used by each camera during the current frame.
+    std::unordered_map<const Camera*, int> m_cameraViews;
+
+    // If true, running out of views has already been reported.
+    bool m_hasReportedViewOverflow;
+
+    // The visibility of each culling bounds slot in the cascade being rendered.
+    std::vector<uint8_t> m_visibility;
+
+    // The shadow casters drawn with their own depth program, gathered for the cascade being rendered.
+    std::vector<const DrawItem*> m_depthProgramCasters;
+
+    // The shadow casters drawn with their full shader program, gathered for the cascade being rendered.
+    std::vector<const DrawItem*> m_detailedCasters;
+
+    // The state changes issued by the most recent shadow pass.
+    GLStateStats m_stats;
+
+    // The number of shadow passes rendered since the last stats report.
+    int m_statsFrameCount;
+
+    // Grows both shadow map arrays to hold at least the given number of layers, discarding the static cache.
+    void reserveLayers(int layerCount);
+
+    // Fits a cascade to the slice of the camera's frustum between the given view distances.
+    void fitCascade(const Camera* pCamera, float sliceNear, float sliceFar, ShadowCascade& cascade) const;
+
+    // Culls against the given cascade and renders it into the given shadow map layer, re-rendering the
+    // layer's static casters first if the cascade has moved since they were cached.
+    void renderCascade(const ShadowCascade& cascade, int layer);
+
+    // Renders either the static or the dynamic visible shadow casters into the attached layer. Casters that
+    // share the shadow shader are drawn first, then the rest grouped by program.
+    void renderCasters(bool renderStatic);
+
+    // Renders either the static or the dynamic visible shadow casters in draw list order, swapping programs
+    // between runs, as the shadow pass did before casters were grouped. Only used to compare the two with
+    // groupShadowCasters.
+    void renderUngroupedCasters(bool renderStatic);
+
+    // Renders the given shadow casters grouped by program, using each caster's depth program if
+    // useDepthPrograms is true, or its full shader program otherwise.
+    void renderCasterGroup(std::vector<const DrawItem*>& casters, bool useDepthPrograms);
+};
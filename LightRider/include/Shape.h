@@ -8,12 +8,15 @@
 
 #include <string>
 #include <vector>
-#include <unordered_set>
 #include <memory>
 #include <iostream>
 #include <assert.h>
 
 #include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "GLState.h"
+#include "GeometryArena.h"
 
 
 class Program;
@@ -22,15 +25,33 @@ class Shape
 {
 
 public:
+    // Fixed vertex attribute locations shared by every shader that draws a Shape.
+    static constexpr GLuint POSITION_LOCATION = 0;
+    static constexpr GLuint NORMAL_LOCATION = 1;
+    static constexpr GLuint TEXTURE_LOCATION = 2;
+    static constexpr GLuint INSTANCE_DATA_LOCATION = 3;
+
     //stbi_load(char const *filename, int *x, int *y, int *comp, int req_comp)
     void loadMesh(const std::string &meshName, std::string *mtlName = NULL, unsigned char *(loadimage)(char const *, int *, int *, int *, int) = NULL);
-    void init();
+    // Uploads the shape to the GPU, packing it into the given arena if there is room.
+    void init(GeometryArena* pArena = nullptr);
     void resize();
     void draw(const Program* prog) const;
     void drawDepth(const Program* prog) const;
     bool usesInstancing() const { return instanceBufID != nullptr; }
     const std::vector<float>& getVertices(int shapeId) const { return posBuf[shapeId]; }
     const std::vector<unsigned int>& getIndices(int shapeId) const { return eleBuf[shapeId]; }
+    int getObjectCount() const { return obj_count; }
+    bool isInArena() const { return inArena; }
+    const GeometryRange& getGeometryRange(int shapeId) const { return geometryRanges[shapeId]; }
+    GLuint getInstanceBuffer(int shapeId) const { return instanceBufID[shapeId]; }
+    GLsizeiptr getInstanceCount() const { return instanceCount; }
+    // Draws instanced objects from the given indirect buffer, holding one command per object, instead of
+    // drawing every instance. Pass 0 to draw every instance again.
+    void setIndirectBuffer(GLuint buffer) { indirectBufID = buffer; }
+    // Local-space bounds of every object in the shape, valid after init().
+    const glm::vec3& getBoundsMin() const { return boundsMin; }
+    const glm::vec3& getBoundsMax() const { return boundsMax; }
 
     template<typename T>
     void generateInstanceData(int length, GLsizeiptr size, GLenum type, const T* data)
@@ -39,33 +60,45 @@ public:
 
         instanceBufID = new unsigned int[obj_count];
         instanceCount = length;
-        instanceElementSize = sizeof(T);
-        instanceElementType = type;
-        instanceElementComponentCount = size;
 
         for (int i = 0; i < obj_count; i++)
         {
-            glBindVertexArray(vaoID[i]);
-
             glGenBuffers(1, &instanceBufID[i]);
             glBindBuffer(GL_ARRAY_BUFFER, instanceBufID[i]);
             glBufferData(GL_ARRAY_BUFFER, length * sizeof(T), data, GL_STATIC_DRAW);
 
+            // The instance data is fed through its own binding so the VAO never needs to change per program.
+            GLState::bindVertexArray(vaoID[i]);
+            glBindVertexBuffer(INSTANCE_BINDING, instanceBufID[i], 0, sizeof(T));
+            glVertexAttribFormat(INSTANCE_DATA_LOCATION, (GLint)size, type, GL_FALSE, 0);
+            glVertexAttribBinding(INSTANCE_DATA_LOCATION, INSTANCE_BINDING);
+            glVertexBindingDivisor(INSTANCE_BINDING, 1);
+            glEnableVertexAttribArray(INSTANCE_DATA_LOCATION);
+
+#ifndef DISABLE_OPENGL_ERROR_CHECKS
             int error = glGetError();
 
             if (error)
             {
                 std::cerr << "Error when generating instance data: " << error << std::endl;
             }
+#endif
 
+            GLState::bindVertexArray(0);
             glBindBuffer(GL_ARRAY_BUFFER, 0);
-            glBindVertexArray(0);
         }
     }
 
     unsigned int *textureIDs = NULL;
 
 private:
+    // Vertex buffer binding indices used by each VAO.
+    static constexpr GLuint VERTEX_BINDING = 0;
+    static constexpr GLuint INSTANCE_BINDING = 1;
+
+    // Draws a single object, instanced or indirectly if the shape is set up for it.
+    void drawObject(int i) const;
+
     int obj_count = 0;
     std::vector<unsigned int> *eleBuf = NULL;
     std::vector<float> *posBuf = NULL;
@@ -74,20 +107,17 @@ private:
     void** instanceBuf = NULL;
     unsigned int *materialIDs = NULL;
     GLsizeiptr instanceCount = 0;
-    GLsizeiptr instanceElementComponentCount = 0;
-    GLsizeiptr instanceElementSize = 0;
-    GLenum instanceElementType = 0;
-    mutable std::unordered_set<GLuint> instancedPrograms;
+    std::vector<GeometryRange> geometryRanges;
+    bool inArena = false;
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
 
 
     unsigned int *eleBufID = 0;
-    unsigned int *posBufID = 0;
-    unsigned int *norBufID = 0;
-    unsigned int *texBufID = 0;
+    unsigned int *vertexBufID = 0;
     unsigned int *instanceBufID = 0;
     unsigned int *vaoID = 0;
-
-    void drawInstanced(int shapeId, const Program* prog) const;
+    GLuint indirectBufID = 0;
 };
 
 #endif // LAB471_SHAPE_H_INCLUDED
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <chrono>
+#include <glm/glm.hpp>
+
+#include "Scenes/LightRiderScene.h"
+#include "UniformBuffer.h"
+
+// A microbenchmark that issues a large number of individual shape draws each frame,
+// reporting the average CPU submission time and GPU time per draw.
+class DrawBenchmarkScene : public LightRiderScene
+{
+public:
+
+    // Creates a new DrawBenchmarkScene instance.
+    DrawBenchmarkScene(int drawCount = 10000, int reportInterval = 120);
+
+    // Destroys the DrawBenchmarkScene instance.
+    virtual ~DrawBenchmarkScene();
+
+    virtual void initialize();
+
+    virtual void render();
+
+private:
+
+    typedef std::chrono::high_resolution_clock Clock;
+
+    // The number of draws issued each frame.
+    int m_drawCount;
+
+    // The number of frames averaged before each report.
+    int m_reportInterval;
+
+    // The number of frames measured since the last report.
+    int m_frameCount;
+
+    // The total CPU submission time since the last report, in milliseconds.
+    double m_cpuTime;
+
+    // The total GPU time since the last report, in milliseconds.
+    double m_gpuTime;
+
+    // The number of frames since the last report whose timer query result was read. Frames whose result
+    // wasn't available yet aren't part of m_gpuTime.
+    int m_gpuTimedFrameCount;
+
+    // The timer queries used to measure GPU time. Two are used so the previous frame's result
+    // can be read without stalling.
+    GLuint m_timerQueries[2];
+
+    // The index of the timer query used in the current frame.
+    int m_currentQuery;
+
+    // If true, the other timer query has been issued and its result can be read.
+    bool m_hasPreviousQuery;
+
+    // The "ViewUniforms" block used for every draw.
+    UniformBuffer m_viewUniformBuffer;
+};
@@ -18,21 +18,30 @@ class Texture
 public:
 
     // Creates a new Texture instance.
-    Texture() : m_textureId(0), m_textureType(TextureType::NONE), m_width(0), m_height(0) { }
+    Texture() : m_textureId(0), m_textureType(TextureType::NONE), m_target(GL_TEXTURE_2D), m_width(0), m_height(0), m_depth(0) { }
 
     // Initializes the texture from the give file name and sepcified texture type.
     void init(std::string fileName, TextureType textureType);
 
+    // Initializes the texture as an empty, repeating cubic 3D texture with the given dimension and internal format.
+    // The contents are expected to be written by a compute shader.
+    void initVolume(int dimension, GLenum internalFormat);
+
     // Returns the ID of this texture.
     GLuint getTextureId() const { return m_textureId; }
 
     // Returns the type of this texture.
     TextureType getTextureType() const { return m_textureType; }
 
+    // Returns the OpenGL target this texture is bound to (GL_TEXTURE_2D or GL_TEXTURE_3D).
+    GLenum getTarget() const { return m_target; }
+
     int getWidth() const { return m_width; }
 
     int getHeight() const { return m_height; }
 
+    int getDepth() const { return m_depth; }
+
 private:
 
     // The ID of the texture.
@@ -41,7 +50,12 @@ private:
     // The type of the texture.
     TextureType m_textureType;
 
+    // The OpenGL target of the texture.
+    GLenum m_target;
+
     int m_width;
 
     int m_height;
+
+    int m_depth;
 };
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/gtc/type_ptr.hpp>
+
+// The fixed binding points of the uniform blocks shared between shaders.
+enum class UniformBlockBinding : GLuint
+{
+    VIEW = 0,
+    CAMERA = 1,
+};
+
+// The number of shadow cascades rendered for each camera. Must match the "CameraUniforms" block in view_uniforms.glsl.
+constexpr int SHADOW_CASCADE_COUNT = 4;
+
+// Mirrors the std140 "ViewUniforms" block in view_uniforms.glsl, which changes with every render pass.
+struct ViewUniforms
+{
+    // The projection matrix of the pass.
+    glm::mat4 projectionMatrix;
+
+    // The view matrix of the pass.
+    glm::mat4 viewMatrix;
+
+    // The ProgramOutputMode of the pass.
+    GLint outputMode;
+
+    // The world-space size of a voxel in the voxel volume being written, if any.
+    GLfloat voxelSize;
+
+    // The number of voxels along each axis of the voxel volume being written, if any.
+    GLint voxelDimension;
+
+    // If nonzero, voxels are written to a single packed volume rather than one volume per component.
+    GLint isVoxelMapPacked;
+
+    // The grid coordinates of the first voxel the pass may write (w is unused).
+    glm::ivec4 voxelRegionMin;
+
+    // The grid coordinates just past the last voxel the pass may write (w is unused).
+    glm::ivec4 voxelRegionMax;
+};
+
+static_assert(sizeof(ViewUniforms) == 176, "ViewUniforms must match the std140 layout of the block in view_uniforms.glsl.");
+
+// Mirrors the std140 "CameraUniforms" block in view_uniforms.glsl, which is shared by every pass of a camera's frame.
+struct CameraUniforms
+{
+    // The PV matrix of the sun for each shadow cascade, from nearest to farthest.
+    glm::mat4 lightPvMatrices[SHADOW_CASCADE_COUNT];
+
+    // The shadow map layer holding the camera's nearest cascade. The other cascades follow it in order.
+    GLint shadowLayer;
+
+    // Aligns the next member to 16 bytes, as required by std140.
+    GLint padding[3];
+
+    // The world-space position of the camera (w is unused).
+    glm::vec4 cameraPosition;
+
+    // The world-space center of the voxel light map (w is unused).
+    glm::vec4 voxelCenterPosition;
+};
+
+static_assert(sizeof(CameraUniforms) == 304, "CameraUniforms must match the std140 layout of the block in view_uniforms.glsl.");
+
+// Encapsulates an OpenGL uniform buffer object holding one or more copies ("slots") of a uniform block.
+// Passes that render several views in a row use one slot each so that no slot is overwritten while in use.
+class UniformBuffer
+{
+public:
+
+    // Creates a new UniformBuffer instance with the given block size in bytes and number of slots.
+    UniformBuffer(GLsizeiptr size, int slotCount = 1);
+
+    // Destroys the UniformBuffer instance.
+    ~UniformBuffer();
+
+    // Returns the ID of the buffer.
+    GLuint getBufferId() const { return m_buffer; }
+
+    // Replaces the contents of the given slot.
+    void update(const void* pData, int slot = 0);
+
+    // Binds the given slot to the given uniform block binding point.
+    void bind(UniformBlockBinding binding, int slot = 0) const;
+
+private:
+
+    // The ID of the buffer.
+    GLuint m_buffer;
+
+    // The size of the uniform block in bytes.
+    GLsizeiptr m_size;
+
+    // The distance between the start of each slot in bytes, respecting the uniform buffer offset alignment.
+    GLsizeiptr m_slotStride;
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Computes the FNV-1a hash of a uniform name. Usable at compile time.
+constexpr uint32_t hashUniformName(const char* name, uint32_t hash = 2166136261u)
+{
+    return *name ? hashUniformName(name + 1, (hash ^ (uint32_t)(unsigned char)*name) * 16777619u) : hash;
+}
+
+// Identifies the uniforms that are set on hot draw paths. A Program resolves the location of each of these
+// once, when the uniform is added, so that draws can fetch it by index rather than by name.
+enum class UniformId : unsigned
+{
+    M,
+    PLAYER_ID,
+    NOISE_SEED,
+    CURRENT_TIME,
+    USE_NOISE_VOLUME,
+    BLOOM_FACTOR,
+    COUNT,
+};
+
+// The shader name of each UniformId, in enum order.
+constexpr const char* uniformIdNames[] =
+{
+    "M",
+    "playerId",
+    "noiseSeed",
+    "currentTime",
+    "useNoiseVolume",
+    "bloomFactor",
+};
+
+// The hashed shader name of each UniformId, in enum order.
+constexpr uint32_t uniformIdHashes[] =
+{
+    hashUniformName("M"),
+    hashUniformName("playerId"),
+    hashUniformName("noiseSeed"),
+    hashUniformName("currentTime"),
+    hashUniformName("useNoiseVolume"),
+    hashUniformName("bloomFactor"),
+};
+
+static_assert(sizeof(uniformIdNames) / sizeof(uniformIdNames[0]) == (size_t)UniformId::COUNT,
+    "Every UniformId must have a name.");
+static_assert(sizeof(uniformIdHashes) / sizeof(uniformIdHashes[0]) == (size_t)UniformId::COUNT,
+    "Every UniformId must have a hash.");
+
+// Returns the UniformId with the given shader name, or UniformId::COUNT if the name has no UniformId.
+UniformId findUniformId(const std::string& name);
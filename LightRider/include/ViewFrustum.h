@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/gtc/type_ptr.hpp>
+
+// A list of axis-aligned bounding boxes stored as one array per component, so that a frustum can test
+// four boxes at a time. The arrays are padded with empty boxes to a multiple of four.
+struct AabbList
+{
+    std::vector<float> minX;
+    std::vector<float> minY;
+    std::vector<float> minZ;
+    std::vector<float> maxX;
+    std::vector<float> maxY;
+    std::vector<float> maxZ;
+
+    // Returns the number of boxes in the list, excluding padding.
+    size_t size() const { return count; }
+
+    // Resizes the list to hold the given number of boxes. New boxes are empty.
+    void resize(size_t newCount);
+
+    // Sets the bounds of the box at the given index.
+    void set(size_t index, const glm::vec3& min, const glm::vec3& max);
+
+    // Makes the box at the given index empty, so that it is outside of every frustum.
+    void setEmpty(size_t index);
+
+    // The number of boxes in the list, excluding padding.
+    size_t count = 0;
+};
+
+// A convex volume bounded by six planes, used to cull geometry that falls outside of a render pass.
+class ViewFrustum
+{
+public:
+
+    // Creates a new ViewFrustum instance that contains all points.
+    ViewFrustum();
+
+    // Creates a new ViewFrustum instance from the given projection-view matrix.
+    ViewFrustum(const glm::mat4& pvMatrix);
+
+    // Creates a new ViewFrustum instance bounding the given axis-aligned box.
+    ViewFrustum(const glm::vec3& min, const glm::vec3& max);
+
+    // Returns the six frustum planes, where xyz is the inward-facing normal and w is the plane distance.
+    const glm::vec4* getPlanes() const { return m_planes; }
+
+    // Returns true if the given axis-aligned bounding box is at least partially inside the frustum.
+    bool intersectsAabb(const glm::vec3& min, const glm::vec3& max) const;
+
+    // Tests every box in the given list against the frustum, setting the matching element of the results
+    // to 1 if the box is at least partially inside the frustum, or 0 otherwise.
+    void intersectAabbs(const AabbList& boxes, std::vector<uint8_t>& results) const;
+
+private:
+
+    // The frustum planes, where xyz is the inward-facing normal and w is the plane distance.
+    glm::vec4 m_planes[6];
+};
@@ -11,8 +11,8 @@ in vec3 vertex_pos;
 in vec2 vertex_tex;
 in vec3 vertex_pos_raw;
 
-uniform int playerId;
-uniform float transitionAmount;
+flat in int playerId;
+flat in float transitionAmount;
 
 uniform sampler2D texture0;
 
@@ -7,7 +7,7 @@ in vec2 vertex_tex;
 const vec4 player1Accent = vec4(0.1, 0.5, 1, 1);
 const vec4 player2Accent = vec4(1, 0.5, 0.1, 1);
 
-uniform int playerId;
+flat in int playerId;
 uniform sampler2D texture0;
 
 void main()
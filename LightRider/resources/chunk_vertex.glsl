@@ -3,16 +3,19 @@ layout(location = 0) in vec3 vertexPosition;
 layout(location = 1) in vec3 vertexNormal;
 layout(location = 2) in vec2 vertexTexture;
 
-uniform mat4 P;
-uniform mat4 V;
-uniform mat4 M;
+// Selects this draw's entry in _drawData. Each indirect command's base instance picks the index.
+layout(location = 4) in uint drawIndex;
 
 out vec3 vertex_pos;
 out vec3 vertex_normal;
 out vec2 vertex_tex;
+flat out int playerId;
 
 void main()
 {
+	mat4 M = _drawData[drawIndex].model;
+	playerId = _drawData[drawIndex].playerId;
+
 	vertex_normal = vec4(M * vec4(vertexNormal ,0.0)).xyz;
 	vec4 tpos =  M * vec4(vertexPosition, 1.0);
 	vertex_pos = tpos.xyz;
@@ -4,8 +4,6 @@ layout(location = 1) in vec3 vertexNormal;
 layout(location = 2) in vec2 vertexTexture;
 layout(location = 3) in vec4 instanceData;
 
-uniform mat4 P;
-uniform mat4 V;
 uniform mat4 M;
 
 out vec3 vertex_pos;
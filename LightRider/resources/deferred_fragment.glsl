@@ -8,15 +8,12 @@ layout(location = 0) uniform sampler2D gColor;
 layout(location = 1) uniform sampler2D gPosition;
 layout(location = 2) uniform sampler2D gNormal;
 layout(location = 3) uniform isampler2D gMaterial;
-layout(location = 4) uniform sampler2D shadowMap;
+layout(location = 4) uniform sampler2DArray shadowMap;
 layout(location = 5) uniform sampler2D skyTexture;
 
-uniform vec3 campos;
-uniform mat4 lightPV;
-
 // Prototypes for externally-defined functions.
 bool computeSimpleMaterial(inout vec3 col, int mat);
-bool computeComplexMaterial(inout vec3 col, vec3 pos, vec3 norm, vec3 campos, mat4 lightPV, sampler2D shadowMap, sampler2D skyTexture, int mat);
+bool computeComplexMaterial(inout vec3 col, vec3 pos, vec3 norm, vec3 campos, mat4 lightPV[4], int shadowLayer, sampler2DArray shadowMap, sampler2D skyTexture, int mat);
 
 void main()
 {
@@ -32,7 +29,7 @@ void main()
     // Complex materials with lighting and shadows:
     vec3 fragPosition = texture(gPosition, texCoords).rgb;
     vec3 fragNormal = texture(gNormal, texCoords).rgb;
-    if (computeComplexMaterial(fragColor, fragPosition, fragNormal, campos, lightPV, shadowMap, skyTexture, materialId))
+    if (computeComplexMaterial(fragColor, fragPosition, fragNormal, _cameraPosition, _lightPV, _shadowLayer, shadowMap, skyTexture, materialId))
     {
         return;
     }
@@ -0,0 +1,15 @@
+// Per-draw data, written by DrawBatch to DRAW_DATA_STORAGE_BINDING. Inserted after the #version directive of every
+// stage of the programs that read it, so that the struct is written once. Must match DrawData in DrawBatch.h.
+struct DrawData
+{
+    mat4 model;
+    int playerId;
+    float transitionAmount;
+    float time;
+    float padding;
+};
+
+layout(std430, binding = 1) readonly buffer DrawDataBuffer
+{
+    DrawData _drawData[];
+};
@@ -0,0 +1,10 @@
+#version 430 core
+layout(location = 0) in vec3 vertexPosition;
+
+// Selects this draw's entry in _drawData. Each indirect command's base instance picks the index.
+layout(location = 4) in uint drawIndex;
+
+void main()
+{
+	gl_Position = P * V * _drawData[drawIndex].model * vec4(vertexPosition, 1.0);
+}
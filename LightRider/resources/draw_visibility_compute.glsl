@@ -0,0 +1,44 @@
+#version 450
+layout(local_size_x = 64) in;
+
+// Mirrors DrawElementsIndirectCommand in DrawBatch.h.
+struct DrawElementsIndirectCommand
+{
+	uint count;
+	uint instanceCount;
+	uint firstIndex;
+	int baseVertex;
+	uint baseInstance;
+};
+
+// The pending commands of a DrawBatch.
+layout(std430, binding = 0) buffer Commands
+{
+	DrawElementsIndirectCommand commands[];
+};
+
+// The culling bounds slot each command was added with.
+layout(std430, binding = 1) readonly buffer Slots
+{
+	uint slots[];
+};
+
+// 1 for each slot that may be visible, or 0 for each slot hidden behind the depth pyramid.
+layout(std430, binding = 2) readonly buffer Visibility
+{
+	uint visibility[];
+};
+
+uniform uint commandCount;
+
+void main()
+{
+	uint index = gl_GlobalInvocationID.x;
+
+	if (index >= commandCount)
+		return;
+
+	// Slots allocated after the test have no result, so they are drawn.
+	uint slot = slots[index];
+	commands[index].instanceCount = slot < visibility.length() ? visibility[slot] : 1u;
+}
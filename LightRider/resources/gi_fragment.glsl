@@ -14,9 +14,10 @@
 
 // Voxel constants
 #define VOXEL_CAMERA_SIZE 20.
-#define VOXEL_CAMERA_SIZE_INV (1. / VOXEL_CAMERA_SIZE)
 #define VOXEL_MAP_DIMENSION 128
-#define VOXEL_MAP_HALF_DIMENSION (VOXEL_MAP_DIMENSION / 2)
+#define VOXEL_MAP_MAX_MIP 7.
+#define VOXEL_SIZE (VOXEL_CAMERA_SIZE / VOXEL_MAP_DIMENSION)
+#define VOXEL_LEVEL_COUNT 3
 
 in vec2 texCoords;
 
@@ -27,12 +28,15 @@ layout(location = 0) uniform sampler2D gPosition;
 layout(location = 1) uniform sampler2D gNormal;
 layout(location = 2) uniform isampler2D gMaterial;
 layout(location = 3) uniform sampler2D noise;
-layout(location = 4) uniform sampler3D voxelMap;
+layout(location = 4) uniform sampler3D voxelMaps[VOXEL_LEVEL_COUNT];
 
 uniform mat4 view;
 uniform vec2 focalLength;
 uniform vec3 voxelCenterPosition;
 
+// The world-space minimum corner of each voxel map level.
+uniform vec3 voxelLevelMin[VOXEL_LEVEL_COUNT];
+
 float length2(vec3 v)
 {
     return dot(v, v);
@@ -196,35 +200,61 @@ float hbao(vec3 rand)
     return ao;
 }
 
-vec3 worldToVoxelCoordinates(vec3 pos)
+// Returns the finest level, no finer than the given one, that holds the position at least one of its voxels
+// away from its edges, or VOXEL_LEVEL_COUNT if none does.
+int findVoxelLevel(vec3 pos, int minLevel)
 {
-    pos -= voxelCenterPosition;
-    pos *= VOXEL_CAMERA_SIZE_INV;
-    pos += vec3(0.5);
+    for (int level = minLevel; level < VOXEL_LEVEL_COUNT; level++)
+    {
+        float voxelSize = VOXEL_SIZE * exp2(level);
+        vec3 levelPos = pos - voxelLevelMin[level];
 
-    return pos;
+        if (all(greaterThan(levelPos, vec3(voxelSize))) && all(lessThan(levelPos, vec3(voxelSize * (VOXEL_MAP_DIMENSION - 1)))))
+        {
+            return level;
+        }
+    }
+
+    return VOXEL_LEVEL_COUNT;
+}
+
+vec4 sampleVoxelMap(int level, vec3 pos, float mipLevel)
+{
+    // Levels are addressed toroidally and sampled with repeat wrapping, so world positions map directly to
+    // texture coordinates.
+    vec3 tc = pos / (VOXEL_CAMERA_SIZE * exp2(level));
+
+    switch (level)
+    {
+        case 0:
+            return textureLod(voxelMaps[0], tc, mipLevel);
+        case 1:
+            return textureLod(voxelMaps[1], tc, mipLevel);
+        default:
+            return textureLod(voxelMaps[2], tc, mipLevel);
+    }
 }
 
 vec3 traceCone(vec3 origin, vec3 dir, float angle)
 {
-    float voxelSize = float(VOXEL_CAMERA_SIZE) / float(VOXEL_MAP_DIMENSION);
-    float t = voxelSize*2; // Starting ray dist (to prevent self-intersection and improve performance)
+    float t = VOXEL_SIZE*2; // Starting ray dist (to prevent self-intersection and improve performance)
     vec4 color = vec4(0);
     for (int i = 0; i < 128; i++) {
         vec3 pos = origin + t*dir;
         float coneDiamater = t*2*tan(angle);
-        float mipLevel = min(7., log2(1 + coneDiamater/voxelSize));
-        vec3 voxelPos = worldToVoxelCoordinates(pos);
 
-		if (voxelPos.x < 0 || voxelPos.y < 0 || voxelPos.z < 0 ||
-			voxelPos.x > 1 || voxelPos.y > 1 || voxelPos.z > 1)
+        // Each level has half the resolution of the previous one, so wide cones move to coarser levels.
+        float mipLevel = log2(1 + coneDiamater/VOXEL_SIZE);
+        int level = findVoxelLevel(pos, min(int(mipLevel), VOXEL_LEVEL_COUNT - 1));
+
+		if (level == VOXEL_LEVEL_COUNT)
 		{
 			break;
 		}
 
-        vec4 sampleColor = textureLod(voxelMap, voxelPos, mipLevel);
+        vec4 sampleColor = sampleVoxelMap(level, pos, min(VOXEL_MAP_MAX_MIP, mipLevel - level));
         color += sampleColor * (1 - color.a) * log2(mipLevel + 1);
-        t += voxelSize;
+        t += VOXEL_SIZE * exp2(level);
         if (color.a >= 0.95) {
             break;
         }
@@ -258,7 +288,7 @@ vec4 voxelConeTracing(vec3 rand)
     indirectLight /= 5;
 
     float actualDistance = length(position - voxelCenterPosition);
-    float distanceFactor = max(0., 1. - (actualDistance * VOXEL_CAMERA_SIZE_INV * 2));
+    float distanceFactor = max(0., 1. - actualDistance / (VOXEL_CAMERA_SIZE * exp2(VOXEL_LEVEL_COUNT - 1) * 0.5));
 
     indirectLight *= distanceFactor;
 
@@ -0,0 +1,40 @@
+#version 450
+layout(local_size_x = 8, local_size_y = 8) in;
+
+// The primary depth buffer when building level 0, or the depth pyramid itself for later levels.
+layout(binding = 0) uniform sampler2D sourceDepth;
+
+// The level of sourceDepth to reduce, or -1 to copy the depth buffer into level 0.
+uniform int sourceLevel;
+
+layout(r32f, binding = 0) uniform writeonly image2D outMip;
+
+void main()
+{
+	ivec2 tc = ivec2(gl_GlobalInvocationID.xy);
+	ivec2 size = imageSize(outMip);
+
+	if (any(greaterThanEqual(tc, size)))
+		return;
+
+	if (sourceLevel < 0)
+	{
+		imageStore(outMip, tc, vec4(texelFetch(sourceDepth, tc, 0).r));
+		return;
+	}
+
+	// Take the farthest depth of a 3x3 footprint, so that odd source sizes are still fully covered.
+	ivec2 sourceSize = textureSize(sourceDepth, sourceLevel);
+	float depth = 0.0;
+
+	for (int y = 0; y < 3; y++)
+	{
+		for (int x = 0; x < 3; x++)
+		{
+			ivec2 sourceTc = min(tc * 2 + ivec2(x, y), sourceSize - 1);
+			depth = max(depth, texelFetch(sourceDepth, sourceTc, sourceLevel).r);
+		}
+	}
+
+	imageStore(outMip, tc, vec4(depth));
+}
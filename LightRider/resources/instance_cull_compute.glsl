@@ -0,0 +1,141 @@
+#version 450
+layout(local_size_x = 64) in;
+
+// Mirrors DrawElementsIndirectCommand.
+struct DrawCommand
+{
+	uint count;
+	uint instanceCount;
+	uint firstIndex;
+	int baseVertex;
+	uint baseInstance;
+};
+
+// Every instance of the shape, as (position, scale).
+layout(std430, binding = 0) readonly buffer Instances
+{
+	vec4 instances[];
+};
+
+// The instances that survive culling, read by the shape's instance vertex attribute.
+layout(std430, binding = 1) writeonly buffer VisibleInstances
+{
+	vec4 visibleInstances[];
+};
+
+// The indirect draw commands of the shape. Only the first command's instance count is written here.
+layout(std430, binding = 2) buffer DrawCommands
+{
+	DrawCommand commands[];
+};
+
+// Whether each instance was visible to the camera's previous occlusion test. Only used when occlusionPhase
+// is not zero.
+layout(std430, binding = 3) buffer VisibilityHistory
+{
+	uint history[];
+};
+
+uniform vec4 frustumPlanes[6];
+uniform mat4 M;
+uniform vec3 boundsMin;
+uniform vec3 boundsMax;
+uniform uint instanceCount;
+
+// 0 culls against the frustum only. 1 keeps the instances that were visible last time. 2 tests every instance
+// against the depth pyramid, updating the history, and keeps those newly revealed since phase 1.
+uniform int occlusionPhase;
+
+layout(binding = 0) uniform sampler2D depthPyramid;
+uniform mat4 pyramidPvMatrix;
+uniform vec2 pyramidSize;
+uniform int pyramidMipCount;
+
+// Must match isOccluded in occlusion_cull_compute.glsl.
+bool isOccluded(vec3 boxMin, vec3 boxMax)
+{
+	vec2 ndcMin = vec2(1.0);
+	vec2 ndcMax = vec2(-1.0);
+	float minDepth = 1.0;
+
+	for (int i = 0; i < 8; i++)
+	{
+		vec3 corner = mix(boxMin, boxMax, vec3(i & 1, (i >> 1) & 1, (i >> 2) & 1));
+		vec4 clip = pyramidPvMatrix * vec4(corner, 1.0);
+
+		// Boxes crossing the near plane can't be bounded on screen.
+		if (clip.w <= 0.0)
+			return false;
+
+		vec3 ndc = clip.xyz / clip.w;
+		ndcMin = min(ndcMin, ndc.xy);
+		ndcMax = max(ndcMax, ndc.xy);
+		minDepth = min(minDepth, ndc.z * 0.5 + 0.5);
+	}
+
+	vec2 uvMin = clamp(ndcMin * 0.5 + 0.5, 0.0, 1.0);
+	vec2 uvMax = clamp(ndcMax * 0.5 + 0.5, 0.0, 1.0);
+
+	// Pick the level at which the box covers at most two texels along each axis.
+	vec2 extent = (uvMax - uvMin) * pyramidSize;
+	int level = min(int(ceil(log2(max(max(extent.x, extent.y), 1.0)))), pyramidMipCount - 1);
+
+	ivec2 mipSize = textureSize(depthPyramid, level);
+	ivec2 texelMin = min(ivec2(uvMin * vec2(mipSize)), mipSize - 1);
+	ivec2 texelMax = min(ivec2(uvMax * vec2(mipSize)), mipSize - 1);
+
+	float maxDepth = 0.0;
+
+	for (int y = texelMin.y; y <= texelMax.y; y++)
+		for (int x = texelMin.x; x <= texelMax.x; x++)
+			maxDepth = max(maxDepth, texelFetch(depthPyramid, ivec2(x, y), level).r);
+
+	return minDepth > maxDepth;
+}
+
+void main()
+{
+	uint index = gl_GlobalInvocationID.x;
+
+	if (index >= instanceCount)
+		return;
+
+	vec4 instance = instances[index];
+
+	// Instanced vertices are placed at M * (vertex * scale) + position, matching container_vertex.glsl.
+	vec3 localCenter = (boundsMin + boundsMax) * 0.5 * instance.w;
+	vec3 localExtent = (boundsMax - boundsMin) * 0.5 * instance.w;
+
+	vec3 center = (M * vec4(localCenter, 1.0)).xyz + instance.xyz;
+	vec3 extent = abs(M[0].xyz) * localExtent.x + abs(M[1].xyz) * localExtent.y + abs(M[2].xyz) * localExtent.z;
+
+	for (int i = 0; i < 6; i++)
+	{
+		vec4 plane = frustumPlanes[i];
+
+		if (dot(plane.xyz, center) + plane.w < -dot(abs(plane.xyz), extent))
+		{
+			if (occlusionPhase == 2)
+				history[index] = 0u;
+
+			return;
+		}
+	}
+
+	if (occlusionPhase == 1 && history[index] == 0u)
+		return;
+
+	if (occlusionPhase == 2)
+	{
+		bool wasDrawn = history[index] != 0u;
+		bool isVisible = !isOccluded(center - extent, center + extent);
+
+		history[index] = isVisible ? 1u : 0u;
+
+		if (wasDrawn || !isVisible)
+			return;
+	}
+
+	uint visibleIndex = atomicAdd(commands[0].instanceCount, 1u);
+	visibleInstances[visibleIndex] = instance;
+}
@@ -0,0 +1,12 @@
+#version 430 core
+layout(location = 0) in vec3 vertexPosition;
+layout(location = 3) in vec4 instanceData;
+
+uniform mat4 M;
+
+void main()
+{
+	// Instances are placed the same way as in container_vertex.glsl.
+	vec4 tpos = M * vec4(vertexPosition * instanceData.w, 1.0) + vec4(instanceData.xyz, 0.0);
+	gl_Position = P * V * tpos;
+}
@@ -3,11 +3,32 @@ const vec3 _player2Color = vec3(1.0, 0.25, 0.0);
 
 const float M_PI = 3.1415926535;
 
-// Evaluates how shadowed a point is using PCF with 5 samples
+// Evaluates how shadowed a point is using PCF with 5 samples, from the nearest cascade that covers it
 // Credit: Sam Freed - https://github.com/sfreed141/vct/blob/master/shaders/phong.frag
-float _calcShadowFactor(vec4 lightSpacePosition, sampler2D shadowMap)
+float _calcShadowFactor(vec3 pos, mat4 lightPV[4], int shadowLayer, sampler2DArray shadowMap)
 {
-    vec3 shifted = (lightSpacePosition.xyz / lightSpacePosition.w + 1.0) * 0.5;
+    // Cascades must cover every PCF sample, so points within a texel of the edge use the next cascade.
+    vec2 margin = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+    int cascade = -1;
+    vec3 shifted;
+
+    for (int i = 0; i < lightPV.length(); i++)
+    {
+        vec4 lightSpacePosition = lightPV[i] * vec4(pos, 1.0);
+        shifted = (lightSpacePosition.xyz / lightSpacePosition.w + 1.0) * 0.5;
+
+        if (all(greaterThanEqual(shifted.xy, margin)) && all(lessThanEqual(shifted.xy, 1.0 - margin)))
+        {
+            cascade = i;
+            break;
+        }
+    }
+
+    // Points outside of every cascade are unlit by the shadow map, as if sampling its border.
+    if (cascade == -1)
+    {
+        return 0.0;
+    }
 
     float shadowFactor = 0;
     float bias = 0.00001;
@@ -23,9 +44,11 @@ float _calcShadowFactor(vec4 lightSpacePosition, sampler2D shadowMap)
         ivec2(0, 0), ivec2(1, 0), ivec2(0, 1), ivec2(-1, 0), ivec2(0, -1)
     );
 
+    vec3 coords = vec3(shifted.xy, shadowLayer + cascade);
+
     for (int i = 0; i < numSamples; i++)
     {
-        if (fragDepth > textureOffset(shadowMap, shifted.xy, offsets[i]).r)
+        if (fragDepth > textureOffset(shadowMap, coords, offsets[i]).r)
         {
             shadowFactor += 1;
         }
@@ -94,11 +117,10 @@ bool computeSimpleMaterial(inout vec3 col, int mat)
     }
 }
 
-bool computeComplexMaterial(inout vec3 col, vec3 pos, vec3 norm, vec3 campos, mat4 lightPV, sampler2D shadowMap, sampler2D skyTexture, int mat)
+bool computeComplexMaterial(inout vec3 col, vec3 pos, vec3 norm, vec3 campos, mat4 lightPV[4], int shadowLayer, sampler2DArray shadowMap, sampler2D skyTexture, int mat)
 {
     vec3 n = normalize(-norm);
-    vec4 lightSpacePosition = lightPV * vec4(pos, 1.0);
-    float shadowFactor = _calcShadowFactor(lightSpacePosition, shadowMap);
+    float shadowFactor = _calcShadowFactor(pos, lightPV, shadowLayer, shadowMap);
     float lightFactor = 1 - shadowFactor;
 
     switch (mat)
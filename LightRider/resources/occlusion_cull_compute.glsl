@@ -0,0 +1,77 @@
+#version 450
+layout(local_size_x = 64) in;
+
+// The world-space bounds of every culling slot, stored as six consecutive arrays of boxCount
+// floats: minX, minY, minZ, maxX, maxY, maxZ.
+layout(std430, binding = 0) readonly buffer Bounds
+{
+	float bounds[];
+};
+
+// Written with 1 for each slot that may be visible, or 0 for each slot hidden behind the depth pyramid.
+layout(std430, binding = 1) writeonly buffer Visibility
+{
+	uint visibility[];
+};
+
+uniform uint boxCount;
+
+layout(binding = 0) uniform sampler2D depthPyramid;
+uniform mat4 pyramidPvMatrix;
+uniform vec2 pyramidSize;
+uniform int pyramidMipCount;
+
+// Must match isOccluded in instance_cull_compute.glsl.
+bool isOccluded(vec3 boxMin, vec3 boxMax)
+{
+	vec2 ndcMin = vec2(1.0);
+	vec2 ndcMax = vec2(-1.0);
+	float minDepth = 1.0;
+
+	for (int i = 0; i < 8; i++)
+	{
+		vec3 corner = mix(boxMin, boxMax, vec3(i & 1, (i >> 1) & 1, (i >> 2) & 1));
+		vec4 clip = pyramidPvMatrix * vec4(corner, 1.0);
+
+		// Boxes crossing the near plane can't be bounded on screen.
+		if (clip.w <= 0.0)
+			return false;
+
+		vec3 ndc = clip.xyz / clip.w;
+		ndcMin = min(ndcMin, ndc.xy);
+		ndcMax = max(ndcMax, ndc.xy);
+		minDepth = min(minDepth, ndc.z * 0.5 + 0.5);
+	}
+
+	vec2 uvMin = clamp(ndcMin * 0.5 + 0.5, 0.0, 1.0);
+	vec2 uvMax = clamp(ndcMax * 0.5 + 0.5, 0.0, 1.0);
+
+	// Pick the level at which the box covers at most two texels along each axis.
+	vec2 extent = (uvMax - uvMin) * pyramidSize;
+	int level = min(int(ceil(log2(max(max(extent.x, extent.y), 1.0)))), pyramidMipCount - 1);
+
+	ivec2 mipSize = textureSize(depthPyramid, level);
+	ivec2 texelMin = min(ivec2(uvMin * vec2(mipSize)), mipSize - 1);
+	ivec2 texelMax = min(ivec2(uvMax * vec2(mipSize)), mipSize - 1);
+
+	float maxDepth = 0.0;
+
+	for (int y = texelMin.y; y <= texelMax.y; y++)
+		for (int x = texelMin.x; x <= texelMax.x; x++)
+			maxDepth = max(maxDepth, texelFetch(depthPyramid, ivec2(x, y), level).r);
+
+	return minDepth > maxDepth;
+}
+
+void main()
+{
+	uint index = gl_GlobalInvocationID.x;
+
+	if (index >= boxCount)
+		return;
+
+	vec3 boxMin = vec3(bounds[index], bounds[boxCount + index], bounds[2 * boxCount + index]);
+	vec3 boxMax = vec3(bounds[3 * boxCount + index], bounds[4 * boxCount + index], bounds[5 * boxCount + index]);
+
+	visibility[index] = isOccluded(boxMin, boxMax) ? 0u : 1u;
+}
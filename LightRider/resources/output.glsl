@@ -4,67 +4,96 @@ layout(location = 1) out vec3 _position;
 layout(location = 2) out vec3 _normal;
 layout(location = 3) out int _material;
 
-#define VOXEL_CAMERA_SIZE 20.
-#define VOXEL_CAMERA_SIZE_INV (1. / VOXEL_CAMERA_SIZE)
-#define VOXEL_MAP_DIMENSION 128
-#define VOXEL_MAP_HALF_DIMENSION (VOXEL_MAP_DIMENSION / 2)
-
-uniform int _outputMode;
-uniform vec3 _voxelCenterPosition;
-uniform vec3 _cameraPosition;
-uniform mat4 _lightPV;
-
-layout(location = 4) uniform sampler2D _shadowMap;
+layout(location = 4) uniform sampler2DArray _shadowMap;
 layout(location = 5) uniform sampler2D _skyTexture;
 
 layout(r32i, binding = 1) uniform coherent iimage3D _voxelMapR;
 layout(r32i, binding = 2) uniform coherent iimage3D _voxelMapG;
 layout(r32i, binding = 3) uniform coherent iimage3D _voxelMapB;
 layout(r32i, binding = 4) uniform coherent iimage3D _voxelMapA;
+layout(r32ui, binding = 7) uniform coherent volatile uimage3D _voxelMapPacked;
+
+// The most times a fragment retries adding itself to a packed voxel that other fragments keep changing. A fragment
+// that runs out of attempts is dropped, so heavily contended voxels average slightly fewer fragments.
+#define VOXEL_MAX_PACK_ATTEMPTS 255
 
 // Prototypes for externally-defined functions.
 bool computeSimpleMaterial(inout vec3 col, int mat);
-bool computeComplexMaterial(inout vec3 col, vec3 pos, vec3 norm, vec3 campos, mat4 lightPV, sampler2D shadowMap, sampler2D skyTexture, int mat);
+bool computeComplexMaterial(inout vec3 col, vec3 pos, vec3 norm, vec3 campos, mat4 lightPV[4], int shadowLayer, sampler2DArray shadowMap, sampler2D skyTexture, int mat);
 
 ivec3 worldToVoxelCoordinates(vec3 pos)
 {
-    pos -= _voxelCenterPosition;
-    pos *= VOXEL_CAMERA_SIZE_INV;
-    pos *= VOXEL_MAP_DIMENSION;
-    pos += vec3(VOXEL_MAP_HALF_DIMENSION);
+    return ivec3(floor(pos / _voxelSize));
+}
+
+// Adds a color to the running average of a packed voxel with a single compare-and-swap loop. The color
+// is stored as c / (1 + c) in RGB so that bright emitters fit in 8 bits, and the fragment count in A.
+void addToPackedVoxel(ivec3 voxelPos, vec3 col)
+{
+    uint expected = 0;
+    uint desired = packUnorm4x8(vec4(col / (1. + col), 1. / 255.));
+
+    for (int i = 0; i < VOXEL_MAX_PACK_ATTEMPTS; i++)
+    {
+        uint actual = imageAtomicCompSwap(_voxelMapPacked, voxelPos, expected, desired);
+
+        if (actual == expected)
+        {
+            return;
+        }
+
+        expected = actual;
+
+        vec4 voxel = unpackUnorm4x8(actual);
+        float count = voxel.a * 255.;
+        vec3 average = voxel.rgb / (1. - min(voxel.rgb, vec3(254. / 255.)));
+        average = (average * count + col) / (count + 1.);
+        desired = packUnorm4x8(vec4(average / (1. + average), min(count + 1., 255.) / 255.));
+    }
 
-    return ivec3(pos);
+    // Out of attempts; this fragment's color is left out of the voxel.
 }
 
 void writeOutput(vec4 col, vec3 pos, vec3 norm, int mat)
 {
-    if (_outputMode == 0)
+    if (_outputMode == OUTPUT_MODE_STATIC)
     {
         _color = col;
         _position = pos;
         _normal = norm;
         _material = mat;
     }
-    else if (_outputMode == 1)
+    else if (_outputMode == OUTPUT_MODE_DYNAMIC || _outputMode == OUTPUT_MODE_VOXELIZE)
     {
+        // Both voxelization paths write the same way. They only differ in how triangles are projected.
+        // Only voxels inside the region being updated may be written, since the rest of the level is kept.
         ivec3 voxelPos = worldToVoxelCoordinates(pos);
-        if (voxelPos.x < 0 || voxelPos.y < 0 || voxelPos.z < 0 ||
-            voxelPos.x >= VOXEL_MAP_DIMENSION || voxelPos.y >= VOXEL_MAP_DIMENSION || voxelPos.z >= VOXEL_MAP_DIMENSION)
+        if (any(lessThan(voxelPos, _voxelRegionMin)) || any(greaterThanEqual(voxelPos, _voxelRegionMax)))
         {
             return;
         }
 
+        // Levels are addressed toroidally, so each voxel lives at its grid coordinates wrapped to the volume.
+        voxelPos &= _voxelDimension - 1;
+
         // 'col' is an inout parameter here.
         // Try computing a simple material first, then a complex material. If the material is invalid, don't do anything.
-        if (!computeSimpleMaterial(col.rgb, mat) && !computeComplexMaterial(col.rgb, pos, norm, _cameraPosition, _lightPV, _shadowMap, _skyTexture, mat))
+        if (!computeSimpleMaterial(col.rgb, mat) && !computeComplexMaterial(col.rgb, pos, norm, _cameraPosition, _lightPV, _shadowLayer, _shadowMap, _skyTexture, mat))
         {
             return;
         }
 
-        imageAtomicAdd(_voxelMapR, voxelPos, int(255 * col.r)); // TODO: Multiply color amount by alpha?
-        imageAtomicAdd(_voxelMapG, voxelPos, int(255 * col.g));
-        imageAtomicAdd(_voxelMapB, voxelPos, int(255 * col.b));
-        imageAtomicAdd(_voxelMapA, voxelPos, 1);
+        if (_isVoxelMapPacked != 0)
+        {
+            addToPackedVoxel(voxelPos, col.rgb);
+        }
+        else
+        {
+            imageAtomicAdd(_voxelMapR, voxelPos, int(255 * col.r)); // TODO: Multiply color amount by alpha?
+            imageAtomicAdd(_voxelMapG, voxelPos, int(255 * col.g));
+            imageAtomicAdd(_voxelMapB, voxelPos, int(255 * col.b));
+            imageAtomicAdd(_voxelMapA, voxelPos, 1);
+        }
 
         // For debugging.
         _color = col;
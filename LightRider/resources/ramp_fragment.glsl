@@ -2,7 +2,7 @@
 #define ARROW_WIDTH 0.1
 #define ARROW_SPACING 0.5
 
-uniform float time;
+flat in float time;
 
 in vec3 vertex_normal;
 in vec3 vertex_pos;
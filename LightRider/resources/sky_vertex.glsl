@@ -3,8 +3,6 @@ layout(location = 0) in vec3 vertexPosition;
 layout(location = 1) in vec3 vertexNormal;
 layout(location = 2) in vec2 vertexTexture;
 
-uniform mat4 P;
-uniform mat4 V;
 uniform mat4 M;
 
 out vec3 vertex_pos;
@@ -1,6 +1,13 @@
 uniform int playerId;
 uniform float noiseSeed;
 uniform float currentTime;
+uniform bool useNoiseVolume;
+
+// Tileable 3D noise generated once at startup by trail_noise_compute.glsl.
+layout(binding = 6) uniform sampler3D noiseVolume;
+
+// Must match NOISE_VOLUME_PERIOD in trail_noise_compute.glsl.
+#define NOISE_VOLUME_PERIOD 32.0
 
 in vec3 fragmentPosition;
 in float fragmentHeight;
@@ -155,6 +162,18 @@ float cnoise(vec4 P)
 	return 2.2 * n_xyzw;
 }
 
+float trailNoise(vec3 position, float seed)
+{
+    if (useNoiseVolume)
+    {
+        // Scroll through the precomputed volume rather than evolving 4D noise per fragment.
+        vec3 scrolledPosition = position + vec3(0.7, 0.3, 0.6) * seed;
+        return texture(noiseVolume, scrolledPosition / NOISE_VOLUME_PERIOD).r;
+    }
+
+    return cnoise(vec4(position, seed));
+}
+
 void main()
 {
     vec3 baseColor = playerId == 0
@@ -163,7 +182,7 @@ void main()
     vec3 nBaseColor = normalize(baseColor) * 2.5;
 
     float edgeFactor = pow(abs(fragmentHeight), 5) * 2;
-    float noiseFactor = clamp(cnoise(vec4(fragmentPosition * vec3(0.25, 2.5, 0.25), noiseSeed * 4.0)) + 1.0, 0.0, 2.0);
+    float noiseFactor = clamp(trailNoise(fragmentPosition * vec3(0.25, 2.5, 0.25), noiseSeed * 4.0) + 1.0, 0.0, 2.0);
     float gradientFactor = (1 - (fragmentHeight + 1) * 0.5) * 0.75 + 0.25;
     float timeFactor = clamp((currentTime - fragmentTimeStamp) * 2, 0.0, 0.95);
 
@@ -1,10 +1,18 @@
 #version 430 core
-layout(location = 0) in vec3 vertexPosition;
-layout(location = 1) in float vertexHeight;
-layout(location = 2) in float vertexTimeStamp;
 
-uniform mat4 P;
-uniform mat4 V;
+// Must match LightTrail::TrailEdge.
+struct TrailEdge
+{
+	vec3 top;
+	float timeStamp;
+	vec3 bottom;
+	float padding;
+};
+
+layout(std430, binding = 0) readonly buffer TrailEdges
+{
+	TrailEdge trailEdges[];
+};
 
 out vec3 fragmentPosition;
 out float fragmentHeight;
@@ -12,9 +20,16 @@ out float fragmentTimeStamp;
 
 void main()
 {
+	// Consecutive edges are drawn as a triangle strip: even vertices are bottom points and
+	// odd vertices are top points.
+	TrailEdge edge = trailEdges[gl_VertexID >> 1];
+	bool isTop = (gl_VertexID & 1) == 1;
+
+	vec3 vertexPosition = isTop ? edge.top : edge.bottom;
+
     fragmentPosition = vertexPosition;
-    fragmentHeight = vertexHeight;
-    fragmentTimeStamp = vertexTimeStamp;
+    fragmentHeight = isTop ? 1.0 : -1.0;
+    fragmentTimeStamp = edge.timeStamp;
 
 	gl_Position = P * V * vec4(vertexPosition, 1.0);
 }
@@ -0,0 +1,29 @@
+// Declarations shared between shaders, inserted after the #version directive of every stage of the programs that
+// use them, so that each is written once. The blocks must match their structs in UniformBuffer.h.
+
+// The values of _outputMode. Must match ProgramOutputMode.h.
+#define OUTPUT_MODE_STATIC 0
+#define OUTPUT_MODE_DYNAMIC 1
+#define OUTPUT_MODE_VOXELIZE 2
+
+// Per-pass view data, bound by the camera to UniformBlockBinding::VIEW.
+layout(std140, binding = 0) uniform ViewUniforms
+{
+    mat4 P;
+    mat4 V;
+    int _outputMode;
+    float _voxelSize;
+    int _voxelDimension;
+    int _isVoxelMapPacked;
+    ivec3 _voxelRegionMin;
+    ivec3 _voxelRegionMax;
+};
+
+// Per-camera frame data, bound by the camera to UniformBlockBinding::CAMERA.
+layout(std140, binding = 1) uniform CameraUniforms
+{
+    mat4 _lightPV[4];
+    int _shadowLayer;
+    vec3 _cameraPosition;
+    vec3 _voxelCenterPosition;
+};
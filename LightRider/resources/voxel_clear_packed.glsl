@@ -0,0 +1,17 @@
+#version 450 
+layout(local_size_x = 8, local_size_y = 4, local_size_z = 4) in;	
+
+layout(r32ui, binding = 7) uniform uimage3D voxelMapPacked;
+
+// The grid coordinates of the first voxel in the region being cleared.
+uniform ivec3 regionMin;
+
+// The number of voxels along each axis of the volume.
+uniform int dimension;
+
+void main()
+{
+    // Volumes are addressed toroidally, so each voxel lives at its grid coordinates wrapped to the volume.
+    ivec3 tc = (regionMin + ivec3(gl_GlobalInvocationID.xyz)) & (dimension - 1);
+    imageStore(voxelMapPacked, tc, uvec4(0));
+}
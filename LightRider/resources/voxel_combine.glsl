@@ -6,14 +6,35 @@ layout(r32i, binding = 2) uniform iimage3D voxelMapG;
 layout(r32i, binding = 3) uniform iimage3D voxelMapB;
 layout(r32i, binding = 4) uniform iimage3D voxelMapA;
 layout(rgba16f, binding = 5) uniform image3D voxelMap;
+layout(rgba16f, binding = 6) uniform image3D staticVoxelMap;
 
 void main()
 {
     ivec3 tc = ivec3(gl_GlobalInvocationID.xyz);
+
+    // The components hold dynamic objects at half the resolution of the level.
+    ivec3 dynamicTc = tc / 2;
     vec3 col = vec3(
-        imageLoad(voxelMapR, tc).r / 255.,
-        imageLoad(voxelMapG, tc).r / 255.,
-        imageLoad(voxelMapB, tc).r / 255.);
-    float count = imageLoad(voxelMapA, tc).r;
-    imageStore(voxelMap, tc, vec4(col*min(1.f, count)/max(1.f, count), min(1.f, count)));
+        imageLoad(voxelMapR, dynamicTc).r / 255.,
+        imageLoad(voxelMapG, dynamicTc).r / 255.,
+        imageLoad(voxelMapB, dynamicTc).r / 255.);
+    float count = imageLoad(voxelMapA, dynamicTc).r;
+    vec4 dynamicColor = vec4(col*min(1.f, count)/max(1.f, count), min(1.f, count));
+
+    // Dynamic objects are laid over the static ones cached in the level.
+    vec4 staticColor = imageLoad(staticVoxelMap, tc);
+    imageStore(voxelMap, tc, dynamicColor + staticColor * (1. - dynamicColor.a));
+
+    // Each dynamic voxel is read by a 2x2x2 block of invocations in the same work group. Once all of them
+    // have read it, the first leaves it empty for the next pass that accumulates into it.
+    memoryBarrierImage();
+    barrier();
+
+    if (tc == dynamicTc * 2)
+    {
+        imageStore(voxelMapR, dynamicTc, ivec4(0));
+        imageStore(voxelMapG, dynamicTc, ivec4(0));
+        imageStore(voxelMapB, dynamicTc, ivec4(0));
+        imageStore(voxelMapA, dynamicTc, ivec4(0));
+    }
 }
@@ -0,0 +1,38 @@
+#version 450 
+layout(local_size_x = 8, local_size_y = 4, local_size_z = 4) in;	
+
+layout(rgba16f, binding = 5) uniform image3D voxelMap;
+layout(r32ui, binding = 6) uniform uimage3D staticVoxelMapPacked;
+layout(r32ui, binding = 7) uniform uimage3D voxelMapPacked;
+
+// Decodes a voxel packed by output.glsl, returning its average color and coverage.
+vec4 unpackVoxel(uint packedVoxel)
+{
+    vec4 voxel = unpackUnorm4x8(packedVoxel);
+    voxel.rgb = voxel.rgb / (1. - min(voxel.rgb, vec3(254. / 255.)));
+    voxel.a = min(1., voxel.a * 255.);
+    return voxel;
+}
+
+void main()
+{
+    ivec3 tc = ivec3(gl_GlobalInvocationID.xyz);
+
+    // The dynamic volume holds dynamic objects at half the resolution of the level.
+    ivec3 dynamicTc = tc / 2;
+    vec4 dynamicColor = unpackVoxel(imageLoad(voxelMapPacked, dynamicTc).r);
+
+    // Dynamic objects are laid over the static ones cached in the level.
+    vec4 staticColor = unpackVoxel(imageLoad(staticVoxelMapPacked, tc).r);
+    imageStore(voxelMap, tc, dynamicColor + staticColor * (1. - dynamicColor.a));
+
+    // Each dynamic voxel is read by a 2x2x2 block of invocations in the same work group. Once all of them
+    // have read it, the first leaves it empty for the next pass that accumulates into it.
+    memoryBarrierImage();
+    barrier();
+
+    if (tc == dynamicTc * 2)
+    {
+        imageStore(voxelMapPacked, dynamicTc, uvec4(0));
+    }
+}
@@ -0,0 +1,19 @@
+#version 450
+layout(local_size_x = 8, local_size_y = 4, local_size_z = 4) in;
+
+// The number of voxels covered by any geometry.
+layout(std430, binding = 0) buffer result
+{
+    uint coveredCount;
+};
+
+layout(rgba16f, binding = 0) readonly uniform image3D voxelMap;
+
+void main()
+{
+    // The alpha of a radiance voxel is the fraction of it covered by geometry.
+    if (imageLoad(voxelMap, ivec3(gl_GlobalInvocationID.xyz)).a > 0.)
+    {
+        atomicAdd(coveredCount, 1u);
+    }
+}
@@ -0,0 +1,31 @@
+#version 450 
+layout(local_size_x = 8, local_size_y = 4, local_size_z = 4) in;	
+
+#define VOXEL_MAP_DIMENSION 128
+
+layout(r32i, binding = 1) uniform iimage3D voxelMapR;
+layout(r32i, binding = 2) uniform iimage3D voxelMapG;
+layout(r32i, binding = 3) uniform iimage3D voxelMapB;
+layout(r32i, binding = 4) uniform iimage3D voxelMapA;
+layout(rgba16f, binding = 6) uniform image3D staticVoxelMap;
+
+// The grid coordinates of the first voxel in the region being stored.
+uniform ivec3 regionMin;
+
+void main()
+{
+    // Levels are addressed toroidally, so each voxel lives at its grid coordinates wrapped to the volume.
+    ivec3 tc = (regionMin + ivec3(gl_GlobalInvocationID.xyz)) & (VOXEL_MAP_DIMENSION - 1);
+    vec3 col = vec3(
+        imageLoad(voxelMapR, tc).r / 255.,
+        imageLoad(voxelMapG, tc).r / 255.,
+        imageLoad(voxelMapB, tc).r / 255.);
+    float count = imageLoad(voxelMapA, tc).r;
+    imageStore(staticVoxelMap, tc, vec4(col*min(1.f, count)/max(1.f, count), min(1.f, count)));
+
+    // Leave the components empty for the next pass that accumulates into them.
+    imageStore(voxelMapR, tc, ivec4(0));
+    imageStore(voxelMapG, tc, ivec4(0));
+    imageStore(voxelMapB, tc, ivec4(0));
+    imageStore(voxelMapA, tc, ivec4(0));
+}
@@ -0,0 +1,79 @@
+#version 430 core
+layout(triangles) in;
+layout(triangle_strip, max_vertices = 3) out;
+
+// Declares each vertex shader output as an input, and again as an output for the fragment shader.
+VERTEX_OUTPUTS
+
+void emitTriangle(vec4 positions[3], int order[3])
+{
+	for (int i = 0; i < 3; i++)
+	{
+		gl_Position = positions[i];
+		COPY_VERTEX_OUTPUTS(order[i]);
+		EmitVertex();
+	}
+
+	EndPrimitive();
+}
+
+void main()
+{
+	vec4 positions[3] = vec4[](gl_in[0].gl_Position, gl_in[1].gl_Position, gl_in[2].gl_Position);
+	int order[3] = int[](0, 1, 2);
+
+	// Outside of voxelization, triangles pass through unchanged.
+	if (_outputMode != OUTPUT_MODE_VOXELIZE)
+	{
+		emitTriangle(positions, order);
+		return;
+	}
+
+	// The voxelization pass maps the voxel volume onto the clip cube. Each triangle is projected along the
+	// axis its normal is closest to, which gives it the largest area and so covers every voxel it crosses.
+	vec3 normal = abs(cross(positions[1].xyz - positions[0].xyz, positions[2].xyz - positions[0].xyz));
+
+	for (int i = 0; i < 3; i++)
+	{
+		if (normal.x >= normal.y && normal.x >= normal.z)
+			positions[i].xyz = positions[i].yzx;
+		else if (normal.y >= normal.z)
+			positions[i].xyz = positions[i].zxy;
+	}
+
+	// Keep the winding counter-clockwise, so that face culling never discards the projected triangle.
+	vec2 edge0 = positions[1].xy - positions[0].xy;
+	vec2 edge1 = positions[2].xy - positions[0].xy;
+	float area = edge0.x * edge1.y - edge0.y * edge1.x;
+
+	if (area == 0.0)
+		return;
+
+	if (area < 0.0)
+	{
+		positions = vec4[](positions[0], positions[2], positions[1]);
+		order = int[](0, 2, 1);
+	}
+
+	// Emulate conservative rasterization by pushing each edge out by half a voxel, so that thin triangles
+	// still produce a fragment in every voxel they touch. Each vertex moves to where its pushed edges meet.
+	vec2 halfVoxel = vec2(1.0 / _voxelDimension);
+	vec3 edgePlanes[3];
+
+	for (int i = 0; i < 3; i++)
+	{
+		vec3 previous = vec3(positions[(i + 2) % 3].xy, 1.0);
+		vec3 current = vec3(positions[i].xy, 1.0);
+
+		edgePlanes[i] = cross(current - previous, previous);
+		edgePlanes[i].z -= dot(halfVoxel, abs(edgePlanes[i].xy));
+	}
+
+	for (int i = 0; i < 3; i++)
+	{
+		vec3 corner = cross(edgePlanes[i], edgePlanes[(i + 1) % 3]);
+		positions[i].xy = corner.xy / corner.z;
+	}
+
+	emitTriangle(positions, order);
+}
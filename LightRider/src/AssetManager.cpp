@@ -2,8 +2,16 @@
 
 #include <iostream>
 #include <algorithm>
+#include <cstring>
 
 #include "Game.h"
+#include "Components/InstanceCuller.h"
+#include "GLState.h"
+#include "ProgramMetadata.h"
+#include "GameConstants.h"
+#include "RadixSort.h"
+
+namespace GC = GameConstants;
 
 ShaderUniform operator|(ShaderUniform lhs, ShaderUniform rhs)
 {
@@ -20,16 +28,27 @@ AssetManager::AssetManager() :
     m_textures(),
     m_shapes(),
     m_gameConfig(Game::getInstance().getConfig()),
-    m_renderTree(),
+    m_pGeometryArena(new GeometryArena(GC::geometryArenaVertexCapacity, GC::geometryArenaIndexCapacity)),
+    m_pDrawBatch(nullptr),
+    m_drawList(),
+    m_cullingBounds(),
+    m_staticRevision(0),
+    m_boundsSlots(),
+    m_instanceCullers(),
     m_blendedNodes(),
-    m_sortedBlendedNodes()
+    m_blendedNodeIndices(),
+    m_blendedSortEntries(),
+    m_blendedSortBuffer(),
+    m_sortedBlendedNodes(),
+    m_pBlendedSortCamera(nullptr),
+    m_blendedSortTick(-1),
+    m_areBlendedNodesDirty(false)
 {
+    m_pDrawBatch = new DrawBatch(*m_pGeometryArena, GC::drawBatchCapacity);
 }
 
 AssetManager::~AssetManager()
 {
-    m_renderTree.clear();
-
     for (auto& pair : m_shaderPrograms)
     {
         delete pair.second;
@@ -53,10 +72,13 @@ AssetManager::~AssetManager()
         delete pair.second;
     }
     m_shapes.clear();
+
+    delete m_pDrawBatch;
+    delete m_pGeometryArena;
 }
 
 Program* AssetManager::loadShaderProgram(const std::string& id, const std::string& vertexShaderFileName,
-    const std::vector<std::string>& fragmentShaderFileNames, ShaderUniform defaultUniforms)
+    const std::vector<std::string>& fragmentShaderFileNames, ShaderUniform defaultUniforms, const std::string& voxelizeGeometryShaderFileName)
 {
     if (id.empty())
     {
@@ -64,31 +86,24 @@ Program* AssetManager::loadShaderProgram(const std::string& id, const std::strin
         return nullptr;
     }
 
-    std::vector<std::string> fragmentShaderFilePaths;
-    fragmentShaderFilePaths.reserve(fragmentShaderFileNames.size());
-
-    for (auto& fileName : fragmentShaderFileNames)
-    {
-        fragmentShaderFilePaths.push_back(m_gameConfig.resourceDirectory + fileName);
-    }
+    Program* pProgram = createShaderProgram(vertexShaderFileName, fragmentShaderFileNames, defaultUniforms, "");
 
-    Program* pProgram = new Program();
-    pProgram->setVerbose(true);
-    pProgram->setShaderNames(m_gameConfig.resourceDirectory + vertexShaderFileName, fragmentShaderFilePaths);
+    if (!pProgram)
+        return nullptr;
 
-    if (!pProgram->init())
+    // The geometry shader lives in its own variant, so only single-pass voxelization pays for it.
+    if (!voxelizeGeometryShaderFileName.empty())
     {
-        std::cerr << "Could not initialize shader from \"" << vertexShaderFileName << '"';
+        Program* pVoxelizeProgram = createShaderProgram(vertexShaderFileName, fragmentShaderFileNames, defaultUniforms,
+            voxelizeGeometryShaderFileName);
 
-        for (auto& fragmentShaderName : fragmentShaderFileNames)
+        if (!pVoxelizeProgram)
         {
-            std::cerr << ", \"" << fragmentShaderName << '"';
+            delete pProgram;
+            return nullptr;
         }
 
-        std::cerr << std::endl;
-
-        delete pProgram;
-        return nullptr;
+        pProgram->setVariant(ProgramVariant::VOXELIZE, pVoxelizeProgram);
     }
 
     if (defaultUniforms & ShaderUniform::P_MATRIX)
@@ -107,19 +122,28 @@ Program* AssetManager::loadShaderProgram(const std::string& id, const std::strin
       | ShaderUniform::TEXTURE_3
         ))
     {
-        glUseProgram(pProgram->getPid());
+        // Sampler units are program state, so each variant is given them.
+        for (unsigned i = 0; i < (unsigned)ProgramVariant::COUNT; i++)
+        {
+            Program* pVariant = pProgram->getVariant((ProgramVariant)i);
+
+            if (!pVariant)
+                continue;
 
-        if (defaultUniforms & ShaderUniform::TEXTURE_0)
-            registerTextureUniform(pProgram, id, 0);
+            GLState::useProgram(pVariant->getPid());
 
-        if (defaultUniforms & ShaderUniform::TEXTURE_1)
-            registerTextureUniform(pProgram, id, 1);
+            if (defaultUniforms & ShaderUniform::TEXTURE_0)
+                registerTextureUniform(pVariant, id, 0);
 
-        if (defaultUniforms & ShaderUniform::TEXTURE_2)
-            registerTextureUniform(pProgram, id, 2);
+            if (defaultUniforms & ShaderUniform::TEXTURE_1)
+                registerTextureUniform(pVariant, id, 1);
 
-        if (defaultUniforms & ShaderUniform::TEXTURE_3)
-            registerTextureUniform(pProgram, id, 3);
+            if (defaultUniforms & ShaderUniform::TEXTURE_2)
+                registerTextureUniform(pVariant, id, 2);
+
+            if (defaultUniforms & ShaderUniform::TEXTURE_3)
+                registerTextureUniform(pVariant, id, 3);
+        }
     }
 
     m_shaderPrograms[id] = pProgram;
@@ -128,6 +152,48 @@ Program* AssetManager::loadShaderProgram(const std::string& id, const std::strin
 
 }
 
+Program* AssetManager::createShaderProgram(const std::string& vertexShaderFileName, const std::vector<std::string>& fragmentShaderFileNames,
+    ShaderUniform defaultUniforms, const std::string& geometryShaderFileName)
+{
+    std::vector<std::string> fragmentShaderFilePaths;
+    fragmentShaderFilePaths.reserve(fragmentShaderFileNames.size());
+
+    for (auto& fileName : fragmentShaderFileNames)
+    {
+        fragmentShaderFilePaths.push_back(m_gameConfig.resourceDirectory + fileName);
+    }
+
+    Program* pProgram = new Program();
+    pProgram->setVerbose(true);
+    pProgram->setShaderNames(m_gameConfig.resourceDirectory + vertexShaderFileName, fragmentShaderFilePaths);
+
+    if (!geometryShaderFileName.empty())
+        pProgram->setGeometryShaderName(m_gameConfig.resourceDirectory + geometryShaderFileName);
+
+    if (defaultUniforms & ShaderUniform::VIEW_UNIFORMS)
+        pProgram->addIncludeName(m_gameConfig.resourceDirectory + "view_uniforms.glsl");
+
+    if (defaultUniforms & ShaderUniform::DRAW_DATA)
+        pProgram->addIncludeName(m_gameConfig.resourceDirectory + "draw_data.glsl");
+
+    if (!pProgram->init())
+    {
+        std::cerr << "Could not initialize shader from \"" << vertexShaderFileName << '"';
+
+        for (auto& fragmentShaderName : fragmentShaderFileNames)
+        {
+            std::cerr << ", \"" << fragmentShaderName << '"';
+        }
+
+        std::cerr << std::endl;
+
+        delete pProgram;
+        return nullptr;
+    }
+
+    return pProgram;
+}
+
 Program* AssetManager::loadShaderProgram(const std::string& id, const std::string& vertexShaderFileName,
         const std::string& fragmentShaderFileName, ShaderUniform defaultUniforms)
 {
@@ -166,6 +232,23 @@ Texture* AssetManager::loadTexture(const std::string& id, const std::string& fil
     return pTexture;
 }
 
+Texture* AssetManager::createVolumeTexture(const std::string& id, int dimension, GLenum internalFormat)
+{
+    if (id.empty())
+    {
+        std::cout << "Cannot create a texture with an empty ID!" << std::endl;
+        return nullptr;
+    }
+
+    Texture* pTexture = new Texture();
+
+    pTexture->initVolume(dimension, internalFormat);
+
+    m_textures[id] = pTexture;
+
+    return pTexture;
+}
+
 Shape* AssetManager::loadShape(const std::string& id, const std::string& fileName)
 {
     if (id.empty())
@@ -178,25 +261,51 @@ Shape* AssetManager::loadShape(const std::string& id, const std::string& fileNam
 
     pShape->loadMesh(m_gameConfig.resourceDirectory + fileName);
     pShape->resize();
-    pShape->init();
+    pShape->init(m_pGeometryArena);
 
     m_shapes[id] = pShape;
 
     return pShape;
 }
 
+void AssetManager::cullInstances(const ViewFrustum& frustum, OcclusionCuller* pOcclusionCuller, OcclusionPhase phase)
+{
+    for (InstanceCuller* pInstanceCuller : m_instanceCullers)
+        pInstanceCuller->cull(frustum, pOcclusionCuller, phase);
+}
+
 void AssetManager::sortBlendedRenderables(Camera* pCamera)
 {
-    m_sortedBlendedNodes.clear();
+    long tick = Game::getInstance().getTick();
 
-    for (auto pair : m_blendedNodes)
-        m_sortedBlendedNodes.push_back(pair.second);
+    // Every pass rendered by a camera during a tick shares its viewpoint, so the order can be reused.
+    if (!m_areBlendedNodesDirty && pCamera == m_pBlendedSortCamera && tick == m_blendedSortTick)
+        return;
 
-    std::sort(m_sortedBlendedNodes.begin(), m_sortedBlendedNodes.end(),
-        [=](BlendedNode* pNode1, BlendedNode* pNode2)
-        {
-            return pNode1->pRenderable->getDepth(pCamera) > pNode2->pRenderable->getDepth(pCamera);
-        });
+    m_blendedSortEntries.resize(m_blendedNodes.size());
+
+    for (size_t i = 0; i < m_blendedNodes.size(); i++)
+    {
+        float depth = m_blendedNodes[i]->pRenderable->getSortDepth(pCamera);
+
+        // Map the float to an unsigned integer with the same ordering, then invert it so the farthest sorts first.
+        uint32_t bits;
+        std::memcpy(&bits, &depth, sizeof(bits));
+        bits ^= (bits & 0x80000000u) ? 0xFFFFFFFFu : 0x80000000u;
+
+        m_blendedSortEntries[i] = { ~bits, m_blendedNodes[i] };
+    }
+
+    radixSort(m_blendedSortEntries, m_blendedSortBuffer, 32, [](const BlendedSortEntry& entry) { return entry.key; });
+
+    m_sortedBlendedNodes.resize(m_blendedSortEntries.size());
+
+    for (size_t i = 0; i < m_blendedSortEntries.size(); i++)
+        m_sortedBlendedNodes[i] = m_blendedSortEntries[i].pNode;
+
+    m_pBlendedSortCamera = pCamera;
+    m_blendedSortTick = tick;
+    m_areBlendedNodesDirty = false;
 }
 
 void AssetManager::_registerRenderable(Renderable* pRenderable)
@@ -204,12 +313,12 @@ void AssetManager::_registerRenderable(Renderable* pRenderable)
     const std::string& shaderProgramId = pRenderable->getShaderProgramId();
     const std::string& imageTextureId = pRenderable->getImageTextureId();
 
-    Program* pShaderProgram = m_shaderPrograms[shaderProgramId];
+    Program* pShaderProgram = findAsset(m_shaderPrograms, shaderProgramId);
 
     if (!pShaderProgram && !shaderProgramId.empty())
         std::cerr << "Warning: could not find shader program with ID \"" << shaderProgramId << "\"!" << std::endl;
 
-    Texture* pTexture = m_textures[imageTextureId];
+    Texture* pTexture = findAsset(m_textures, imageTextureId);
 
     if (!pTexture)
     {
@@ -221,49 +330,92 @@ void AssetManager::_registerRenderable(Renderable* pRenderable)
         std::cerr << "Warning: Texture \"" << imageTextureId << "\" is not an image texture!" << std::endl;
     }
 
+    DrawPass passes = DrawPass::PRIMARY;
+
+    if (!pShaderProgram || hasProgramMetadata(pShaderProgram, ProgramMetadata::USES_DYNAMIC_OUTPUT))
+        passes = passes | (pRenderable->isStatic() ? DrawPass::VOXEL_STATIC : DrawPass::VOXEL_DYNAMIC);
+
+    uint32_t boundsSlot = m_cullingBounds.allocate(pRenderable);
+    m_boundsSlots[pRenderable] = boundsSlot;
+
     if (pRenderable->usesBlending())
     {
-        m_blendedNodes.insert(std::pair<Renderable*, BlendedNode*>(pRenderable, new BlendedNode
+        m_blendedNodeIndices[pRenderable] = m_blendedNodes.size();
+        m_blendedNodes.push_back(new BlendedNode
             {
                 pRenderable,
                 pShaderProgram,
-                pTexture
-            }));
+                pTexture,
+                passes,
+                boundsSlot
+            });
+        m_areBlendedNodesDirty = true;
         return;
     }
 
-    ProgramNode* pProgramNode = visitRenderTreeNode<ProgramNode>(&m_renderTree, pShaderProgram);
-    TextureNode* pTextureNode = visitRenderTreeNode<TextureNode>(pProgramNode, pTexture);
+    passes = passes | (pRenderable->usesDetailedShadows() ? DrawPass::SHADOW_DETAILED : DrawPass::SHADOW_DEPTH);
+
+    const std::string& depthProgramId = pRenderable->getDepthProgramId();
+    Program* pDepthProgram = findAsset(m_shaderPrograms, depthProgramId);
+
+    if (!pDepthProgram && !depthProgramId.empty())
+        std::cerr << "Warning: could not find depth program with ID \"" << depthProgramId << "\"!" << std::endl;
+
+    m_drawList.add(pRenderable, passes, pShaderProgram, pTexture, pDepthProgram, boundsSlot);
 
-    pTextureNode->push_back(pRenderable);
+    if (pRenderable->isStatic())
+        m_staticRevision++;
 }
 
 void AssetManager::_unregisterRenderable(Renderable* pRenderable)
 {
-    if (pRenderable->usesBlending())
+    auto slotItr = m_boundsSlots.find(pRenderable);
+
+    if (slotItr != m_boundsSlots.end())
     {
-        m_blendedNodes.erase(pRenderable);
-        return;
+        m_cullingBounds.release(slotItr->second);
+        m_boundsSlots.erase(slotItr);
     }
 
-    const std::string& shaderProgramId = pRenderable->getShaderProgramId();
-    const std::string& imageTextureId = pRenderable->getImageTextureId();
+    if (pRenderable->usesBlending())
+    {
+        auto indexItr = m_blendedNodeIndices.find(pRenderable);
 
-    Program* pShaderProgram = m_shaderPrograms[shaderProgramId];
-    Texture* pTexture = m_textures[imageTextureId];
+        if (indexItr != m_blendedNodeIndices.end())
+        {
+            size_t index = indexItr->second;
+            BlendedNode* pNode = m_blendedNodes[index];
 
-    auto shaderNode = m_renderTree[pShaderProgram];
-    auto textureNode = (*shaderNode)[pTexture];
+            // Removing from the sorted list keeps it in order, so it can still be reused.
+            m_sortedBlendedNodes.erase(
+                std::remove(m_sortedBlendedNodes.begin(), m_sortedBlendedNodes.end(), pNode),
+                m_sortedBlendedNodes.end());
 
-    textureNode->erase(std::remove(textureNode->begin(), textureNode->end(), pRenderable));
+            m_blendedNodes[index] = m_blendedNodes.back();
+            m_blendedNodeIndices[m_blendedNodes[index]->pRenderable] = index;
+            m_blendedNodes.pop_back();
+            m_blendedNodeIndices.erase(indexItr);
 
-    if (textureNode->empty())
-    {
-        shaderNode->erase(pTexture);
+            delete pNode;
+        }
 
-        if (shaderNode->empty())
-            m_renderTree.erase(pShaderProgram);
+        return;
     }
+
+    m_drawList.remove(pRenderable);
+
+    if (pRenderable->isStatic())
+        m_staticRevision++;
+}
+
+void AssetManager::_registerInstanceCuller(InstanceCuller* pInstanceCuller)
+{
+    m_instanceCullers.push_back(pInstanceCuller);
+}
+
+void AssetManager::_unregisterInstanceCuller(InstanceCuller* pInstanceCuller)
+{
+    m_instanceCullers.erase(std::remove(m_instanceCullers.begin(), m_instanceCullers.end(), pInstanceCuller), m_instanceCullers.end());
 }
 
 void AssetManager::registerTextureUniform(Program* pProgram, const std::string& shaderId, unsigned textureUniformId)
@@ -278,22 +430,10 @@ void AssetManager::registerTextureUniform(Program* pProgram, const std::string&
         glUniform1i(textureUniformLocation, textureUniformId);
 }
 
-template<typename T, typename U, typename V>
-T* AssetManager::visitRenderTreeNode(U* pParentNode, V* value)
+template<typename T>
+T* AssetManager::findAsset(const std::map<std::string, T*>& assets, const std::string& id)
 {
-    T* pNode;
-
-    auto nodeItr = pParentNode->find(value);
-
-    if (nodeItr == pParentNode->end())
-    {
-        pNode = new T();
-        pParentNode->insert(std::pair<V*, T*>(value, pNode));
-    }
-    else
-    {
-        pNode = nodeItr->second;
-    }
+    auto assetItr = assets.find(id);
 
-    return pNode;
+    return assetItr == assets.end() ? nullptr : assetItr->second;
 }
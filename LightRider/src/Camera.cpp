@@ -1,10 +1,13 @@
 #include "Camera.h"
 
+#include <algorithm>
 #include <iostream>
 
 #include <glm/gtx/euler_angles.hpp>
 
 #include "AssetManager.h"
+#include "GLSL.h"
+#include "GLState.h"
 #include "Game.h"
 #include "ProgramMetadata.h"
 #include "ProgramOutputMode.h"
@@ -13,6 +16,8 @@ Camera::Camera(bool enabled, float layerDepth) :
     m_pSkyTexture(nullptr),
     m_pSkyShape(nullptr),
     m_pSkyShaderProgram(nullptr),
+    m_viewUniformBuffer(sizeof(ViewUniforms)),
+    m_cameraUniformBuffer(sizeof(CameraUniforms)),
     m_isEnabled(false),
     m_layerDepth(0.0f),
     m_viewMatrix(1.0f),
@@ -22,6 +27,9 @@ Camera::Camera(bool enabled, float layerDepth) :
     m_sunDistance(300.0f),
     m_sunVMatrix(1.0f),
     m_sunPvMatrix(1.0f),
+    m_cullingFrustum(),
+    m_visibility(),
+    m_occludedSlots(),
     m_focalLength(0.0f, 0.0f),
     m_fieldOfView(glm::pi<float>() / 4.0f),
     m_nearPlane(0.1f),
@@ -42,33 +50,8 @@ Camera::Camera(bool enabled, float layerDepth) :
 
     m_primaryRenderConfiguration =
     {
-        // canUseShader
-        m_primaryRenderConfiguration.canUseShader = [](Program* pShaderProgram) -> bool
-        {
-            return true;
-        },
-
-        // configureShader
-        [this](Program* pShaderProgram) -> void
-        {
-            pShaderProgram->setVerbose(false);
-
-            GLint pId = pShaderProgram->getUniform("P");
-            GLint vId = pShaderProgram->getUniform("V");
-
-            if (pId != -1)
-                glUniformMatrix4fv(pId, 1, GL_FALSE, &m_perspectiveMatrix[0][0]);
-
-            if (vId != -1)
-                glUniformMatrix4fv(vId, 1, GL_FALSE, &m_viewMatrix[0][0]);
-
-            pShaderProgram->setVerbose(true);
-
-            if (doesProgramHaveDynamicOutput(pShaderProgram))
-            {
-                glUniform1i(pShaderProgram->getUniform("_outputMode"), (GLint)ProgramOutputMode::STATIC);
-            }
-        },
+        // pass
+        DrawPass::PRIMARY,
     };
 }
 
@@ -89,8 +72,8 @@ void Camera::setSky(const std::string& skyShaderProgramId, const std::string& sk
         return;
     }
 
-    glActiveTexture((GLenum)TextureType::BACKGROUND);
-    glBindTexture(GL_TEXTURE_2D, pSkyTexture->getTextureId());
+    GLState::activeTexture((GLenum)TextureType::BACKGROUND);
+    GLState::bindTexture(GL_TEXTURE_2D, pSkyTexture->getTextureId());
 
     m_pSkyTexture = pSkyTexture;
 
@@ -132,28 +115,42 @@ void Camera::render()
 
     computeSunPvMatrix();
 
+    CameraUniforms cameraUniforms;
+    getShadowMapping(cameraUniforms);
+    cameraUniforms.cameraPosition = glm::vec4(pTransform->getPosition(), 1.0f);
+    cameraUniforms.voxelCenterPosition = glm::vec4(getVoxelCenterPosition(), 1.0f);
+
+    m_cameraUniformBuffer.update(&cameraUniforms);
+    m_cameraUniformBuffer.bind(UniformBlockBinding::CAMERA);
+
     preRender();
 
     int x, y, width, height;
     getViewport(x, y, width, height);
 
     glViewport(x, y, width, height);
-    glDisable(GL_DEPTH_TEST);
+    GLState::disable(GL_DEPTH_TEST);
 
     float aspectRatio = (float)width / (float)height;
     m_perspectiveMatrix = glm::perspective(m_fieldOfView, aspectRatio, m_nearPlane, m_farPlane);
     m_focalLength.x = (1.0f / glm::tan(m_fieldOfView * 0.5f)) * (1.0f / aspectRatio);
     m_focalLength.y = 1.0f / glm::tan(m_fieldOfView * 0.5f);
 
-    glDepthMask(GL_FALSE);
+    setCullingFrustum(ViewFrustum(m_perspectiveMatrix * m_viewMatrix), OcclusionPhase::FIRST);
+
+    bindViewUniforms(m_viewUniformBuffer, 0, m_perspectiveMatrix, m_viewMatrix, ProgramOutputMode::STATIC);
+
+    GLSL::pushDebugGroup("Primary");
+
+    GLState::depthMask(GL_FALSE);
 
     if (m_pSkyShaderProgram && m_pSkyTexture && m_pSkyShape)
         renderSky(transformMatrix);
 
-    glDepthMask(GL_TRUE);
+    GLState::depthMask(GL_TRUE);
 
-    glEnable(GL_DEPTH_TEST);
-    glDisable(GL_BLEND);
+    GLState::enable(GL_DEPTH_TEST);
+    GLState::disable(GL_BLEND);
 
     renderUnblendedRenderables(m_primaryRenderConfiguration);
 
@@ -161,15 +158,44 @@ void Camera::render()
     
     if (pScene->getDebugDrawEnabled())
     {
-        glDisable(GL_DEPTH_TEST);
-        glDisable(GL_BLEND);
+        GLState::disable(GL_DEPTH_TEST);
+        GLState::disable(GL_BLEND);
 
         pScene->getDynamicsWorld()->debugDrawWorld();
     }
 
+    GLSL::popDebugGroup();
+
     postRender();
 }
 
+void Camera::setCullingFrustum(const ViewFrustum& cullingFrustum, OcclusionPhase occlusionPhase)
+{
+    m_cullingFrustum = cullingFrustum;
+
+    AssetManager* pAssets = Game::getInstance().getScene()->getAssetManager();
+    pAssets->getCullingBounds().cull(m_cullingFrustum, m_visibility);
+
+    OcclusionCuller* pOcclusionCuller = getOcclusionCuller();
+
+    if (occlusionPhase == OcclusionPhase::NONE || !pOcclusionCuller)
+    {
+        pAssets->cullInstances(m_cullingFrustum);
+        return;
+    }
+
+    pOcclusionCuller->removeOccluded(pAssets->getCullingBounds(), m_visibility, m_occludedSlots);
+    pAssets->cullInstances(m_cullingFrustum, pOcclusionCuller, occlusionPhase);
+}
+
+void Camera::getShadowMapping(CameraUniforms& cameraUniforms) const
+{
+    for (int i = 0; i < SHADOW_CASCADE_COUNT; i++)
+        cameraUniforms.lightPvMatrices[i] = m_sunPvMatrix;
+
+    cameraUniforms.shadowLayer = 0;
+}
+
 void Camera::computeSunPvMatrix()
 {
     Transform* pTransform = getGameObject()->getTransform();
@@ -178,6 +204,23 @@ void Camera::computeSunPvMatrix()
     m_sunPvMatrix = m_sunPMatrix * m_sunVMatrix;
 }
 
+void Camera::bindViewUniforms(UniformBuffer& buffer, int slot, const glm::mat4& perspectiveMatrix, const glm::mat4& viewMatrix,
+    ProgramOutputMode outputMode)
+{
+    ViewUniforms viewUniforms = {};
+    viewUniforms.projectionMatrix = perspectiveMatrix;
+    viewUniforms.viewMatrix = viewMatrix;
+    viewUniforms.outputMode = (GLint)outputMode;
+
+    bindViewUniforms(buffer, slot, viewUniforms);
+}
+
+void Camera::bindViewUniforms(UniformBuffer& buffer, int slot, const ViewUniforms& viewUniforms)
+{
+    buffer.update(&viewUniforms, slot);
+    buffer.bind(UniformBlockBinding::VIEW, slot);
+}
+
 void Camera::getViewport(int& x, int& y, int& width, int& height)
 {
     x = y = 0;
@@ -188,71 +231,155 @@ void Camera::renderSky(const glm::mat4& transformMatrix)
 {
     m_pSkyShaderProgram->bind();
 
-    GLint pId = m_pSkyShaderProgram->getUniform("P");
-    GLint vId = m_pSkyShaderProgram->getUniform("V");
-    GLint mId = m_pSkyShaderProgram->getUniform("M");
+    GLState::disable(GL_CULL_FACE);
 
-    if (pId != -1 && vId != -1 && mId != -1)
+    GLint mId = m_pSkyShaderProgram->getUniform(UniformId::M);
+
+    if (mId != -1)
     {
-        glActiveTexture((GLenum)TextureType::BACKGROUND);
-        glBindTexture(GL_TEXTURE_2D, m_pSkyTexture->getTextureId());
+        GLState::activeTexture((GLenum)TextureType::BACKGROUND);
+        GLState::bindTexture(GL_TEXTURE_2D, m_pSkyTexture->getTextureId());
 
         glm::mat4 skyModelMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(transformMatrix[3])) *
             glm::rotate(glm::mat4(1.0f), glm::pi<float>() * 0.5f, glm::vec3(1.0f, 0.0f, 0.0f));
 
-        glUniformMatrix4fv(pId, 1, GL_FALSE, &m_perspectiveMatrix[0][0]);
-        glUniformMatrix4fv(vId, 1, GL_FALSE, &m_viewMatrix[0][0]);
         glUniformMatrix4fv(mId, 1, GL_FALSE, &skyModelMatrix[0][0]);
 
         m_pSkyShape->draw(m_pSkyShaderProgram);
     }
     else
     {
-        std::cerr << "Sky shader is missing one of the following uniforms: P, V, M." << std::endl;
+        std::cerr << "Sky shader is missing the M uniform." << std::endl;
     }
 
     m_pSkyShaderProgram->unbind();
 }
 
-void Camera::renderUnblendedRenderables(const RenderConfiguration& configuration)
+bool Camera::hasVisibleRenderables(const RenderConfiguration& configuration)
 {
     AssetManager* pAssets = Game::getInstance().getScene()->getAssetManager();
 
-    for (auto shaderProgramNode : pAssets->getRenderTree())
+    for (const DrawItem& item : pAssets->getDrawList().getItems())
     {
-        Program* pShaderProgram = shaderProgramNode.first;
+        if ((item.passes & configuration.pass) && item.pRenderable && isVisible(item.boundsSlot))
+            return true;
+    }
+
+    pAssets->sortBlendedRenderables(this);
+
+    for (BlendedNode* pBlendedNode : pAssets->getSortedBlendedRenderables())
+    {
+        if ((pBlendedNode->passes & configuration.pass) && isVisible(pBlendedNode->boundsSlot))
+            return true;
+    }
+
+    return false;
+}
+
+template<typename SlotFilter>
+void Camera::renderUnblendedItems(const RenderConfiguration& configuration, SlotFilter isSelected)
+{
+    AssetManager* pAssets = Game::getInstance().getScene()->getAssetManager();
+    DrawBatch* pDrawBatch = pAssets->getDrawBatch();
 
-        if (pShaderProgram)
+    Program* pShaderProgram = nullptr;
+    Texture* pColorTexture = nullptr;
+
+    // Items are sorted by program, then texture, so each change ends the current multi-draw.
+    // Renderables with their own normal texture still need it bound, so they are drawn individually.
+    for (const DrawItem& item : pAssets->getDrawList().getItems())
+    {
+        if (!(item.passes & configuration.pass) || !item.pRenderable || !isSelected(item.boundsSlot))
+            continue;
+
+        if (pShaderProgram != item.pShaderProgram)
         {
-            if (!configuration.canUseShader(pShaderProgram))
-            {
-                continue;
-            }
+            pDrawBatch->submit();
 
-            pShaderProgram->bind();
+            if (pShaderProgram)
+                pShaderProgram->unbind();
 
-            configuration.configureShader(pShaderProgram);
+            pShaderProgram = item.pShaderProgram;
+            pColorTexture = nullptr;
+
+            if (pShaderProgram)
+                pShaderProgram->bind();
         }
 
-        for (auto textureNode : *shaderProgramNode.second)
+        if (pColorTexture != item.pTexture)
         {
-            Texture* pTexture = textureNode.first;
+            pDrawBatch->submit();
 
-            if (pTexture)
-            {
-                setUpTexture(TextureType::IMAGE, pTexture);
-            }
+            pColorTexture = item.pTexture;
 
-            for (auto pRenderable : *textureNode.second)
-            {
-                findAndSetUpTexture(pAssets, TextureType::NORMAL, pRenderable->getNormalTextureId());
-                pRenderable->render();
-            }
+            if (pColorTexture)
+                setUpTexture(TextureType::IMAGE, pColorTexture);
         }
 
-        if (pShaderProgram)
-            pShaderProgram->unbind();
+        Renderable* pRenderable = item.pRenderable;
+        const std::string& normalTextureId = pRenderable->getNormalTextureId();
+
+        pDrawBatch->setBoundsSlot(item.boundsSlot);
+
+        if (normalTextureId.empty() && pRenderable->addToBatch(*pDrawBatch))
+            continue;
+
+        findAndSetUpTexture(pAssets, TextureType::NORMAL, normalTextureId);
+        pRenderable->render();
+    }
+
+    pDrawBatch->submit();
+
+    if (pShaderProgram)
+        pShaderProgram->unbind();
+
+    // Renderables leave face culling as they need it, so restore the default for the passes that follow.
+    GLState::disable(GL_CULL_FACE);
+}
+
+void Camera::renderUnblendedRenderables(const RenderConfiguration& configuration)
+{
+    renderUnblendedItems(configuration, [this](uint32_t boundsSlot) { return isVisible(boundsSlot); });
+}
+
+void Camera::renderRevealedRenderables(const RenderConfiguration& configuration, OcclusionCuller* pOcclusionCuller)
+{
+    if (std::find(m_occludedSlots.begin(), m_occludedSlots.end(), 1) == m_occludedSlots.end())
+        return;
+
+    DrawBatch* pDrawBatch = Game::getInstance().getScene()->getAssetManager()->getDrawBatch();
+
+    pDrawBatch->setVisibilityTest(pOcclusionCuller->getDrawVisibilityShader(), pOcclusionCuller->getResultBuffer());
+    renderUnblendedItems(configuration, [this](uint32_t boundsSlot)
+    {
+        return boundsSlot < m_occludedSlots.size() && m_occludedSlots[boundsSlot];
+    });
+    pDrawBatch->setVisibilityTest(nullptr, 0);
+
+    for (size_t i = 0; i < m_occludedSlots.size(); i++)
+    {
+        if (m_occludedSlots[i])
+            m_visibility[i] = 1;
     }
+
+    m_occludedSlots.clear();
+}
+
+void Camera::renderDrawItem(const DrawItem& item)
+{
+    AssetManager* pAssets = Game::getInstance().getScene()->getAssetManager();
+
+    if (item.pShaderProgram)
+        item.pShaderProgram->bind();
+
+    if (item.pTexture)
+        setUpTexture(TextureType::IMAGE, item.pTexture);
+
+    findAndSetUpTexture(pAssets, TextureType::NORMAL, item.pRenderable->getNormalTextureId());
+    item.pRenderable->render();
+
+    if (item.pShaderProgram)
+        item.pShaderProgram->unbind();
 }
 
 void Camera::renderBlendedRenderables(const RenderConfiguration& configuration)
@@ -266,6 +393,9 @@ void Camera::renderBlendedRenderables(const RenderConfiguration& configuration)
 
     for (BlendedNode* pBlendedNode : pAssets->getSortedBlendedRenderables())
     {
+        if (!(pBlendedNode->passes & configuration.pass) || !isVisible(pBlendedNode->boundsSlot))
+            continue;
+
         if (pShaderProgram != pBlendedNode->pShaderProgram)
         {
             if (pShaderProgram)
@@ -277,15 +407,7 @@ void Camera::renderBlendedRenderables(const RenderConfiguration& configuration)
 
             if (pShaderProgram)
             {
-                if (!configuration.canUseShader(pShaderProgram))
-                {
-                    pShaderProgram = nullptr;
-                    continue;
-                }
-
                 pShaderProgram->bind();
-
-                configuration.configureShader(pShaderProgram);
             }
         }
 
@@ -308,6 +430,8 @@ void Camera::renderBlendedRenderables(const RenderConfiguration& configuration)
 
     if (pShaderProgram)
         pShaderProgram->unbind();
+
+    GLState::disable(GL_CULL_FACE);
 }
 
 void Camera::findAndSetUpTexture(AssetManager* pAssets, TextureType type, const std::string& textureId)
@@ -327,12 +451,11 @@ void Camera::findAndSetUpTexture(AssetManager* pAssets, TextureType type, const
 
 void Camera::setUpTexture(TextureType type, Texture* pTexture)
 {
-    glActiveTexture((GLenum)type);
-    glBindTexture(GL_TEXTURE_2D, pTexture->getTextureId());
+    GLState::activeTexture((GLenum)type);
+    GLState::bindTexture(GL_TEXTURE_2D, pTexture->getTextureId());
 }
 
 bool Camera::doesProgramHaveDynamicOutput(Program* pShaderProgram)
 {
-    auto programMetadata = (ProgramMetadata)(uintptr_t)pShaderProgram->getUserPointer();
-    return programMetadata == ProgramMetadata::USES_DYNAMIC_OUTPUT;
+    return hasProgramMetadata(pShaderProgram, ProgramMetadata::USES_DYNAMIC_OUTPUT);
 }
@@ -1,6 +1,7 @@
 #include "Components/BikeController.h"
 
 #include <iostream>
+#include <string>
 #include <GLFW/glfw3.h>
 
 #include "Game.h"
@@ -465,4 +466,7 @@ void BikeController::kill()
         pLightTrail->setEnabled(false);
 
     m_isDead = true;
+
+    Game::getInstance().getScene()->getPhysicsProfiler()->recordEvent(
+        "player " + std::to_string(m_pBikeRenderer->getPlayerId()) + " death");
 }
@@ -4,12 +4,10 @@
 
 #include "Game.h"
 
-void BikeRenderer::render()
+void BikeRenderer::fillDrawData(DrawData& drawData) const
 {
-    glUniform1i(getShaderProgram()->getUniform("playerId"), m_playerId);
-    glUniform1f(getShaderProgram()->getUniform("transitionAmount"), m_transitionAmount);
-
-    MeshRenderer::render();
+    drawData.playerId = m_playerId;
+    drawData.transitionAmount = m_transitionAmount;
 }
 
 void BikeRenderer::setTransitionAmount(float transitionAmount)
@@ -4,6 +4,7 @@
 #include <glm/gtc/random.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "Game.h"
 #include "GameConstants.h"
 #include "ConversionUtils.h"
 #include "StaticCollisionObjectInfo.h"
@@ -14,6 +15,8 @@ namespace GC = GameConstants;
 
 void ChunkManager::spawnChunk(int playerId, float maxScale, const glm::vec3& location, const glm::vec3& velocity)
 {
+    Game::getInstance().getScene()->getPhysicsProfiler()->recordChunksSpawned(1);
+
     float scale = glm::linearRand(GC::minChunkscale, maxScale >= GC::maxChunkScale
         ? GC::maxChunkScale
         : maxScale);
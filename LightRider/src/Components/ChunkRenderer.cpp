@@ -2,10 +2,7 @@
 
 #include "Game.h"
 
-void ChunkRenderer::render()
+void ChunkRenderer::fillDrawData(DrawData& drawData) const
 {
-    glUniform1i(getShaderProgram()->getUniform("playerId"), m_playerId);
-
-    MeshRenderer::render();
+    drawData.playerId = m_playerId;
 }
-
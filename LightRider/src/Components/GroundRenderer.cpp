@@ -1,6 +1,7 @@
 #include "Components/GroundRenderer.h"
 
 #include "Game.h"
+#include "GLState.h"
 
 bool GroundRenderer::initialize()
 {
@@ -16,10 +17,8 @@ bool GroundRenderer::initialize()
 
 void GroundRenderer::render()
 {
-    glActiveTexture(GL_TEXTURE3);
-    glBindTexture(GL_TEXTURE_2D, m_pSkyTexture->getTextureId());
-
-    glUniform3fv(getShaderProgram()->getUniform("campos"), 1, &Game::getInstance().getScene()->getActiveCamera()->getTransform()->getPosition()[0]);
+    GLState::activeTexture(GL_TEXTURE3);
+    GLState::bindTexture(GL_TEXTURE_2D, m_pSkyTexture->getTextureId());
 
     MeshRenderer::render();
 }
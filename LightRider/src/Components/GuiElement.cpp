@@ -1,6 +1,7 @@
 #include "Components/GuiElement.h"
 
 #include "Game.h"
+#include "GLState.h"
 
 GuiElement::GuiElement(const std::string& shaderId, const std::string& textureId, Camera* pCamera) : 
     Renderable(shaderId, textureId, true),
@@ -105,10 +106,11 @@ void GuiElement::render()
             1.0f
         ));
 
-    glUniform1f(m_pShaderProgram->getUniform("bloomFactor"), m_bloomFactor);
-    glUniformMatrix4fv(m_pShaderProgram->getUniform("M"), 1, GL_FALSE, &transformMatrix[0][0]);
+    glUniform1f(m_pShaderProgram->getUniform(UniformId::BLOOM_FACTOR), m_bloomFactor);
+    glUniformMatrix4fv(m_pShaderProgram->getUniform(UniformId::M), 1, GL_FALSE, &transformMatrix[0][0]);
 
-    glBlendFunci(0, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    GLState::disable(GL_CULL_FACE);
+    GLState::blendFunc(0, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
     m_pShape->draw(m_pShaderProgram);
 }
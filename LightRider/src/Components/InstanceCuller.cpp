@@ -0,0 +1,136 @@
+#include "Components/InstanceCuller.h"
+
+#include <cstddef>
+#include <iostream>
+
+#include "Game.h"
+#include "DrawBatch.h"
+
+InstanceCuller::InstanceCuller(const std::vector<glm::vec4>& instances) :
+    m_instances(instances),
+    m_pMeshRenderer(nullptr),
+    m_pShape(nullptr),
+    m_pCullShader(nullptr),
+    m_instanceBuffer(0),
+    m_commandBuffer(0)
+{
+}
+
+InstanceCuller::~InstanceCuller()
+{
+    if (!m_commandBuffer)
+        return;
+
+    Game::getInstance().getScene()->getAssetManager()->_unregisterInstanceCuller(this);
+
+    m_pShape->setIndirectBuffer(0);
+
+    glDeleteBuffers(1, &m_instanceBuffer);
+    glDeleteBuffers(1, &m_commandBuffer);
+}
+
+bool InstanceCuller::initialize()
+{
+    m_pMeshRenderer = getGameObject()->getComponent<MeshRenderer>();
+
+    if (!m_pMeshRenderer || !m_pMeshRenderer->getShape()->usesInstancing())
+    {
+        std::cerr << "InstanceCuller requires a MeshRenderer with an instanced shape." << std::endl;
+        return false;
+    }
+
+    m_pShape = m_pMeshRenderer->getShape();
+
+    if (m_pShape->getInstanceCount() != (GLsizeiptr)m_instances.size())
+    {
+        std::cerr << "InstanceCuller instances do not match the shape's instance data." << std::endl;
+        return false;
+    }
+
+    AssetManager* pAssets = Game::getInstance().getScene()->getAssetManager();
+    m_pCullShader = pAssets->getComputeShaderProgram("instanceCullCompute");
+
+    glGenBuffers(1, &m_instanceBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_instanceBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, m_instances.size() * sizeof(glm::vec4), m_instances.data(), GL_STATIC_DRAW);
+
+    std::vector<DrawElementsIndirectCommand> commands(m_pShape->getObjectCount());
+
+    for (int i = 0; i < m_pShape->getObjectCount(); i++)
+    {
+        const GeometryRange& range = m_pShape->getGeometryRange(i);
+
+        // The shape's vertex arrays already point at the object's first vertex, so the base vertex stays zero.
+        commands[i] = { range.indexCount, (GLuint)m_instances.size(), range.firstIndex, 0, 0 };
+    }
+
+    glGenBuffers(1, &m_commandBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_commandBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    m_pShape->setIndirectBuffer(m_commandBuffer);
+    pAssets->_registerInstanceCuller(this);
+
+    return true;
+}
+
+void InstanceCuller::cull(const ViewFrustum& frustum, OcclusionCuller* pOcclusionCuller, OcclusionPhase phase)
+{
+    // The depth pyramid is only needed by the second phase, but the first relies on the history it writes.
+    if (!pOcclusionCuller || !pOcclusionCuller->isReady())
+        phase = OcclusionPhase::NONE;
+
+    glm::mat4 modelMatrix = getTransform()->getTransformMatrix() * m_pMeshRenderer->getLocalTransform();
+
+    const GLuint instanceCountOffset = offsetof(DrawElementsIndirectCommand, instanceCount);
+    const GLuint zero = 0;
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_commandBuffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, instanceCountOffset, sizeof(GLuint), &zero);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    m_pCullShader->bind();
+    glUniform4fv(m_pCullShader->getUniform("frustumPlanes"), 6, &frustum.getPlanes()[0][0]);
+    glUniformMatrix4fv(m_pCullShader->getUniform("M"), 1, GL_FALSE, &modelMatrix[0][0]);
+    glUniform3fv(m_pCullShader->getUniform("boundsMin"), 1, &m_pShape->getBoundsMin()[0]);
+    glUniform3fv(m_pCullShader->getUniform("boundsMax"), 1, &m_pShape->getBoundsMax()[0]);
+    glUniform1ui(m_pCullShader->getUniform("instanceCount"), (GLuint)m_instances.size());
+    glUniform1i(m_pCullShader->getUniform("occlusionPhase"), (GLint)phase);
+
+    if (phase != OcclusionPhase::NONE)
+    {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, pOcclusionCuller->getInstanceHistoryBuffer(this, m_instances.size()));
+        pOcclusionCuller->bindPyramid(m_pCullShader);
+    }
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_instanceBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_pShape->getInstanceBuffer(0));
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_commandBuffer);
+
+    glDispatchCompute(((GLuint)m_instances.size() + WORK_GROUP_SIZE - 1) / WORK_GROUP_SIZE, 1, 1);
+    m_pCullShader->unbind();
+
+    // Each object has its own instance buffer and command, so the first object's results are copied to the rest.
+    if (m_pShape->getObjectCount() > 1)
+    {
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+        for (int i = 1; i < m_pShape->getObjectCount(); i++)
+        {
+            glBindBuffer(GL_COPY_READ_BUFFER, m_pShape->getInstanceBuffer(0));
+            glBindBuffer(GL_COPY_WRITE_BUFFER, m_pShape->getInstanceBuffer(i));
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, m_instances.size() * sizeof(glm::vec4));
+
+            glBindBuffer(GL_COPY_READ_BUFFER, m_commandBuffer);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, m_commandBuffer);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, instanceCountOffset,
+                i * sizeof(DrawElementsIndirectCommand) + instanceCountOffset, sizeof(GLuint));
+        }
+
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+
+    glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+}
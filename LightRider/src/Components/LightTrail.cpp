@@ -1,6 +1,7 @@
 #include "Components/LightTrail.h"
 
 #include "Game.h"
+#include "GLState.h"
 #include "GameConstants.h"
 #include "ConversionUtils.h"
 #include "StaticCollisionObjectInfo.h"
@@ -11,6 +12,7 @@ LightTrail::LightTrail(int playerId) :
     Renderable("trailShader", "", true),
     m_playerId(playerId),
     m_pShaderProgram(Game::getInstance().getScene()->getAssetManager()->getShaderProgram(getShaderProgramId())),
+    m_pNoiseTexture(Game::getInstance().getScene()->getAssetManager()->getTexture("trailNoiseTexture")),
     m_pRigidBody(nullptr),
     m_pCompoundShape(nullptr),
     m_pNextSegment(nullptr),
@@ -20,49 +22,24 @@ LightTrail::LightTrail(int playerId) :
     m_physicsTime(0.0f),
     m_lastVertex1(0.0f, 0.0f, 0.0f),
     m_lastVertex2(0.0f, 0.0f, 0.0f),
-    m_lastTimeStamp(0.0f),
-    m_trailVertices(),
-    m_trailHeights(),
-    m_trailTimeStamps(),
-    m_trailVertexCount(6),
-    m_trailBufferSize(1024 * 8)
+    m_trailPages(),
+    m_headTop(0.0f, 0.0f, 0.0f),
+    m_headBottom(0.0f, 0.0f, 0.0f),
+    m_drawFirsts(),
+    m_drawCounts()
 {
     glGenVertexArrays(1, &m_trailVertexArray);
-    glBindVertexArray(m_trailVertexArray);
 
-    glGenBuffers(1, &m_trailVertexBuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, m_trailVertexBuffer);
-
-    glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * m_trailBufferSize, NULL, GL_DYNAMIC_DRAW);
-
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
-
-    glGenBuffers(1, &m_trailHeightBuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, m_trailHeightBuffer);
-
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * m_trailBufferSize, NULL, GL_DYNAMIC_DRAW);
-
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, 0, (void*)0);
-
-    glGenBuffers(1, &m_trailTimeStampBuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, m_trailTimeStampBuffer);
-
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * m_trailBufferSize, NULL, GL_DYNAMIC_DRAW);
-
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, 0, (void*)0);
-
-    glBindVertexArray(0);
+    addTrailPage();
 }
 
 LightTrail::~LightTrail()
 {
     glDeleteVertexArrays(1, &m_trailVertexArray);
-    glDeleteBuffers(1, &m_trailVertexBuffer);
-    glDeleteBuffers(1, &m_trailHeightBuffer);
-    glDeleteBuffers(1, &m_trailTimeStampBuffer);
+    GLState::invalidate();
+
+    for (TrailPage& page : m_trailPages)
+        glDeleteBuffers(1, &page.edgeBuffer);
 
     Game::getInstance().getScene()->getDynamicsWorld()->removeCollisionObject(m_pRigidBody);
 
@@ -106,6 +83,8 @@ void LightTrail::physicsTick(float physicsTimeStep)
 {
     m_physicsTime += physicsTimeStep;
 
+    Game::getInstance().getScene()->getPhysicsProfiler()->recordTrailSegments(m_pCompoundShape->getNumChildShapes());
+
     if (!m_isEnabled)
         return;
 
@@ -119,7 +98,8 @@ void LightTrail::physicsTick(float physicsTimeStep)
         m_isInitialized = true;
         m_lastVertex1 = vertex1;
         m_lastVertex2 = vertex2;
-        m_lastTimeStamp = m_physicsTime;
+
+        appendEdge(vertex1, vertex2, m_physicsTime);
 
         return;
     }
@@ -128,31 +108,7 @@ void LightTrail::physicsTick(float physicsTimeStep)
         glm::length(vertex2 - m_lastVertex2) < GC::bikeMinTrailSegmentLength)
         return;
 
-    glm::vec3 segmentVertices[6];
-    float segmentHeights[6];
-    float segmentTimeStamps[6];
-
-    generateSegmentData(vertex1, vertex2, segmentVertices, segmentHeights, segmentTimeStamps);
-
-    int trailVertexOffset = m_trailVertexCount - 6;
-    m_trailVertexCount += 6;
-
-    m_trailVertices.resize(m_trailVertexCount);
-    m_trailHeights.resize(m_trailVertexCount);
-    m_trailTimeStamps.resize(m_trailVertexCount);
-
-    m_trailVertices.insert(m_trailVertices.begin() + trailVertexOffset, segmentVertices, segmentVertices + 6);
-    m_trailHeights.insert(m_trailHeights.begin() + trailVertexOffset, segmentHeights, segmentHeights + 6);
-    m_trailTimeStamps.insert(m_trailTimeStamps.begin() + trailVertexOffset, segmentTimeStamps, segmentTimeStamps + 6);
-
-    glBindVertexArray(m_trailVertexArray);
-
-    if (m_trailVertexCount > m_trailBufferSize)
-        reallocateTrailBuffer(m_trailBufferSize * 2);
-    else
-        writeSegmentData(trailVertexOffset, segmentVertices, segmentHeights, segmentTimeStamps);
-
-    glBindVertexArray(0);
+    appendEdge(vertex1, vertex2, m_physicsTime);
 
     if (m_pNextSegment)
         m_pCompoundShape->addChildShape(btTransform::getIdentity(), m_pNextSegment);
@@ -166,7 +122,6 @@ void LightTrail::physicsTick(float physicsTimeStep)
 
     m_lastVertex1 = vertex1;
     m_lastVertex2 = vertex2;
-    m_lastTimeStamp = m_physicsTime;
 
     Renderable::physicsTick(physicsTimeStep);
 }
@@ -178,22 +133,16 @@ void LightTrail::postUpdate(float deltaTime)
     if (!m_isEnabled)
         return;
 
-    glBindVertexArray(m_trailVertexArray);
-
     glm::vec3 vertex1;
     glm::vec3 vertex2;
-    float timeStamp = (float)Game::getInstance().getTick();
 
     calculateTrailEdge(vertex1, vertex2);
 
-    glm::vec3 segmentVertices[6];
-    float segmentHeights[6];
-    float segmentTimeStamps[6];
-
-    generateSegmentData(vertex1, vertex2, segmentVertices, segmentHeights, segmentTimeStamps);
-    writeSegmentData(m_trailVertexCount - 6, segmentVertices, segmentHeights, segmentTimeStamps);
+    m_headTop = vertex1;
+    m_headBottom = vertex2;
 
-    glBindVertexArray(0);
+    const TrailPage& page = m_trailPages.back();
+    writeEdge(page, page.edgeCount, vertex1, vertex2, m_physicsTime);
 
     Renderable::postUpdate(deltaTime);
 }
@@ -203,18 +152,81 @@ void LightTrail::render()
     if (!m_isInitialized)
         return;
     
-    glUniform1i(m_pShaderProgram->getUniform("playerId"), m_playerId);
-    glUniform1f(m_pShaderProgram->getUniform("noiseSeed"), m_continuousTime);
-    glUniform1f(m_pShaderProgram->getUniform("currentTime"), m_physicsTime);
+    glUniform1i(m_pShaderProgram->getUniform(UniformId::PLAYER_ID), m_playerId);
+    glUniform1f(m_pShaderProgram->getUniform(UniformId::NOISE_SEED), m_continuousTime);
+    glUniform1f(m_pShaderProgram->getUniform(UniformId::CURRENT_TIME), m_physicsTime);
+    glUniform1i(m_pShaderProgram->getUniform(UniformId::USE_NOISE_VOLUME), GC::trailUseNoiseVolume);
 
-    glBindVertexArray(m_trailVertexArray);
+    GLState::activeTexture(GL_TEXTURE6);
+    GLState::bindTexture(GL_TEXTURE_3D, m_pNoiseTexture->getTextureId());
 
-    glBlendFunci(0, GL_SRC_ALPHA, GL_ONE);
-    glDepthMask(GL_FALSE);//glDisable(GL_DEPTH_TEST);
-    glDrawArrays(GL_TRIANGLES, 0, m_trailVertexCount);
-    glDepthMask(GL_TRUE);
+    GLState::bindVertexArray(m_trailVertexArray);
 
-    glBindVertexArray(0);
+    GLState::disable(GL_CULL_FACE);
+    GLState::blendFunc(0, GL_SRC_ALPHA, GL_ONE);
+    GLState::depthMask(GL_FALSE);//glDisable(GL_DEPTH_TEST);
+
+    const ViewFrustum& cullingFrustum = Game::getInstance().getScene()->getActiveCamera()->getCullingFrustum();
+
+    for (size_t i = 0; i < m_trailPages.size(); i++)
+    {
+        const TrailPage& page = m_trailPages[i];
+        bool isLastPage = i == m_trailPages.size() - 1;
+
+        // The last page also contains the head edge.
+        int edgeCount = isLastPage ? page.edgeCount + 1 : page.edgeCount;
+
+        m_drawFirsts.clear();
+        m_drawCounts.clear();
+
+        for (size_t j = 0; j < page.blocks.size(); j++)
+        {
+            // Blocks share their boundary edge with the next block so the strip stays continuous.
+            int firstEdge = (int)j * GC::trailBlockEdgeCount;
+            int lastEdge = glm::min(firstEdge + GC::trailBlockEdgeCount, edgeCount - 1);
+
+            if (lastEdge <= firstEdge)
+                break;
+
+            glm::vec3 blockMin = page.blocks[j].min;
+            glm::vec3 blockMax = page.blocks[j].max;
+
+            if (isLastPage && lastEdge == page.edgeCount)
+            {
+                blockMin = glm::min(blockMin, glm::min(m_headTop, m_headBottom));
+                blockMax = glm::max(blockMax, glm::max(m_headTop, m_headBottom));
+            }
+
+            if (!cullingFrustum.intersectsAabb(blockMin, blockMax))
+                continue;
+
+            GLint first = firstEdge * 2;
+            GLsizei count = (lastEdge - firstEdge + 1) * 2;
+
+            // Merge with the previous range if it ends on this block's first edge.
+            if (!m_drawFirsts.empty() && m_drawFirsts.back() + m_drawCounts.back() == first + 2)
+            {
+                m_drawCounts.back() = first + count - m_drawFirsts.back();
+            }
+            else
+            {
+                m_drawFirsts.push_back(first);
+                m_drawCounts.push_back(count);
+            }
+        }
+
+        if (m_drawFirsts.empty())
+            continue;
+
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, page.edgeBuffer);
+        glMultiDrawArrays(GL_TRIANGLE_STRIP, m_drawFirsts.data(), m_drawCounts.data(), (GLsizei)m_drawFirsts.size());
+    }
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+
+    GLState::depthMask(GL_TRUE);
+
+    GLState::bindVertexArray(0);
 }
 
 void LightTrail::calculateTrailEdge(glm::vec3& vertex1, glm::vec3& vertex2)
@@ -229,56 +241,68 @@ void LightTrail::calculateTrailEdge(glm::vec3& vertex1, glm::vec3& vertex2)
     vertex2 = glm::vec3(vertex2Transform[3]);
 }
 
-void LightTrail::generateSegmentData(const glm::vec3& edgeVertex1, const glm::vec3& edgeVertex2,
-    glm::vec3* pSegmentVertices, float* pSegmentHeights, float* pSegmentTimeStamps)
+void LightTrail::writeEdge(const TrailPage& page, int index, const glm::vec3& top, const glm::vec3& bottom, float timeStamp)
 {
-    pSegmentVertices[0] = m_lastVertex1;
-    pSegmentVertices[1] = edgeVertex2;
-    pSegmentVertices[2] = edgeVertex1;
-    pSegmentVertices[3] = m_lastVertex1;
-    pSegmentVertices[4] = m_lastVertex2;
-    pSegmentVertices[5] = edgeVertex2;
-
-    pSegmentHeights[0] = 1;
-    pSegmentHeights[1] = -1;
-    pSegmentHeights[2] = 1;
-    pSegmentHeights[3] = 1;
-    pSegmentHeights[4] = -1;
-    pSegmentHeights[5] = -1;
-
-    pSegmentTimeStamps[0] = m_lastTimeStamp;
-    pSegmentTimeStamps[1] = m_physicsTime;
-    pSegmentTimeStamps[2] = m_physicsTime;
-    pSegmentTimeStamps[3] = m_lastTimeStamp;
-    pSegmentTimeStamps[4] = m_lastTimeStamp;
-    pSegmentTimeStamps[5] = m_physicsTime;
+    TrailEdge edge = { top, timeStamp, bottom, 0.0f };
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, page.edgeBuffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(TrailEdge) * index, sizeof(TrailEdge), &edge);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 }
 
-void LightTrail::writeSegmentData(int offset, glm::vec3* pSegmentVertices, float* pSegmentHeights, float* pSegmentTimeStamps)
+void LightTrail::appendEdge(const glm::vec3& top, const glm::vec3& bottom, float timeStamp)
 {
-    glBindBuffer(GL_ARRAY_BUFFER, m_trailVertexBuffer);
-    glBufferSubData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * offset, sizeof(glm::vec3) * 6, pSegmentVertices);
+    TrailPage& page = m_trailPages.back();
+    writeEdge(page, page.edgeCount, top, bottom, timeStamp);
+    expandTrailBlocks(page, page.edgeCount, top, bottom);
+    page.edgeCount++;
 
-    glBindBuffer(GL_ARRAY_BUFFER, m_trailHeightBuffer);
-    glBufferSubData(GL_ARRAY_BUFFER, sizeof(float) * offset, sizeof(float) * 6, pSegmentHeights);
+    m_headTop = top;
+    m_headBottom = bottom;
 
-    glBindBuffer(GL_ARRAY_BUFFER, m_trailTimeStampBuffer);
-    glBufferSubData(GL_ARRAY_BUFFER, sizeof(float) * offset, sizeof(float) * 6, pSegmentTimeStamps);
+    // The new page starts with the edge we just wrote so that the segment between the two pages
+    // is not lost, and so the last page always has room for the head edge.
+    if (page.edgeCount == GC::trailPageEdgeCount)
+    {
+        addTrailPage();
+        appendEdge(top, bottom, timeStamp);
+    }
 }
 
-void LightTrail::reallocateTrailBuffer(int size)
+void LightTrail::expandTrailBlocks(TrailPage& page, int index, const glm::vec3& top, const glm::vec3& bottom)
 {
-    m_trailBufferSize = size;
+    glm::vec3 edgeMin = glm::min(top, bottom);
+    glm::vec3 edgeMax = glm::max(top, bottom);
+
+    int blockIndex = index / GC::trailBlockEdgeCount;
 
-    glBindBuffer(GL_ARRAY_BUFFER, m_trailVertexBuffer);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * m_trailBufferSize, NULL, GL_DYNAMIC_DRAW);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(glm::vec3) * m_trailVertexCount, m_trailVertices.data());
+    if (blockIndex == (int)page.blocks.size())
+    {
+        page.blocks.push_back({ edgeMin, edgeMax });
+    }
+    else
+    {
+        page.blocks[blockIndex].min = glm::min(page.blocks[blockIndex].min, edgeMin);
+        page.blocks[blockIndex].max = glm::max(page.blocks[blockIndex].max, edgeMax);
+    }
+
+    // The first edge of a block also closes the last segment of the previous block.
+    if (blockIndex > 0 && index % GC::trailBlockEdgeCount == 0)
+    {
+        page.blocks[blockIndex - 1].min = glm::min(page.blocks[blockIndex - 1].min, edgeMin);
+        page.blocks[blockIndex - 1].max = glm::max(page.blocks[blockIndex - 1].max, edgeMax);
+    }
+}
+
+void LightTrail::addTrailPage()
+{
+    TrailPage page;
+    page.edgeCount = 0;
 
-    glBindBuffer(GL_ARRAY_BUFFER, m_trailHeightBuffer);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * m_trailBufferSize, NULL, GL_DYNAMIC_DRAW);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(float) * m_trailVertexCount, m_trailHeights.data());
+    glGenBuffers(1, &page.edgeBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, page.edgeBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(TrailEdge) * GC::trailPageEdgeCount, NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 
-    glBindBuffer(GL_ARRAY_BUFFER, m_trailTimeStampBuffer);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * m_trailBufferSize, NULL, GL_DYNAMIC_DRAW);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(float) * m_trailVertexCount, m_trailTimeStamps.data());
+    m_trailPages.push_back(page);
 }
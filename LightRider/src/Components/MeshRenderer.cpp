@@ -1,18 +1,25 @@
 #include "Components/MeshRenderer.h"
 
+#include <cmath>
+
 #include "Game.h"
+#include "GLState.h"
+#include "ProgramMetadata.h"
 
 MeshRenderer::MeshRenderer(
     const std::string& shaderProgramId,
     const std::string& primaryTextureId,
     const std::string& shapeId,
     bool useBlending,
-    bool useDetailedShadows)
-    : Renderable(shaderProgramId, primaryTextureId, useBlending, useDetailedShadows),
+    bool useDetailedShadows,
+    const std::string& depthProgramId,
+    bool isStatic)
+    : Renderable(shaderProgramId, primaryTextureId, useBlending, useDetailedShadows, depthProgramId, isStatic),
     m_shapeId(shapeId),
     m_localTransform(1.0f),
     m_isCullingEnabled(true),
     m_isUsingForwardShadowRendering(false),
+    m_usesDrawData(false),
     m_pDepthFunc(nullptr)
 {
     AssetManager* pAssets = Game::getInstance().getScene()->getAssetManager();
@@ -32,19 +39,11 @@ MeshRenderer::MeshRenderer(
     m_pShaderProgram->setVerbose(true);
 
     m_pShape = pAssets->getShape(shapeId);
+    m_usesDrawData = hasProgramMetadata(m_pShaderProgram, ProgramMetadata::USES_DRAW_DATA);
 }
 
 void MeshRenderer::render()
 {
-    if (m_isCullingEnabled)
-    {
-        glEnable(GL_CULL_FACE);
-        glCullFace(GL_BACK);
-    }
-
-    glm::mat4 globalTransform = getGameObject()->getTransform()->getTransformMatrix() * m_localTransform;
-    glUniformMatrix4fv(m_pShaderProgram->getUniform("M"), 1, GL_FALSE, &globalTransform[0][0]);
-
     if (m_isUsingForwardShadowRendering)
     {
         Camera* pCamera = Game::getInstance().getScene()->getActiveCamera();
@@ -52,21 +51,87 @@ void MeshRenderer::render()
 
         if (shadowMapTextureId != 0)
         {
-            glActiveTexture(GL_TEXTURE4);
-            glBindTexture(GL_TEXTURE_2D, shadowMapTextureId);
+            GLState::activeTexture(GL_TEXTURE4);
+            GLState::bindTexture(GL_TEXTURE_2D_ARRAY, shadowMapTextureId);
 
             //glUniform3fv(m_pShaderProgram->getUniform("lightPosition"), 1, &pCamera->getSunPosition()[0]);
             //glUniform3fv(m_pShaderProgram->getUniform("lightDirection"), 1, &pCamera->getSunDirection()[0]);
-            glUniformMatrix4fv(m_pShaderProgram->getUniform("lightPV"), 1, GL_FALSE, &pCamera->getSunPvMatrix()[0][0]);
         }
     }
 
     if (usesBlending())
-        glBlendFunci(0, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        GLState::blendFunc(0, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    glm::mat4 globalTransform = getGameObject()->getTransform()->getTransformMatrix() * m_localTransform;
+
+    // Programs that read per-draw data have no M uniform, so they are drawn through a batch even when drawn alone.
+    if (m_usesDrawData)
+    {
+        DrawBatch* pDrawBatch = Game::getInstance().getScene()->getAssetManager()->getDrawBatch();
+
+        if (addToBatch(*pDrawBatch))
+        {
+            pDrawBatch->submit();
+            return;
+        }
+
+        // Shapes outside the arena are drawn with their own vertex array, which reads a single draw data entry.
+        DrawData drawData = {};
+        drawData.modelMatrix = globalTransform;
+        fillDrawData(drawData);
+        pDrawBatch->bindSingleDrawData(drawData);
+    }
+
+    // Culling state is left as-is after drawing, so consecutive meshes don't toggle it.
+    if (m_isCullingEnabled)
+    {
+        GLState::enable(GL_CULL_FACE);
+        GLState::cullFace(GL_BACK);
+    }
+    else
+    {
+        GLState::disable(GL_CULL_FACE);
+    }
+
+    if (!m_usesDrawData)
+        glUniformMatrix4fv(m_pShaderProgram->getUniform(UniformId::M), 1, GL_FALSE, &globalTransform[0][0]);
 
     m_pShape->draw(m_pShaderProgram);
+}
+
+bool MeshRenderer::getWorldBounds(glm::vec3& min, glm::vec3& max) const
+{
+    if (!m_pShape || m_pShape->usesInstancing())
+        return false;
+
+    glm::mat4 globalTransform = getGameObject()->getTransform()->getTransformMatrix() * m_localTransform;
 
-    glDisable(GL_CULL_FACE);
+    glm::vec3 localCenter = (m_pShape->getBoundsMin() + m_pShape->getBoundsMax()) * 0.5f;
+    glm::vec3 localExtent = (m_pShape->getBoundsMax() - m_pShape->getBoundsMin()) * 0.5f;
+
+    // Transform the box center, and bound the rotated box by the absolute values of the transform (Arvo).
+    glm::vec3 center = glm::vec3(globalTransform * glm::vec4(localCenter, 1.0f));
+    glm::vec3 extent =
+        glm::abs(glm::vec3(globalTransform[0])) * localExtent.x +
+        glm::abs(glm::vec3(globalTransform[1])) * localExtent.y +
+        glm::abs(glm::vec3(globalTransform[2])) * localExtent.z;
+
+    min = center - extent;
+    max = center + extent;
+
+    return true;
+}
+
+bool MeshRenderer::addToBatch(DrawBatch& batch)
+{
+    if (!m_usesDrawData || m_isUsingForwardShadowRendering)
+        return false;
+
+    DrawData drawData = {};
+    drawData.modelMatrix = getGameObject()->getTransform()->getTransformMatrix() * m_localTransform;
+    fillDrawData(drawData);
+
+    return batch.add(m_pShape, drawData, m_isCullingEnabled);
 }
 
 bool MeshRenderer::renderDepth(Program* pDepthProgram)
@@ -74,15 +139,34 @@ bool MeshRenderer::renderDepth(Program* pDepthProgram)
     if (usesBlending())
         return false;
 
-    glEnable(GL_CULL_FACE);
-    glCullFace(GL_BACK);
-
     glm::mat4 globalTransform = getGameObject()->getTransform()->getTransformMatrix() * m_localTransform;
-    glUniformMatrix4fv(pDepthProgram->getUniform("M"), 1, GL_FALSE, &globalTransform[0][0]);
-    
-    m_pShape->drawDepth(pDepthProgram);
 
-    glDisable(GL_CULL_FACE);
+    // Depth programs that read per-draw data have no M uniform, so they are drawn the way render() draws such programs.
+    if (hasProgramMetadata(pDepthProgram, ProgramMetadata::USES_DRAW_DATA))
+    {
+        DrawBatch* pDrawBatch = Game::getInstance().getScene()->getAssetManager()->getDrawBatch();
+
+        DrawData drawData = {};
+        drawData.modelMatrix = globalTransform;
+        fillDrawData(drawData);
+
+        if (pDrawBatch->add(m_pShape, drawData, true))
+        {
+            pDrawBatch->submit();
+            return true;
+        }
+
+        pDrawBatch->bindSingleDrawData(drawData);
+    }
+    else
+    {
+        glUniformMatrix4fv(pDepthProgram->getUniform(UniformId::M), 1, GL_FALSE, &globalTransform[0][0]);
+    }
+
+    GLState::enable(GL_CULL_FACE);
+    GLState::cullFace(GL_BACK);
+
+    m_pShape->drawDepth(pDepthProgram);
 
     return true;
 }
@@ -91,3 +175,13 @@ float MeshRenderer::getDepth(Camera* pCamera) const
 {
     return m_pDepthFunc ? m_pDepthFunc(pCamera) : Renderable::getDepth(pCamera);
 }
+
+float MeshRenderer::getSortDepth(Camera* pCamera) const
+{
+    if (!m_pDepthFunc)
+        return Renderable::getSortDepth(pCamera);
+
+    // Square the custom depth, keeping its sign, so that it compares correctly against squared distances.
+    float depth = m_pDepthFunc(pCamera);
+    return depth * std::abs(depth);
+}
@@ -1,13 +1,19 @@
 #include "Components/ProcessedCamera.h"
 
+#include <algorithm>
+#include <iterator>
 #include <string>
 #include <random>
+#include <cstdlib>
+#include <iostream>
 
 #include "Game.h"
 #include "GLSL.h"
+#include "GLState.h"
 #include "GameConstants.h"
 #include "ProgramMetadata.h"
 #include "ProgramOutputMode.h"
+#include "Components/InstanceCuller.h"
 
 namespace GC = GameConstants;
 
@@ -16,21 +22,60 @@ constexpr int constLog2(int n)
     return n < 2 ? 1 : 1 + constLog2(n >> 1);
 }
 
-constexpr int SHADOW_MAP_WIDTH = 8192;
-constexpr int SHADOW_MAP_HEIGHT = 8192;
 constexpr int NOISE_DIMENSION = 4;
 constexpr int NOISE_SIZE = NOISE_DIMENSION * NOISE_DIMENSION;
 constexpr GLsizei VOXEL_MAP_DIMENSION = 128;
 constexpr GLsizei VOXEL_CAMERA_RESOLUTION = 1024;
 constexpr int VOXEL_MAP_MIP_LEVELS = constLog2(VOXEL_MAP_DIMENSION);
-constexpr float VOXEL_CAMERA_DISTANCE = 40.0f;
+constexpr GLsizei VOXEL_DYNAMIC_DIMENSION = VOXEL_MAP_DIMENSION / 2;
 constexpr float VOXEL_ORTHO_SIZE = 20.0f;
-constexpr float VOXEL_ORTHO_HALF_SIZE = VOXEL_ORTHO_SIZE * 0.5f;
 constexpr float VOXEL_SIZE = VOXEL_ORTHO_SIZE / VOXEL_MAP_DIMENSION;
 
+// The number of voxels a level moves by at a time. Must divide the compute work group size.
+constexpr int VOXEL_LEVEL_STEP = 8;
+
+// The most "ViewUniforms" blocks used by the voxel map in a frame: up to three static regions and one
+// dynamic region per level, each rendered from up to three directions.
+constexpr int VOXEL_VIEW_SLOT_COUNT = 3 * 4 * 3;
+
+// Work group size for the voxel compute stages.
+const glm::ivec3 VOXEL_LOCAL_GROUP_SIZE(8, 4, 4);
+
+// Gets the world-space size of a voxel in the given level of the voxel map.
+static float getVoxelSize(int level)
+{
+    return VOXEL_SIZE * (float)(1 << level);
+}
+
+// The frames left unmeasured after switching voxelization modes: one still in the old mode, and one
+// rebuilding every level in the new mode.
+constexpr int VOXEL_MODE_WARM_UP_FRAMES = 2;
+
+// Gets the GPU memory used by a voxel map with the given number of levels, in megabytes.
+static double getVoxelMemorySize(bool isPacked, int levelCount)
+{
+    const double voxelCount = (double)VOXEL_MAP_DIMENSION * VOXEL_MAP_DIMENSION * VOXEL_MAP_DIMENSION;
+    const double dynamicVoxelCount = (double)VOXEL_DYNAMIC_DIMENSION * VOXEL_DYNAMIC_DIMENSION * VOXEL_DYNAMIC_DIMENSION;
+
+    // The radiance texture of each level is RGBA16F with a full mip chain.
+    double radianceSize = 0.0;
+
+    for (int i = 0; i < VOXEL_MAP_MIP_LEVELS; i++)
+        radianceSize += voxelCount / (double)(1 << (3 * i)) * 8.0;
+
+    // Packed voxels take one R32UI texel, and unpacked voxels an RGBA16F static texel or four R32I components.
+    double size = isPacked
+        ? levelCount * (radianceSize + voxelCount * 4.0) + dynamicVoxelCount * 4.0
+        : levelCount * (radianceSize + voxelCount * 8.0) + (voxelCount + dynamicVoxelCount) * 16.0;
+
+    return size / (1024.0 * 1024.0);
+}
+
 ProcessedCamera::ProcessedCamera(bool enabled, float layerDepth) :
     Camera(enabled, layerDepth),
     m_pSubject(nullptr),
+    m_voxelViewUniformBuffer(sizeof(ViewUniforms), VOXEL_VIEW_SLOT_COUNT),
+    m_voxelViewSlot(0),
     m_offsetRatio(glm::zero<glm::vec2>()),
     m_sizeRatio(glm::one<glm::vec2>()),
     m_areFrameBuffersDirty(true),
@@ -38,7 +83,7 @@ ProcessedCamera::ProcessedCamera(bool enabled, float layerDepth) :
     m_defaultBufferHeight(-1),
     m_bufferWidth(-1),
     m_bufferHeight(-1),
-    m_depthRenderBuffer(0),
+    m_primaryDepthBuffer(0),
     m_deferredFrameBuffer(0),
     m_deferredColorBuffer(0),
     m_noiseTexture(0),
@@ -50,12 +95,15 @@ ProcessedCamera::ProcessedCamera(bool enabled, float layerDepth) :
     m_primaryPositionBuffer(0),
     m_primaryNormalBuffer(0),
     m_primaryMaterialBuffer(0),
-    m_shadowMapFrameBuffer(0),
-    m_shadowMapDepthBuffer(0),
     m_voxelFrameBuffer(0),
     m_voxelColorBuffer(0),
-    m_voxelMapTexture(0),
+    m_voxelLevels(),
     m_voxelMapTextureComponents{0, 0, 0, 0},
+    m_dynamicVoxelMapTextureComponents{0, 0, 0, 0},
+    m_packedDynamicVoxelMapTexture(0),
+    m_isVoxelMapPacked(false),
+    m_areVoxelComponentsClear(false),
+    m_voxelStaticRevision(0),
     m_fxaaFrameBuffer(0),
     m_fxaaColorBuffer(0),
     m_hdrFrameBuffer(0),
@@ -65,12 +113,16 @@ ProcessedCamera::ProcessedCamera(bool enabled, float layerDepth) :
     m_currentExposure(1.0f),
     m_targetExposure(1.0f),
     m_snappedSubjectPosition(0.0f),
-    m_voxelPerspectiveMatrix(1.0f),
-    m_voxelViewMatrix(1.0f)
+    m_pOcclusionCuller(nullptr),
+    m_voxelTimerQueries{0, 0},
+    m_currentVoxelTimerQuery(0),
+    m_hasPreviousVoxelTimerQuery(false),
+    m_voxelTimedFrameCount(0),
+    m_voxelGpuTime(0.0)
 {
     AssetManager* pAssets = Game::getInstance().getScene()->getAssetManager();
 
-    m_pShadowShader = pAssets->getShaderProgram("shadowShader");
+    m_pShadowMapService = Game::getInstance().getScene()->getShadowMapService();
     m_pDeferredShader = pAssets->getShaderProgram("deferredShader");
     m_pGiShader = pAssets->getShaderProgram("giShader");
     m_pBlendedDeferredShader = pAssets->getShaderProgram("blendedDeferredShader");
@@ -81,8 +133,16 @@ ProcessedCamera::ProcessedCamera(bool enabled, float layerDepth) :
     m_pLuminanceComputeShader = pAssets->getComputeShaderProgram("luminanceCompute");
     m_pVoxelClearComputeShader = pAssets->getComputeShaderProgram("voxelClear");
     m_pVoxelCombineComputeShader = pAssets->getComputeShaderProgram("voxelCombine");
+    m_pVoxelStoreStaticComputeShader = pAssets->getComputeShaderProgram("voxelStoreStatic");
     m_pVoxelMipmapComputeShader = pAssets->getComputeShaderProgram("voxelMipmap");
+    m_pVoxelCoverageComputeShader = pAssets->getComputeShaderProgram("voxelCoverage");
+    m_pVoxelClearPackedComputeShader = pAssets->getComputeShaderProgram("voxelClearPacked");
+    m_pVoxelCombinePackedComputeShader = pAssets->getComputeShaderProgram("voxelCombinePacked");
+    m_isVoxelMapPacked = Game::getInstance().getConfig().packedVoxelStorage;
     m_pSkyTexture = pAssets->getTexture("skyTexture");
+    m_pOcclusionCuller = new OcclusionCuller();
+
+    glGenQueries(2, m_voxelTimerQueries);
 
     m_pDeferredShader->bind();
     glUniform1i(m_pDeferredShader->getUniform("gColor"), 0);
@@ -98,7 +158,13 @@ ProcessedCamera::ProcessedCamera(bool enabled, float layerDepth) :
     glUniform1i(m_pGiShader->getUniform("gNormal"), 1);
     glUniform1i(m_pGiShader->getUniform("gMaterial"), 2);
     glUniform1i(m_pGiShader->getUniform("noise"), 3);
-    glUniform1i(m_pGiShader->getUniform("voxelMap"), 4);
+
+    GLint voxelMapUnits[VOXEL_LEVEL_COUNT];
+
+    for (int i = 0; i < VOXEL_LEVEL_COUNT; i++)
+        voxelMapUnits[i] = 4 + i;
+
+    glUniform1iv(m_pGiShader->getUniform("voxelMaps"), VOXEL_LEVEL_COUNT, voxelMapUnits);
     m_pGiShader->unbind();
 
     m_pBlendedDeferredShader->bind();
@@ -150,7 +216,7 @@ ProcessedCamera::ProcessedCamera(bool enabled, float layerDepth) :
     };
 
     glGenVertexArrays(1, &m_quadVertexArrayObject);
-    glBindVertexArray(m_quadVertexArrayObject);
+    GLState::bindVertexArray(m_quadVertexArrayObject);
 
     glGenBuffers(1, &m_quadVertexBufferObject);
     glBindBuffer(GL_ARRAY_BUFFER, m_quadVertexBufferObject);
@@ -166,56 +232,18 @@ ProcessedCamera::ProcessedCamera(bool enabled, float layerDepth) :
     glEnableVertexAttribArray(1);
     glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
 
-    glBindVertexArray(0);
-
-    m_voxelPerspectiveMatrix = glm::ortho(
-        -VOXEL_ORTHO_HALF_SIZE,
-        VOXEL_ORTHO_HALF_SIZE,
-        -VOXEL_ORTHO_HALF_SIZE,
-        VOXEL_ORTHO_SIZE,
-        0.1f,
-        1000.0f);
-    m_voxelViewMatrix = glm::lookAt(glm::vec3(0.0f, 10.0f, 0.0f), glm::vec3(0.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+    GLState::bindVertexArray(0);
 
-    m_voxelMapRenderConfiguration =
+    m_staticVoxelRenderConfiguration =
     {
-        // canUseShader
-        [this](Program* pShaderProgram) -> bool
-        {
-            return doesProgramHaveDynamicOutput(pShaderProgram);
-        },
-
-        // configureShader
-        [this](Program* pShaderProgram)
-        {
-            pShaderProgram->setVerbose(false);
-
-            GLint pId = pShaderProgram->getUniform("P");
-            GLint vId = pShaderProgram->getUniform("V");
-
-            if (pId != -1)
-                glUniformMatrix4fv(pId, 1, GL_FALSE, &m_voxelPerspectiveMatrix[0][0]);
-
-            if (vId != -1)
-                glUniformMatrix4fv(vId, 1, GL_FALSE, &m_voxelViewMatrix[0][0]);
-
-            pShaderProgram->setVerbose(true);
-
-            glUniform1i(pShaderProgram->getUniform("_outputMode"), (GLint)ProgramOutputMode::DYNAMIC);
-            glUniform3fv(pShaderProgram->getUniform("_voxelCenterPosition"), 1, &m_snappedSubjectPosition[0]);
-            glUniform3fv(pShaderProgram->getUniform("_cameraPosition"), 1, &getTransform()->getPosition()[0]);
-            glUniformMatrix4fv(pShaderProgram->getUniform("_lightPV"), 1, GL_FALSE, &getSunPvMatrix()[0][0]);
-
-            glActiveTexture(GL_TEXTURE4);
-            glBindTexture(GL_TEXTURE_2D, m_shadowMapDepthBuffer);
-            glActiveTexture(GL_TEXTURE5);
-            glBindTexture(GL_TEXTURE_2D, m_pSkyTexture->getTextureId());
+        // pass
+        DrawPass::VOXEL_STATIC,
+    };
 
-            glBindImageTexture(1, m_voxelMapTextureComponents[0], 0, GL_TRUE, 0, GL_READ_WRITE, GL_R32I);
-            glBindImageTexture(2, m_voxelMapTextureComponents[1], 0, GL_TRUE, 0, GL_READ_WRITE, GL_R32I);
-            glBindImageTexture(3, m_voxelMapTextureComponents[2], 0, GL_TRUE, 0, GL_READ_WRITE, GL_R32I);
-            glBindImageTexture(4, m_voxelMapTextureComponents[3], 0, GL_TRUE, 0, GL_READ_WRITE, GL_R32I);
-        },
+    m_dynamicVoxelRenderConfiguration =
+    {
+        // pass
+        DrawPass::VOXEL_DYNAMIC,
     };
 }
 
@@ -227,6 +255,12 @@ ProcessedCamera::~ProcessedCamera()
     glDeleteBuffers(1, &m_quadVertexBufferObject);
     glDeleteBuffers(1, &m_quadTextureBufferObject);
     glDeleteVertexArrays(1, &m_quadVertexArrayObject);
+
+    delete m_pOcclusionCuller;
+
+    glDeleteQueries(2, m_voxelTimerQueries);
+
+    GLState::invalidate();
 }
 
 bool ProcessedCamera::initialize()
@@ -274,10 +308,7 @@ void ProcessedCamera::postUpdate(float deltaTime)
 {
     Camera::postUpdate(deltaTime);
 
-    m_snappedSubjectPosition = m_pSubject->getTransform()->getPosition();
-    //m_snappedSubjectPosition /= VOXEL_SIZE;
-    //m_snappedSubjectPosition = glm::round(m_snappedSubjectPosition);
-    //m_snappedSubjectPosition *= VOXEL_SIZE;
+    m_snappedSubjectPosition = (glm::vec3(getVoxelLevelOrigin(0)) + VOXEL_MAP_DIMENSION * 0.5f) * VOXEL_SIZE;
 }
 
 void ProcessedCamera::preRender()
@@ -300,9 +331,6 @@ void ProcessedCamera::preRender()
         createFrameBuffers();
     }
 
-    // Shadow map pass
-    renderShadowMap();
-
     // Voxel lightmap pass
     renderToVoxelMap();
 
@@ -314,56 +342,57 @@ void ProcessedCamera::preRender()
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 }
 
-void ProcessedCamera::renderShadowMap()
+void ProcessedCamera::getShadowMapping(CameraUniforms& cameraUniforms) const
 {
-    glBindFramebuffer(GL_FRAMEBUFFER, m_shadowMapFrameBuffer);
+    const ShadowView* pView = m_pShadowMapService->getView(this);
 
-    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-    glClear(GL_DEPTH_BUFFER_BIT);
+    if (!pView)
+    {
+        Camera::getShadowMapping(cameraUniforms);
+        return;
+    }
 
-    glViewport(0, 0, SHADOW_MAP_WIDTH, SHADOW_MAP_HEIGHT);
+    for (int i = 0; i < SHADOW_CASCADE_COUNT; i++)
+        cameraUniforms.lightPvMatrices[i] = pView->cascades[i].pvMatrix;
 
-    glDisable(GL_BLEND);
+    cameraUniforms.shadowLayer = pView->firstLayer;
+}
 
-    m_pShadowShader->bind();
-    glUniformMatrix4fv(m_pShadowShader->getUniform("P"), 1, GL_FALSE, &getSunPMatrix()[0][0]);
-    glUniformMatrix4fv(m_pShadowShader->getUniform("V"), 1, GL_FALSE, &getSunVMatrix()[0][0]);
+void ProcessedCamera::renderOcclusionPass()
+{
+    GLSL::pushDebugGroup("Occlusion");
 
-    for (auto shaderProgramNode : Game::getInstance().getScene()->getAssetManager()->getRenderTree())
+    AssetManager* pAssets = Game::getInstance().getScene()->getAssetManager();
+
+    // The pyramid is built from what the first phase drew, which is what was visible last frame.
+    m_pOcclusionCuller->buildPyramid(m_primaryDepthBuffer, getPerspectiveMatrix() * getViewMatrix());
+
+    // Renderables hidden by last frame's results are re-tested against the new pyramid, and the GPU drops those still hidden.
+    // The results are also read back to cull renderables in the next frame's first phase.
+    m_pOcclusionCuller->testBounds(pAssets->getCullingBounds());
+    renderRevealedRenderables(getPrimaryRenderConfiguration(), m_pOcclusionCuller);
+
+    // Instances are culled on the GPU, so those revealed since the first phase are drawn immediately.
+    for (InstanceCuller* pInstanceCuller : pAssets->getInstanceCullers())
     {
-        for (auto textureNode : *shaderProgramNode.second)
-        {
-            for (auto renderable : *textureNode.second)
-            {
-                if (renderable->usesDetailedShadows())
-                {
-                    auto pShader = shaderProgramNode.first;
-                    m_pShadowShader->unbind();
-
-                    pShader->bind();
-                    glUniformMatrix4fv(pShader->getUniform("P"), 1, GL_FALSE, &getSunPMatrix()[0][0]);
-                    glUniformMatrix4fv(pShader->getUniform("V"), 1, GL_FALSE, &getSunVMatrix()[0][0]);
-                    renderable->render();
-                    pShader->unbind();
-
-                    m_pShadowShader->bind();
-                }
-                else
-                {
-                    renderable->renderDepth(m_pShadowShader);
-                }
-            }
-        }
+        pInstanceCuller->cull(getCullingFrustum(), m_pOcclusionCuller, OcclusionPhase::SECOND);
+
+        const DrawItem* pItem = pAssets->getDrawList().find(pInstanceCuller->getMeshRenderer());
+
+        if (pItem && (pItem->passes & DrawPass::PRIMARY))
+            renderDrawItem(*pItem);
     }
 
-    m_pShadowShader->unbind();
+    GLState::disable(GL_CULL_FACE);
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    GLSL::popDebugGroup();
 }
 
 void ProcessedCamera::renderDeferred()
 {
-    glBindVertexArray(m_quadVertexArrayObject);
+    GLSL::pushDebugGroup("Deferred");
+
+    GLState::bindVertexArray(m_quadVertexArrayObject);
 
     glBindFramebuffer(GL_FRAMEBUFFER, m_deferredFrameBuffer);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_deferredColorBuffer, 0);
@@ -371,21 +400,18 @@ void ProcessedCamera::renderDeferred()
 
     m_pDeferredShader->bind();
 
-    glUniform3fv(m_pDeferredShader->getUniform("campos"), 1, &getTransform()->getPosition()[0]);
-    glUniformMatrix4fv(m_pDeferredShader->getUniform("lightPV"), 1, GL_FALSE, &getSunPvMatrix()[0][0]);
-
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, m_primaryColorBuffer);
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, m_primaryPositionBuffer);
-    glActiveTexture(GL_TEXTURE2);
-    glBindTexture(GL_TEXTURE_2D, m_primaryNormalBuffer);
-    glActiveTexture(GL_TEXTURE3);
-    glBindTexture(GL_TEXTURE_2D, m_primaryMaterialBuffer);
-    glActiveTexture(GL_TEXTURE4);
-    glBindTexture(GL_TEXTURE_2D, m_shadowMapDepthBuffer);
-    glActiveTexture(GL_TEXTURE5);
-    glBindTexture(GL_TEXTURE_2D, m_pSkyTexture->getTextureId());
+    GLState::activeTexture(GL_TEXTURE0);
+    GLState::bindTexture(GL_TEXTURE_2D, m_primaryColorBuffer);
+    GLState::activeTexture(GL_TEXTURE1);
+    GLState::bindTexture(GL_TEXTURE_2D, m_primaryPositionBuffer);
+    GLState::activeTexture(GL_TEXTURE2);
+    GLState::bindTexture(GL_TEXTURE_2D, m_primaryNormalBuffer);
+    GLState::activeTexture(GL_TEXTURE3);
+    GLState::bindTexture(GL_TEXTURE_2D, m_primaryMaterialBuffer);
+    GLState::activeTexture(GL_TEXTURE4);
+    GLState::bindTexture(GL_TEXTURE_2D_ARRAY, m_pShadowMapService->getDepthTexture());
+    GLState::activeTexture(GL_TEXTURE5);
+    GLState::bindTexture(GL_TEXTURE_2D, m_pSkyTexture->getTextureId());
 
     glDrawArrays(GL_TRIANGLES, 0, 6);
 
@@ -394,27 +420,78 @@ void ProcessedCamera::renderDeferred()
     glBindFramebuffer(GL_FRAMEBUFFER, m_primaryFrameBuffer);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_deferredColorBuffer, 0);
 
-    glBindVertexArray(0);
+    GLState::bindVertexArray(0);
 
-    glEnable(GL_BLEND);
+    GLState::enable(GL_BLEND);
     renderBlendedRenderables(getPrimaryRenderConfiguration());
-    glDisable(GL_BLEND);
+    GLState::disable(GL_BLEND);
+
+    GLSL::popDebugGroup();
 }
 
 void ProcessedCamera::renderToVoxelMap()
 {
-    // Work group size/dimensions for compute stages.
-    glm::ivec3 localGroupSize(8, 4, 4);
-    glm::ivec3 computeDimensions = glm::ivec3(VOXEL_MAP_DIMENSION) / localGroupSize;
-
-    // Clear the voxel map.
-    m_pVoxelClearComputeShader->bind();
-    glBindImageTexture(1, m_voxelMapTextureComponents[0], 0, GL_TRUE, 0, GL_READ_WRITE, GL_R32I);
-    glBindImageTexture(2, m_voxelMapTextureComponents[1], 0, GL_TRUE, 0, GL_READ_WRITE, GL_R32I);
-    glBindImageTexture(3, m_voxelMapTextureComponents[2], 0, GL_TRUE, 0, GL_READ_WRITE, GL_R32I);
-    glBindImageTexture(4, m_voxelMapTextureComponents[3], 0, GL_TRUE, 0, GL_READ_WRITE, GL_R32I);
-    glDispatchCompute((GLuint)computeDimensions.x, (GLuint)computeDimensions.y, (GLuint)computeDimensions.z);
-    m_pVoxelClearComputeShader->unbind();
+    GLSL::pushDebugGroup("Voxel map");
+
+    GameConfig& config = Game::getInstance().getConfig();
+    bool isTiming = config.voxelTimingReportInterval > 0;
+
+    // Storage can be switched at runtime, so that both layouts can be measured in one run.
+    if (config.packedVoxelStorage != m_isVoxelMapPacked)
+    {
+        deleteVoxelStorage();
+        m_isVoxelMapPacked = config.packedVoxelStorage;
+        createVoxelStorage();
+
+        // The new textures may reuse the deleted names, so tracked bindings can no longer be trusted.
+        GLState::invalidate();
+    }
+
+    if (isTiming)
+        glBeginQuery(GL_TIME_ELAPSED, m_voxelTimerQueries[m_currentVoxelTimerQuery]);
+
+    glm::ivec3 computeDimensions = glm::ivec3(VOXEL_MAP_DIMENSION) / VOXEL_LOCAL_GROUP_SIZE;
+    glm::ivec3 dynamicComputeDimensions = glm::ivec3(VOXEL_DYNAMIC_DIMENSION) / VOXEL_LOCAL_GROUP_SIZE;
+
+    // Every pass that reads the components leaves them empty, so they are only cleared once after creation.
+    if (!m_areVoxelComponentsClear)
+    {
+        m_areVoxelComponentsClear = true;
+
+        if (m_isVoxelMapPacked)
+        {
+            glm::ivec3 regionMin(0);
+
+            m_pVoxelClearPackedComputeShader->bind();
+            glUniform3iv(m_pVoxelClearPackedComputeShader->getUniform("regionMin"), 1, &regionMin[0]);
+            glUniform1i(m_pVoxelClearPackedComputeShader->getUniform("dimension"), VOXEL_DYNAMIC_DIMENSION);
+            glBindImageTexture(7, m_packedDynamicVoxelMapTexture, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_R32UI);
+            glDispatchCompute((GLuint)dynamicComputeDimensions.x, (GLuint)dynamicComputeDimensions.y, (GLuint)dynamicComputeDimensions.z);
+            glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+            m_pVoxelClearPackedComputeShader->unbind();
+        }
+        else
+        {
+            m_pVoxelClearComputeShader->bind();
+            bindVoxelComponents(m_voxelMapTextureComponents);
+            glDispatchCompute((GLuint)computeDimensions.x, (GLuint)computeDimensions.y, (GLuint)computeDimensions.z);
+            bindVoxelComponents(m_dynamicVoxelMapTextureComponents);
+            glDispatchCompute((GLuint)dynamicComputeDimensions.x, (GLuint)dynamicComputeDimensions.y, (GLuint)dynamicComputeDimensions.z);
+            glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+            m_pVoxelClearComputeShader->unbind();
+        }
+    }
+
+    // Static voxels are cached in each level, so they must all be rebuilt when a static object is added or removed.
+    unsigned staticRevision = Game::getInstance().getScene()->getAssetManager()->getStaticRevision();
+
+    if (staticRevision != m_voxelStaticRevision)
+    {
+        m_voxelStaticRevision = staticRevision;
+
+        for (VoxelLevel& voxelLevel : m_voxelLevels)
+            voxelLevel.isValid = false;
+    }
 
     glBindFramebuffer(GL_FRAMEBUFFER, m_voxelFrameBuffer);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_voxelColorBuffer, 0);
@@ -422,67 +499,359 @@ void ProcessedCamera::renderToVoxelMap()
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    glViewport(0, 0, VOXEL_CAMERA_RESOLUTION, VOXEL_CAMERA_RESOLUTION);
+    GLState::disable(GL_DEPTH_TEST);
+    GLState::depthMask(GL_FALSE);
 
-    glDisable(GL_DEPTH_TEST);
-    glDepthMask(GL_FALSE);
-
-    // Render from the X direction.
-    m_voxelViewMatrix = glm::lookAt(m_snappedSubjectPosition + glm::vec3(VOXEL_CAMERA_DISTANCE, 0.0f, 0.0f), m_snappedSubjectPosition, glm::vec3(0.0f, 1.0f, 0.0f));
-    renderUnblendedRenderables(m_voxelMapRenderConfiguration);
-    renderBlendedRenderables(m_voxelMapRenderConfiguration);
-
-    // Render from the Y direction.
-    m_voxelViewMatrix = glm::lookAt(m_snappedSubjectPosition + glm::vec3(0.0f, VOXEL_CAMERA_DISTANCE, 0.0f), m_snappedSubjectPosition, glm::vec3(1.0f, 0.0f, 0.0f));
-    renderUnblendedRenderables(m_voxelMapRenderConfiguration);
-    renderBlendedRenderables(m_voxelMapRenderConfiguration);
-
-    // Render from the Z direction.
-    m_voxelViewMatrix = glm::lookAt(m_snappedSubjectPosition + glm::vec3(0.0f, 0.0f, VOXEL_CAMERA_DISTANCE), m_snappedSubjectPosition, glm::vec3(0.0f, 1.0f, 0.0f));
-    renderUnblendedRenderables(m_voxelMapRenderConfiguration);
-    renderBlendedRenderables(m_voxelMapRenderConfiguration);
-
-    glEnable(GL_DEPTH_TEST);
-    glDepthMask(GL_TRUE);
-
-    // Combine each component.
-    m_pVoxelCombineComputeShader->bind();
-    glBindImageTexture(1, m_voxelMapTextureComponents[0], 0, GL_TRUE, 0, GL_READ_WRITE, GL_R32I);
-    glBindImageTexture(2, m_voxelMapTextureComponents[1], 0, GL_TRUE, 0, GL_READ_WRITE, GL_R32I);
-    glBindImageTexture(3, m_voxelMapTextureComponents[2], 0, GL_TRUE, 0, GL_READ_WRITE, GL_R32I);
-    glBindImageTexture(4, m_voxelMapTextureComponents[3], 0, GL_TRUE, 0, GL_READ_WRITE, GL_R32I);
-    glBindImageTexture(5, m_voxelMapTexture, 0, GL_TRUE, 0, GL_READ_WRITE, GL_RGBA16F);
-    glDispatchCompute((GLuint)computeDimensions.x, (GLuint)computeDimensions.y, (GLuint)computeDimensions.z);
-    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
-    m_pVoxelCombineComputeShader->unbind();
+    // Resources read by every dynamic output shader during this pass.
+    GLState::activeTexture(GL_TEXTURE4);
+    GLState::bindTexture(GL_TEXTURE_2D_ARRAY, m_pShadowMapService->getDepthTexture());
+    GLState::activeTexture(GL_TEXTURE5);
+    GLState::bindTexture(GL_TEXTURE_2D, m_pSkyTexture->getTextureId());
+
+    m_voxelViewSlot = 0;
+
+    // The levels whose radiance changed this frame, and so need new mipmaps.
+    bool isLevelCombined[VOXEL_LEVEL_COUNT] = {};
+
+    for (int level = 0; level < VOXEL_LEVEL_COUNT; level++)
+    {
+        if (!m_isVoxelMapPacked)
+            bindVoxelComponents(m_voxelMapTextureComponents);
+
+        bool hasStaticChanges = updateStaticVoxels(level, config.singlePassVoxelization);
+
+        // Dynamic objects move every frame, so they are voxelized over the whole level each time.
+        VoxelLevel& voxelLevel = m_voxelLevels[level];
+        glm::ivec3 dynamicOrigin = voxelLevel.origin / (VOXEL_MAP_DIMENSION / VOXEL_DYNAMIC_DIMENSION);
+
+        if (m_isVoxelMapPacked)
+            glBindImageTexture(7, m_packedDynamicVoxelMapTexture, 0, GL_TRUE, 0, GL_READ_WRITE, GL_R32UI);
+        else
+            bindVoxelComponents(m_dynamicVoxelMapTextureComponents);
+
+        bool hasDynamicVoxels = voxelizeRegion(level, VOXEL_DYNAMIC_DIMENSION, dynamicOrigin, dynamicOrigin + VOXEL_DYNAMIC_DIMENSION,
+            m_dynamicVoxelRenderConfiguration, config.singlePassVoxelization);
+
+        // A level with no new static voxels and no dynamic voxels, now or in its last update, is unchanged.
+        if (!hasStaticChanges && !hasDynamicVoxels && !voxelLevel.hasDynamicVoxels)
+            continue;
+
+        voxelLevel.hasDynamicVoxels = hasDynamicVoxels;
+        isLevelCombined[level] = true;
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+        // Combine the dynamic voxels with the level's static voxels.
+        if (m_isVoxelMapPacked)
+        {
+            m_pVoxelCombinePackedComputeShader->bind();
+            glBindImageTexture(5, voxelLevel.radianceTexture, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+            glBindImageTexture(6, voxelLevel.staticTexture, 0, GL_TRUE, 0, GL_READ_ONLY, GL_R32UI);
+            glBindImageTexture(7, m_packedDynamicVoxelMapTexture, 0, GL_TRUE, 0, GL_READ_WRITE, GL_R32UI);
+            glDispatchCompute((GLuint)computeDimensions.x, (GLuint)computeDimensions.y, (GLuint)computeDimensions.z);
+            glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+            m_pVoxelCombinePackedComputeShader->unbind();
+        }
+        else
+        {
+            m_pVoxelCombineComputeShader->bind();
+            glBindImageTexture(5, voxelLevel.radianceTexture, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+            glBindImageTexture(6, voxelLevel.staticTexture, 0, GL_TRUE, 0, GL_READ_ONLY, GL_RGBA16F);
+            glDispatchCompute((GLuint)computeDimensions.x, (GLuint)computeDimensions.y, (GLuint)computeDimensions.z);
+            glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+            m_pVoxelCombineComputeShader->unbind();
+        }
+    }
+
+    GLState::enable(GL_DEPTH_TEST);
+    GLState::depthMask(GL_TRUE);
 
     // Generate mipmaps.
     m_pVoxelMipmapComputeShader->bind();
 
-    for (int i = 1; i < VOXEL_MAP_MIP_LEVELS; i++)
+    for (int level = 0; level < VOXEL_LEVEL_COUNT; level++)
     {
-        glBindImageTexture(0, m_voxelMapTexture, i - 1, GL_TRUE, 0, GL_READ_ONLY, GL_RGBA16F);
-        glBindImageTexture(1, m_voxelMapTexture, i, GL_TRUE, 0, GL_READ_ONLY, GL_RGBA16F);
-        glDispatchCompute(
-            (GLuint)glm::max(computeDimensions.x >> i, 1),
-            (GLuint)glm::max(computeDimensions.y >> i, 1),
-            (GLuint)glm::max(computeDimensions.z >> i, 1));
-        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        if (!isLevelCombined[level])
+            continue;
+
+        const VoxelLevel& voxelLevel = m_voxelLevels[level];
+
+        for (int i = 1; i < VOXEL_MAP_MIP_LEVELS; i++)
+        {
+            glBindImageTexture(0, voxelLevel.radianceTexture, i - 1, GL_TRUE, 0, GL_READ_ONLY, GL_RGBA16F);
+            glBindImageTexture(1, voxelLevel.radianceTexture, i, GL_TRUE, 0, GL_READ_ONLY, GL_RGBA16F);
+            glDispatchCompute(
+                (GLuint)glm::max(computeDimensions.x >> i, 1),
+                (GLuint)glm::max(computeDimensions.y >> i, 1),
+                (GLuint)glm::max(computeDimensions.z >> i, 1));
+            glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        }
     }
 
     m_pVoxelMipmapComputeShader->unbind();
+
+    // The levels are sampled as textures by the global illumination pass.
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+    if (isTiming)
+    {
+        glEndQuery(GL_TIME_ELAPSED);
+
+        if (reportVoxelTiming(config.voxelTimingReportInterval, config.singlePassVoxelization, m_isVoxelMapPacked)
+            && config.compareVoxelModes)
+        {
+            switchVoxelMode(config);
+        }
+    }
+
+    GLSL::popDebugGroup();
+}
+
+bool ProcessedCamera::updateStaticVoxels(int level, bool isSinglePass)
+{
+    VoxelLevel& voxelLevel = m_voxelLevels[level];
+    glm::ivec3 origin = getVoxelLevelOrigin(level);
+    glm::ivec3 offset = origin - voxelLevel.origin;
+
+    // The regions the level has moved into, as disjoint boxes. Each axis the level moved along adds a slab,
+    // which is trimmed on the axes before it so that no voxel is written twice.
+    glm::ivec3 regionMins[3];
+    glm::ivec3 regionMaxes[3];
+    int regionCount = 0;
+
+    // A level that moved by its full extent shares nothing with its previous region.
+    bool isRebuilt = !voxelLevel.isValid;
+
+    for (int axis = 0; axis < 3; axis++)
+        isRebuilt = isRebuilt || std::abs(offset[axis]) >= VOXEL_MAP_DIMENSION;
+
+    if (isRebuilt)
+    {
+        regionMins[0] = origin;
+        regionMaxes[0] = origin + VOXEL_MAP_DIMENSION;
+        regionCount = 1;
+    }
+    else
+    {
+        glm::ivec3 remainingMin = origin;
+        glm::ivec3 remainingMax = origin + VOXEL_MAP_DIMENSION;
+
+        for (int axis = 0; axis < 3; axis++)
+        {
+            if (offset[axis] == 0)
+                continue;
+
+            regionMins[regionCount] = remainingMin;
+            regionMaxes[regionCount] = remainingMax;
+
+            if (offset[axis] > 0)
+            {
+                regionMins[regionCount][axis] = voxelLevel.origin[axis] + VOXEL_MAP_DIMENSION;
+                remainingMax[axis] = regionMins[regionCount][axis];
+            }
+            else
+            {
+                regionMaxes[regionCount][axis] = voxelLevel.origin[axis];
+                remainingMin[axis] = regionMaxes[regionCount][axis];
+            }
+
+            regionCount++;
+        }
+    }
+
+    voxelLevel.origin = origin;
+    voxelLevel.isValid = true;
+
+    for (int i = 0; i < regionCount; i++)
+    {
+        glm::ivec3 computeDimensions = (regionMaxes[i] - regionMins[i]) / VOXEL_LOCAL_GROUP_SIZE;
+
+        // Packed static voxels are accumulated directly into the level, so the region only needs emptying first.
+        if (m_isVoxelMapPacked)
+        {
+            m_pVoxelClearPackedComputeShader->bind();
+            glUniform3iv(m_pVoxelClearPackedComputeShader->getUniform("regionMin"), 1, &regionMins[i][0]);
+            glUniform1i(m_pVoxelClearPackedComputeShader->getUniform("dimension"), VOXEL_MAP_DIMENSION);
+            glBindImageTexture(7, voxelLevel.staticTexture, 0, GL_TRUE, 0, GL_READ_WRITE, GL_R32UI);
+            glDispatchCompute((GLuint)computeDimensions.x, (GLuint)computeDimensions.y, (GLuint)computeDimensions.z);
+            glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+            m_pVoxelClearPackedComputeShader->unbind();
+
+            voxelizeRegion(level, VOXEL_MAP_DIMENSION, regionMins[i], regionMaxes[i], m_staticVoxelRenderConfiguration, isSinglePass);
+            continue;
+        }
+
+        voxelizeRegion(level, VOXEL_MAP_DIMENSION, regionMins[i], regionMaxes[i], m_staticVoxelRenderConfiguration, isSinglePass);
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+        // Store the region's components as static voxels.
+        m_pVoxelStoreStaticComputeShader->bind();
+        glUniform3iv(m_pVoxelStoreStaticComputeShader->getUniform("regionMin"), 1, &regionMins[i][0]);
+        glBindImageTexture(6, voxelLevel.staticTexture, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+        glDispatchCompute((GLuint)computeDimensions.x, (GLuint)computeDimensions.y, (GLuint)computeDimensions.z);
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        m_pVoxelStoreStaticComputeShader->unbind();
+    }
+
+    return regionCount > 0;
+}
+
+bool ProcessedCamera::voxelizeRegion(int level, GLsizei dimension, const glm::ivec3& regionMin, const glm::ivec3& regionMax,
+    const RenderConfiguration& configuration, bool isSinglePass)
+{
+    float halfSize = VOXEL_MAP_DIMENSION * 0.5f * getVoxelSize(level);
+    float voxelSize = halfSize * 2.0f / dimension;
+    glm::vec3 center = (glm::vec3(m_voxelLevels[level].origin) + VOXEL_MAP_DIMENSION * 0.5f) * getVoxelSize(level);
+
+    // Only geometry inside the region contributes to it.
+    setCullingFrustum(ViewFrustum(glm::vec3(regionMin) * voxelSize, glm::vec3(regionMax) * voxelSize));
+
+    if (!hasVisibleRenderables(configuration))
+        return false;
+
+    ViewUniforms viewUniforms = {};
+    viewUniforms.voxelSize = voxelSize;
+    viewUniforms.voxelDimension = dimension;
+    viewUniforms.isVoxelMapPacked = m_isVoxelMapPacked ? 1 : 0;
+    viewUniforms.voxelRegionMin = glm::ivec4(regionMin, 0);
+    viewUniforms.voxelRegionMax = glm::ivec4(regionMax, 0);
+
+    if (isSinglePass)
+    {
+        // The level is mapped onto the clip cube with one pixel per voxel, and the geometry shader projects
+        // each triangle along its dominant axis.
+        glViewport(0, 0, dimension, dimension);
+
+        viewUniforms.projectionMatrix = glm::ortho(-halfSize, halfSize, -halfSize, halfSize, -halfSize, halfSize);
+        viewUniforms.viewMatrix = glm::translate(glm::mat4(1.0f), -center);
+        viewUniforms.outputMode = (GLint)ProgramOutputMode::VOXELIZE;
+        bindViewUniforms(m_voxelViewUniformBuffer, m_voxelViewSlot++, viewUniforms);
+
+        // Only this pass binds the variants with the voxelization geometry shader.
+        Program::selectVariant(ProgramVariant::VOXELIZE);
+        renderUnblendedRenderables(configuration);
+        renderBlendedRenderables(configuration);
+        Program::selectVariant(ProgramVariant::DEFAULT);
+        return true;
+    }
+
+    glViewport(0, 0, VOXEL_CAMERA_RESOLUTION, VOXEL_CAMERA_RESOLUTION);
+
+    // Render the level from the X, Y and Z directions, each view exactly enclosing it.
+    const glm::vec3 directions[3] = { glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f) };
+    const glm::vec3 ups[3] = { glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f) };
+
+    viewUniforms.projectionMatrix = glm::ortho(-halfSize, halfSize, -halfSize, halfSize, halfSize, 3.0f * halfSize);
+    viewUniforms.outputMode = (GLint)ProgramOutputMode::DYNAMIC;
+
+    for (int i = 0; i < 3; i++)
+    {
+        viewUniforms.viewMatrix = glm::lookAt(center + directions[i] * 2.0f * halfSize, center, ups[i]);
+        bindViewUniforms(m_voxelViewUniformBuffer, m_voxelViewSlot++, viewUniforms);
+        renderUnblendedRenderables(configuration);
+        renderBlendedRenderables(configuration);
+    }
+
+    return true;
+}
+
+void ProcessedCamera::bindVoxelComponents(const GLuint* pComponents)
+{
+    for (int i = 0; i < 4; i++)
+        glBindImageTexture(1 + i, pComponents[i], 0, GL_TRUE, 0, GL_READ_WRITE, GL_R32I);
+}
+
+bool ProcessedCamera::reportVoxelTiming(int reportInterval, bool isSinglePass, bool isPacked)
+{
+    // Read the previous frame's query, which has had a full frame to complete.
+    m_currentVoxelTimerQuery = 1 - m_currentVoxelTimerQuery;
+
+    GLint isAvailable = GL_FALSE;
+
+    if (m_hasPreviousVoxelTimerQuery)
+        glGetQueryObjectiv(m_voxelTimerQueries[m_currentVoxelTimerQuery], GL_QUERY_RESULT_AVAILABLE, &isAvailable);
+
+    m_hasPreviousVoxelTimerQuery = true;
+
+    if (!isAvailable)
+        return false;
+
+    // Skipped frames are still read, so that the next query measured is one from after them.
+    if (m_voxelTimedFrameCount < 0)
+    {
+        m_voxelTimedFrameCount++;
+        return false;
+    }
+
+    GLuint64 elapsedTime = 0;
+    glGetQueryObjectui64v(m_voxelTimerQueries[m_currentVoxelTimerQuery], GL_QUERY_RESULT, &elapsedTime);
+    m_voxelGpuTime += elapsedTime / 1000000.0;
+
+    if (++m_voxelTimedFrameCount < reportInterval)
+        return false;
+
+    std::cout << "Voxel map (" << (isSinglePass ? "single pass" : "three passes") << ", "
+        << (isPacked ? "packed" : "unpacked") << " storage): gpu " << m_voxelGpuTime / m_voxelTimedFrameCount
+        << "ms per frame, " << getVoxelMemorySize(isPacked, VOXEL_LEVEL_COUNT) << "MB (" << (isPacked ? "unpacked" : "packed")
+        << " storage: " << getVoxelMemorySize(!isPacked, VOXEL_LEVEL_COUNT) << "MB), covered voxels per level:";
+
+    // Counting waits on the GPU, but only once per report.
+    GLuint resultBuffer = m_pVoxelCoverageComputeShader->getBuffer("result");
+    glm::ivec3 computeDimensions = glm::ivec3(VOXEL_MAP_DIMENSION) / VOXEL_LOCAL_GROUP_SIZE;
+
+    m_pVoxelCoverageComputeShader->bind();
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, resultBuffer);
+
+    for (const VoxelLevel& voxelLevel : m_voxelLevels)
+    {
+        GLuint coveredCount = 0;
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GLuint), &coveredCount);
+        glBindImageTexture(0, voxelLevel.radianceTexture, 0, GL_TRUE, 0, GL_READ_ONLY, GL_RGBA16F);
+        glDispatchCompute((GLuint)computeDimensions.x, (GLuint)computeDimensions.y, (GLuint)computeDimensions.z);
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GLuint), &coveredCount);
+
+        std::cout << ' ' << coveredCount;
+    }
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+    m_pVoxelCoverageComputeShader->unbind();
+
+    std::cout << std::endl;
+
+    m_voxelTimedFrameCount = 0;
+    m_voxelGpuTime = 0.0;
+    return true;
+}
+
+void ProcessedCamera::switchVoxelMode(GameConfig& config)
+{
+    config.singlePassVoxelization = !config.singlePassVoxelization;
+
+    // Storage is switched once both voxelization modes have been measured with it. The new textures are
+    // created at the start of the next voxel map pass.
+    if (config.singlePassVoxelization)
+        config.packedVoxelStorage = !config.packedVoxelStorage;
+
+    // Each level is rebuilt so that its static voxels, and so the coverage reported, come from the new mode.
+    for (VoxelLevel& voxelLevel : m_voxelLevels)
+        voxelLevel.isValid = false;
+
+    m_voxelTimedFrameCount = -VOXEL_MODE_WARM_UP_FRAMES;
 }
 
 void ProcessedCamera::postRender()
 {
-    glEnable(GL_DEPTH_TEST);
-    glDisable(GL_BLEND);
+    GLState::enable(GL_DEPTH_TEST);
+    GLState::disable(GL_BLEND);
 
+    renderOcclusionPass();
     renderDeferred();
 
-    glBindVertexArray(m_quadVertexArrayObject);
+    GLState::bindVertexArray(m_quadVertexArrayObject);
 
     // Ambient occlusion and global illumination.
+    GLSL::pushDebugGroup("Global illumination");
+
     glBindFramebuffer(GL_FRAMEBUFFER, m_giFrameBuffer);
 
     m_pGiShader->bind();
@@ -490,16 +859,27 @@ void ProcessedCamera::postRender()
     glUniformMatrix4fv(m_pGiShader->getUniform("view"), 1, GL_FALSE, &getViewMatrix()[0][0]);
     glUniform3fv(m_pGiShader->getUniform("voxelCenterPosition"), 1, &m_snappedSubjectPosition[0]);
 
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, m_primaryPositionBuffer);
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, m_primaryNormalBuffer);
-    glActiveTexture(GL_TEXTURE2);
-    glBindTexture(GL_TEXTURE_2D, m_primaryMaterialBuffer);
-    glActiveTexture(GL_TEXTURE3);
-    glBindTexture(GL_TEXTURE_2D, m_noiseTexture);
-    glActiveTexture(GL_TEXTURE4);
-    glBindTexture(GL_TEXTURE_3D, m_voxelMapTexture);
+    glm::vec3 voxelLevelMins[VOXEL_LEVEL_COUNT];
+
+    for (int i = 0; i < VOXEL_LEVEL_COUNT; i++)
+        voxelLevelMins[i] = glm::vec3(m_voxelLevels[i].origin) * getVoxelSize(i);
+
+    glUniform3fv(m_pGiShader->getUniform("voxelLevelMin"), VOXEL_LEVEL_COUNT, &voxelLevelMins[0][0]);
+
+    GLState::activeTexture(GL_TEXTURE0);
+    GLState::bindTexture(GL_TEXTURE_2D, m_primaryPositionBuffer);
+    GLState::activeTexture(GL_TEXTURE1);
+    GLState::bindTexture(GL_TEXTURE_2D, m_primaryNormalBuffer);
+    GLState::activeTexture(GL_TEXTURE2);
+    GLState::bindTexture(GL_TEXTURE_2D, m_primaryMaterialBuffer);
+    GLState::activeTexture(GL_TEXTURE3);
+    GLState::bindTexture(GL_TEXTURE_2D, m_noiseTexture);
+
+    for (int i = 0; i < VOXEL_LEVEL_COUNT; i++)
+    {
+        GLState::activeTexture(GL_TEXTURE4 + i);
+        GLState::bindTexture(GL_TEXTURE_3D, m_voxelLevels[i].radianceTexture);
+    }
 
     glDrawArrays(GL_TRIANGLES, 0, 6);
 
@@ -514,23 +894,27 @@ void ProcessedCamera::postRender()
     // TODO: For testing. Remove.
     glUniform1f(m_pBlendedDeferredShader->getUniform("occlusionFactor"), Game::getInstance().getCursorY() / Game::getInstance().getWindowHeight());
 
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, m_deferredColorBuffer);
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, m_primaryPositionBuffer);
-    glActiveTexture(GL_TEXTURE2);
-    glBindTexture(GL_TEXTURE_2D, m_primaryNormalBuffer);
-    glActiveTexture(GL_TEXTURE3);
-    glBindTexture(GL_TEXTURE_2D, m_primaryMaterialBuffer);
-    glActiveTexture(GL_TEXTURE4);
-    glBindTexture(GL_TEXTURE_2D, m_giAoColorBuffer);
-    glActiveTexture(GL_TEXTURE5);
-    glBindTexture(GL_TEXTURE_2D, m_giIndirectColorBuffer);
+    GLState::activeTexture(GL_TEXTURE0);
+    GLState::bindTexture(GL_TEXTURE_2D, m_deferredColorBuffer);
+    GLState::activeTexture(GL_TEXTURE1);
+    GLState::bindTexture(GL_TEXTURE_2D, m_primaryPositionBuffer);
+    GLState::activeTexture(GL_TEXTURE2);
+    GLState::bindTexture(GL_TEXTURE_2D, m_primaryNormalBuffer);
+    GLState::activeTexture(GL_TEXTURE3);
+    GLState::bindTexture(GL_TEXTURE_2D, m_primaryMaterialBuffer);
+    GLState::activeTexture(GL_TEXTURE4);
+    GLState::bindTexture(GL_TEXTURE_2D, m_giAoColorBuffer);
+    GLState::activeTexture(GL_TEXTURE5);
+    GLState::bindTexture(GL_TEXTURE_2D, m_giIndirectColorBuffer);
 
     glDrawArrays(GL_TRIANGLES, 0, 6);
 
     m_pBlendedDeferredShader->unbind();
 
+    GLSL::popDebugGroup();
+
+    GLSL::pushDebugGroup("Exposure");
+
     m_pLuminanceComputeShader->bind();
     GLuint resultBuffer = m_pLuminanceComputeShader->getBuffer("result");
     GLuint colorImage = m_pLuminanceComputeShader->getUniform("colorImage");
@@ -544,7 +928,6 @@ void ProcessedCamera::postRender()
     glm::vec4 result;
     glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(glm::vec4), &result);
     glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
-    glUseProgram(0);
 
     m_pLuminanceComputeShader->unbind();
 
@@ -554,14 +937,18 @@ void ProcessedCamera::postRender()
     m_targetExposure = 1.0f / luminance;
     m_targetExposure *= GC::exposureMultiplier;
 
+    GLSL::popDebugGroup();
+
+    GLSL::pushDebugGroup("Bloom");
+
     glBindFramebuffer(GL_FRAMEBUFFER, m_hdrFrameBuffer);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     m_pPostShader->bind();
     glUniform1f(m_pPostShader->getUniform("exposure"), m_currentExposure);
 
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, m_primaryColorBuffer);
+    GLState::activeTexture(GL_TEXTURE0);
+    GLState::bindTexture(GL_TEXTURE_2D, m_primaryColorBuffer);
     glDrawArrays(GL_TRIANGLES, 0, 6);
 
     m_pPostShader->unbind();
@@ -577,8 +964,8 @@ void ProcessedCamera::postRender()
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         glUniform1i(m_pBlurShader->getUniform("horizontal"), horizontal);
 
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, firstIteration ? m_hdrColorBuffer : m_pingPongColorBuffers[!horizontal]);
+        GLState::activeTexture(GL_TEXTURE0);
+        GLState::bindTexture(GL_TEXTURE_2D, firstIteration ? m_hdrColorBuffer : m_pingPongColorBuffers[!horizontal]);
         glDrawArrays(GL_TRIANGLES, 0, 6);
 
         horizontal = !horizontal;
@@ -595,14 +982,18 @@ void ProcessedCamera::postRender()
     m_pBloomShader->bind();
     glUniform1f(m_pBloomShader->getUniform("exposure"), m_currentExposure);
 
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, m_primaryColorBuffer);
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, m_pingPongColorBuffers[!horizontal]);
+    GLState::activeTexture(GL_TEXTURE0);
+    GLState::bindTexture(GL_TEXTURE_2D, m_primaryColorBuffer);
+    GLState::activeTexture(GL_TEXTURE1);
+    GLState::bindTexture(GL_TEXTURE_2D, m_pingPongColorBuffers[!horizontal]);
 
     glDrawArrays(GL_TRIANGLES, 0, 6);
     m_pBloomShader->unbind();
 
+    GLSL::popDebugGroup();
+
+    GLSL::pushDebugGroup("FXAA");
+
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
     int x = (int)(m_defaultBufferWidth * m_offsetRatio.x);
@@ -615,14 +1006,16 @@ void ProcessedCamera::postRender()
     glUniform1f(m_pFxaaShader->getUniform("screenWidth"), (float)m_bufferWidth);
     glUniform1f(m_pFxaaShader->getUniform("screenHeight"), (float)m_bufferHeight);
 
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, m_fxaaColorBuffer);
+    GLState::activeTexture(GL_TEXTURE0);
+    GLState::bindTexture(GL_TEXTURE_2D, m_fxaaColorBuffer);
 
     glDrawArrays(GL_TRIANGLES, 0, 6);
 
     m_pFxaaShader->unbind();
 
-    glBindVertexArray(0);
+    GLState::bindVertexArray(0);
+
+    GLSL::popDebugGroup();
 }
 
 void ProcessedCamera::createFrameBuffers()
@@ -647,7 +1040,7 @@ void ProcessedCamera::createFrameBuffers()
 
     // Primary color texture
     glGenTextures(1, &m_primaryColorBuffer);
-    glBindTexture(GL_TEXTURE_2D, m_primaryColorBuffer);
+    GLState::bindTexture(GL_TEXTURE_2D, m_primaryColorBuffer);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, m_bufferWidth, m_bufferHeight, 0, GL_RGBA, GL_FLOAT, NULL);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -657,7 +1050,7 @@ void ProcessedCamera::createFrameBuffers()
     
     // Primary position texture
     glGenTextures(1, &m_primaryPositionBuffer);
-    glBindTexture(GL_TEXTURE_2D, m_primaryPositionBuffer);
+    GLState::bindTexture(GL_TEXTURE_2D, m_primaryPositionBuffer);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, m_bufferWidth, m_bufferHeight, 0, GL_RGB, GL_FLOAT, NULL);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -667,7 +1060,7 @@ void ProcessedCamera::createFrameBuffers()
 
     // Primary normal texture
     glGenTextures(1, &m_primaryNormalBuffer);
-    glBindTexture(GL_TEXTURE_2D, m_primaryNormalBuffer);
+    GLState::bindTexture(GL_TEXTURE_2D, m_primaryNormalBuffer);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, m_bufferWidth, m_bufferHeight, 0, GL_RGB, GL_FLOAT, NULL);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -677,7 +1070,7 @@ void ProcessedCamera::createFrameBuffers()
 
     // Primary material texture
     glGenTextures(1, &m_primaryMaterialBuffer);
-    glBindTexture(GL_TEXTURE_2D, m_primaryMaterialBuffer);
+    GLState::bindTexture(GL_TEXTURE_2D, m_primaryMaterialBuffer);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_R8I, m_bufferWidth, m_bufferHeight, 0, GL_RED_INTEGER, GL_INT, NULL);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
@@ -685,11 +1078,17 @@ void ProcessedCamera::createFrameBuffers()
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT3, GL_TEXTURE_2D, m_primaryMaterialBuffer, 0);
 
-    glGenRenderbuffers(1, &m_depthRenderBuffer);
-    glBindRenderbuffer(GL_RENDERBUFFER, m_depthRenderBuffer);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, m_bufferWidth, m_bufferHeight);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depthRenderBuffer);
-    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    // Primary depth texture, sampled to build the occlusion culling depth pyramid
+    glGenTextures(1, &m_primaryDepthBuffer);
+    GLState::bindTexture(GL_TEXTURE_2D, m_primaryDepthBuffer);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, m_bufferWidth, m_bufferHeight, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_primaryDepthBuffer, 0);
+
+    m_pOcclusionCuller->resize(m_bufferWidth, m_bufferHeight);
 
     glDrawBuffers(4, attachments);
 
@@ -700,37 +1099,13 @@ void ProcessedCamera::createFrameBuffers()
 
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-    // Shadow map frame buffer
-    glGenFramebuffers(1, &m_shadowMapFrameBuffer);
-    glBindFramebuffer(GL_FRAMEBUFFER, m_shadowMapFrameBuffer);
-
-    glGenTextures(1, &m_shadowMapDepthBuffer);
-
-    glBindTexture(GL_TEXTURE_2D, m_shadowMapDepthBuffer);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32, SHADOW_MAP_WIDTH, SHADOW_MAP_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-    glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, glm::value_ptr(glm::vec3(1.0)));
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_shadowMapDepthBuffer, 0);
-
-    glDrawBuffers(1, attachments);
-
-    frameBufferStatus = glCheckFramebufferStatus(GL_FRAMEBUFFER);
-
-    if (frameBufferStatus != GL_FRAMEBUFFER_COMPLETE)
-        std::cerr << "Unable to create shadow map frame buffer: " << frameBufferStatus << std::endl;
-
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
     // Deferred frame buffer
     glGenFramebuffers(1, &m_deferredFrameBuffer);
     glBindFramebuffer(GL_FRAMEBUFFER, m_deferredFrameBuffer);
 
     glGenTextures(1, &m_deferredColorBuffer);
 
-    glBindTexture(GL_TEXTURE_2D, m_deferredColorBuffer);
+    GLState::bindTexture(GL_TEXTURE_2D, m_deferredColorBuffer);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, m_bufferWidth, m_bufferHeight, 0, GL_RGBA, GL_FLOAT, NULL);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -750,7 +1125,7 @@ void ProcessedCamera::createFrameBuffers()
     generateNoise(noise, NOISE_SIZE);
 
     glGenTextures(1, &m_noiseTexture);
-    glBindTexture(GL_TEXTURE_2D, m_noiseTexture);
+    GLState::bindTexture(GL_TEXTURE_2D, m_noiseTexture);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, NOISE_DIMENSION, NOISE_DIMENSION, 0, GL_RGB, GL_FLOAT, noise);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
@@ -765,7 +1140,7 @@ void ProcessedCamera::createFrameBuffers()
 
     glGenTextures(1, &m_giAoColorBuffer);
 
-    glBindTexture(GL_TEXTURE_2D, m_giAoColorBuffer);
+    GLState::bindTexture(GL_TEXTURE_2D, m_giAoColorBuffer);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, m_bufferWidth, m_bufferHeight, 0, GL_RED, GL_FLOAT, NULL);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
@@ -773,7 +1148,7 @@ void ProcessedCamera::createFrameBuffers()
 
     glGenTextures(1, &m_giIndirectColorBuffer);
 
-    glBindTexture(GL_TEXTURE_2D, m_giIndirectColorBuffer);
+    GLState::bindTexture(GL_TEXTURE_2D, m_giIndirectColorBuffer);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, m_bufferWidth, m_bufferHeight, 0, GL_RGBA, GL_FLOAT, NULL);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
@@ -794,7 +1169,7 @@ void ProcessedCamera::createFrameBuffers()
 
     glGenTextures(1, &m_fxaaColorBuffer);
 
-    glBindTexture(GL_TEXTURE_2D, m_fxaaColorBuffer);
+    GLState::bindTexture(GL_TEXTURE_2D, m_fxaaColorBuffer);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, m_bufferWidth, m_bufferHeight, 0, GL_RGBA, GL_FLOAT, NULL);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -817,7 +1192,7 @@ void ProcessedCamera::createFrameBuffers()
 
     glGenTextures(1, &m_hdrColorBuffer);
 
-    glBindTexture(GL_TEXTURE_2D, m_hdrColorBuffer);
+    GLState::bindTexture(GL_TEXTURE_2D, m_hdrColorBuffer);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, m_bufferWidth, m_bufferHeight, 0, GL_RGB, GL_FLOAT, NULL);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -841,7 +1216,7 @@ void ProcessedCamera::createFrameBuffers()
     for (int i = 0; i < 2; i++)
     {
         glBindFramebuffer(GL_FRAMEBUFFER, m_pingPongFrameBuffers[i]);
-        glBindTexture(GL_TEXTURE_2D, m_pingPongColorBuffers[i]);
+        GLState::bindTexture(GL_TEXTURE_2D, m_pingPongColorBuffers[i]);
         glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, m_bufferWidth, m_bufferHeight, 0, GL_RGB, GL_FLOAT, NULL);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -863,39 +1238,32 @@ void ProcessedCamera::createFrameBuffers()
     glGenFramebuffers(1, &m_voxelFrameBuffer);
     glBindFramebuffer(GL_FRAMEBUFFER, m_voxelFrameBuffer);
 
-    // Voxel map texture.
-    glGenTextures(1, &m_voxelMapTexture);
-
-    glBindTexture(GL_TEXTURE_3D, m_voxelMapTexture);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAX_LEVEL, VOXEL_MAP_MIP_LEVELS - 1);
-
-    for (int i = 0; i < VOXEL_MAP_MIP_LEVELS; i++)
+    // Voxel map levels. They are addressed toroidally, so sampling wraps around on every axis.
+    for (VoxelLevel& voxelLevel : m_voxelLevels)
     {
-        int dim = VOXEL_MAP_DIMENSION >> i;
-        glTexImage3D(GL_TEXTURE_3D, i, GL_RGBA16F, dim, dim, dim, 0, GL_RGBA, GL_FLOAT, NULL);
-    }
+        glGenTextures(1, &voxelLevel.radianceTexture);
 
-    // Voxel map texture components.
-    for (int i = 0; i < 4; i++)
-    {
-        glGenTextures(1, &m_voxelMapTextureComponents[i]);
-
-        glBindTexture(GL_TEXTURE_3D, m_voxelMapTextureComponents[i]);
-        glTexImage3D(GL_TEXTURE_3D, 0, GL_R32I, VOXEL_MAP_DIMENSION, VOXEL_MAP_DIMENSION, VOXEL_MAP_DIMENSION, 0, GL_RED_INTEGER, GL_INT, NULL);
-        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        GLState::bindTexture(GL_TEXTURE_3D, voxelLevel.radianceTexture);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
         glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAX_LEVEL, VOXEL_MAP_MIP_LEVELS - 1);
+
+        for (int i = 0; i < VOXEL_MAP_MIP_LEVELS; i++)
+        {
+            int dim = VOXEL_MAP_DIMENSION >> i;
+            glTexImage3D(GL_TEXTURE_3D, i, GL_RGBA16F, dim, dim, dim, 0, GL_RGBA, GL_FLOAT, NULL);
+        }
     }
 
+    createVoxelStorage();
+
     // Dummy color buffer.
     glGenTextures(1, &m_voxelColorBuffer);
 
-    glBindTexture(GL_TEXTURE_2D, m_voxelColorBuffer);
+    GLState::bindTexture(GL_TEXTURE_2D, m_voxelColorBuffer);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, VOXEL_CAMERA_RESOLUTION, VOXEL_CAMERA_RESOLUTION, 0, GL_RGBA, GL_FLOAT, NULL);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -913,18 +1281,88 @@ void ProcessedCamera::createFrameBuffers()
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
+void ProcessedCamera::createVoxelStorage()
+{
+    // Static voxel textures, which every level must rebuild from scratch.
+    for (VoxelLevel& voxelLevel : m_voxelLevels)
+    {
+        glGenTextures(1, &voxelLevel.staticTexture);
+
+        GLState::bindTexture(GL_TEXTURE_3D, voxelLevel.staticTexture);
+
+        if (m_isVoxelMapPacked)
+            glTexImage3D(GL_TEXTURE_3D, 0, GL_R32UI, VOXEL_MAP_DIMENSION, VOXEL_MAP_DIMENSION, VOXEL_MAP_DIMENSION, 0, GL_RED_INTEGER, GL_UNSIGNED_INT, NULL);
+        else
+            glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA16F, VOXEL_MAP_DIMENSION, VOXEL_MAP_DIMENSION, VOXEL_MAP_DIMENSION, 0, GL_RGBA, GL_FLOAT, NULL);
+
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+        voxelLevel.isValid = false;
+        voxelLevel.hasDynamicVoxels = false;
+    }
+
+    // Packed dynamic voxel map texture.
+    if (m_isVoxelMapPacked)
+    {
+        glGenTextures(1, &m_packedDynamicVoxelMapTexture);
+
+        GLState::bindTexture(GL_TEXTURE_3D, m_packedDynamicVoxelMapTexture);
+        glTexImage3D(GL_TEXTURE_3D, 0, GL_R32UI, VOXEL_DYNAMIC_DIMENSION, VOXEL_DYNAMIC_DIMENSION, VOXEL_DYNAMIC_DIMENSION, 0, GL_RED_INTEGER, GL_UNSIGNED_INT, NULL);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    }
+
+    // Voxel map texture components, which packed storage does without.
+    for (int i = 0; i < 4 && !m_isVoxelMapPacked; i++)
+    {
+        glGenTextures(1, &m_voxelMapTextureComponents[i]);
+
+        GLState::bindTexture(GL_TEXTURE_3D, m_voxelMapTextureComponents[i]);
+        glTexImage3D(GL_TEXTURE_3D, 0, GL_R32I, VOXEL_MAP_DIMENSION, VOXEL_MAP_DIMENSION, VOXEL_MAP_DIMENSION, 0, GL_RED_INTEGER, GL_INT, NULL);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        glGenTextures(1, &m_dynamicVoxelMapTextureComponents[i]);
+
+        GLState::bindTexture(GL_TEXTURE_3D, m_dynamicVoxelMapTextureComponents[i]);
+        glTexImage3D(GL_TEXTURE_3D, 0, GL_R32I, VOXEL_DYNAMIC_DIMENSION, VOXEL_DYNAMIC_DIMENSION, VOXEL_DYNAMIC_DIMENSION, 0, GL_RED_INTEGER, GL_INT, NULL);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    }
+
+    m_areVoxelComponentsClear = false;
+}
+
+void ProcessedCamera::deleteVoxelStorage()
+{
+    for (VoxelLevel& voxelLevel : m_voxelLevels)
+    {
+        glDeleteTextures(1, &voxelLevel.staticTexture);
+        voxelLevel.staticTexture = 0;
+    }
+
+    // Only one storage layout's textures exist at a time, so the others are left as zero.
+    glDeleteTextures(4, m_voxelMapTextureComponents);
+    glDeleteTextures(4, m_dynamicVoxelMapTextureComponents);
+    glDeleteTextures(1, &m_packedDynamicVoxelMapTexture);
+    std::fill(std::begin(m_voxelMapTextureComponents), std::end(m_voxelMapTextureComponents), 0);
+    std::fill(std::begin(m_dynamicVoxelMapTextureComponents), std::end(m_dynamicVoxelMapTextureComponents), 0);
+    m_packedDynamicVoxelMapTexture = 0;
+}
+
 void ProcessedCamera::deleteBuffers()
 {
     glDeleteFramebuffers(1, &m_primaryFrameBuffer);
-    glDeleteFramebuffers(1, &m_shadowMapFrameBuffer);
     glDeleteFramebuffers(1, &m_deferredFrameBuffer);
     glDeleteFramebuffers(1, &m_giFrameBuffer);
     glDeleteFramebuffers(1, &m_fxaaFrameBuffer);
     glDeleteFramebuffers(1, &m_hdrFrameBuffer);
     glDeleteFramebuffers(2, m_pingPongFrameBuffers);
     glDeleteFramebuffers(1, &m_voxelFrameBuffer);
-    glDeleteRenderbuffers(1, &m_depthRenderBuffer);
-    glDeleteTextures(1, &m_shadowMapDepthBuffer);
+    glDeleteTextures(1, &m_primaryDepthBuffer);
     glDeleteTextures(1, &m_deferredColorBuffer);
     glDeleteTextures(1, &m_primaryColorBuffer);
     glDeleteTextures(1, &m_primaryPositionBuffer);
@@ -936,18 +1374,25 @@ void ProcessedCamera::deleteBuffers()
     glDeleteTextures(1, &m_fxaaColorBuffer);
     glDeleteTextures(1, &m_hdrColorBuffer);
     glDeleteTextures(2, m_pingPongColorBuffers);
-    glDeleteTextures(1, &m_voxelMapTexture);
-    glDeleteTextures(4, m_voxelMapTextureComponents);
+
+    for (VoxelLevel& voxelLevel : m_voxelLevels)
+        glDeleteTextures(1, &voxelLevel.radianceTexture);
+
+    deleteVoxelStorage();
     glDeleteTextures(1, &m_voxelColorBuffer);
+
+    // The new buffers may reuse the deleted names, so tracked bindings can no longer be trusted.
+    GLState::invalidate();
 }
 
-glm::vec3 ProcessedCamera::getVoxelSnappedSubjectPosition() const
+glm::ivec3 ProcessedCamera::getVoxelLevelOrigin(int level) const
 {
-    glm::vec3 subjectPosition = m_pSubject->getTransform()->getPosition();
-    subjectPosition /= VOXEL_SIZE;
-    subjectPosition = glm::round(subjectPosition);
-    subjectPosition *= VOXEL_SIZE;
-    return subjectPosition;
+    // Levels move in whole steps, so that entered regions are voxelized in batches and the finer mips of
+    // each level stay aligned with its edges.
+    float stepSize = getVoxelSize(level) * VOXEL_LEVEL_STEP;
+    glm::ivec3 centerStep = glm::ivec3(glm::floor(m_pSubject->getTransform()->getPosition() / stepSize + 0.5f));
+
+    return (centerStep - VOXEL_MAP_DIMENSION / (2 * VOXEL_LEVEL_STEP)) * VOXEL_LEVEL_STEP;
 }
 
 void ProcessedCamera::generateNoise(glm::vec3* noise, unsigned int size)
@@ -7,10 +7,8 @@ void RampRenderer::update(float deltaTime)
     m_totalTime += deltaTime;
 }
 
-void RampRenderer::render()
+void RampRenderer::fillDrawData(DrawData& drawData) const
 {
-    glUniform1f(getShaderProgram()->getUniform("time"), m_totalTime);
-
-    MeshRenderer::render();
+    drawData.time = m_totalTime;
 }
 
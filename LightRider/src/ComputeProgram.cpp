@@ -7,6 +7,7 @@
 
 #include "Program.h"
 #include "GLSL.h"
+#include "GLState.h"
 
 ComputeProgram* ComputeProgram::create(const std::string& fileName)
 {
@@ -55,13 +56,13 @@ ComputeProgram::~ComputeProgram()
 void ComputeProgram::bind()
 {
     m_isBound = true;
-    CHECKED_GL_CALL(glUseProgram(m_program));
+    CHECKED_GL_CALL(GLState::useProgram(m_program));
 }
 
 void ComputeProgram::unbind()
 {
     m_isBound = false;
-    CHECKED_GL_CALL(glUseProgram(0));
+    GLState::releaseProgram();
 }
 
 void ComputeProgram::addBuffer(const std::string& bufferName, GLsizeiptr size)
@@ -8,6 +8,7 @@
 #include "Shape.h"
 #include "StaticCollisionObjectInfo.h"
 #include "Components/MeshRenderer.h"
+#include "Components/InstanceCuller.h"
 #include "Components/RigidBodyComponent.h"
 
 ContainerGroupBuilder::ContainerGroupBuilder(float scale, float spacing) :
@@ -47,12 +48,12 @@ void ContainerGroupBuilder::addGroup(const glm::vec2& position, const glm::ivec3
     m_pCompoundShape->addChildShape(localTransform, pBoxShape);
 }
 
-GameObject* ContainerGroupBuilder::build(const std::string& shaderProgramId, const std::string& primaryTextureId, const std::string& shapeId)
+GameObject* ContainerGroupBuilder::build(const std::string& shaderProgramId, const std::string& primaryTextureId, const std::string& shapeId,
+    const std::string& depthProgramId)
 {
     GameObject* pContainerGroupsObject = GameObject::create("ContainerGroups");
-    // TODO: Would be nice if we didn't have to use detailed shadows. We would need a separate vertex shader for shadow rendering
-    // that uses instancing. Maybe add an option to provide a custom shadow shader?
-    MeshRenderer* pMeshRenderer = pContainerGroupsObject->addComponent<MeshRenderer>(shaderProgramId, primaryTextureId, shapeId, false, true);
+    MeshRenderer* pMeshRenderer = pContainerGroupsObject->addComponent<MeshRenderer>(shaderProgramId, primaryTextureId, shapeId, false, false,
+        depthProgramId, true);
     Shape* pShape = pMeshRenderer->getShape();
 
     if (pShape->usesInstancing())
@@ -62,6 +63,7 @@ GameObject* ContainerGroupBuilder::build(const std::string& shaderProgramId, con
     }
 
     pShape->generateInstanceData(m_positions.size(), 4, GL_FLOAT, m_positions.data());
+    pContainerGroupsObject->addComponent<InstanceCuller>(m_positions);
 
     btTransform transform;
     transform.setIdentity();
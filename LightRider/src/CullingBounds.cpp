@@ -0,0 +1,87 @@
+#include "CullingBounds.h"
+
+#include "Game.h"
+
+namespace
+{
+    // A coordinate far enough out to contain the whole scene, used for Renderables without bounds.
+    constexpr float UNBOUNDED_EXTENT = 1e20f;
+}
+
+CullingBounds::CullingBounds() :
+    m_renderables(),
+    m_freeSlots(),
+    m_generations(),
+    m_bounds(),
+    m_updateTick(-1)
+{
+}
+
+uint32_t CullingBounds::allocate(Renderable* pRenderable)
+{
+    uint32_t slot;
+
+    if (m_freeSlots.empty())
+    {
+        slot = (uint32_t)m_renderables.size();
+        m_renderables.push_back(pRenderable);
+        m_generations.push_back(0);
+        m_bounds.resize(m_renderables.size());
+    }
+    else
+    {
+        slot = m_freeSlots.back();
+        m_freeSlots.pop_back();
+        m_renderables[slot] = pRenderable;
+    }
+
+    // The Renderable is still being constructed, so its bounds can't be queried yet.
+    setUnbounded(slot);
+
+    return slot;
+}
+
+void CullingBounds::release(uint32_t slot)
+{
+    m_renderables[slot] = nullptr;
+    m_generations[slot]++;
+    m_bounds.setEmpty(slot);
+    m_freeSlots.push_back(slot);
+}
+
+void CullingBounds::cull(const ViewFrustum& frustum, std::vector<uint8_t>& visibility)
+{
+    long tick = Game::getInstance().getTick();
+
+    if (tick != m_updateTick)
+    {
+        update();
+        m_updateTick = tick;
+    }
+
+    frustum.intersectAabbs(m_bounds, visibility);
+}
+
+void CullingBounds::update()
+{
+    for (uint32_t slot = 0; slot < (uint32_t)m_renderables.size(); slot++)
+    {
+        Renderable* pRenderable = m_renderables[slot];
+
+        if (!pRenderable)
+            continue;
+
+        glm::vec3 min;
+        glm::vec3 max;
+
+        if (pRenderable->getWorldBounds(min, max))
+            m_bounds.set(slot, min, max);
+        else
+            setUnbounded(slot);
+    }
+}
+
+void CullingBounds::setUnbounded(uint32_t slot)
+{
+    m_bounds.set(slot, glm::vec3(-UNBOUNDED_EXTENT), glm::vec3(UNBOUNDED_EXTENT));
+}
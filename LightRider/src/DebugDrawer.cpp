@@ -4,6 +4,7 @@
 #include <algorithm>
 
 #include "Game.h"
+#include "GLState.h"
 #include "Scene.h"
 #include "GameConfig.h"
 #include "ConversionUtils.h"
@@ -18,7 +19,7 @@ DebugDrawer::DebugDrawer() :
     m_pointColorBufferSize(0)
 {
     glGenVertexArrays(1, &m_lineVertexArray);
-    glBindVertexArray(m_lineVertexArray);
+    GLState::bindVertexArray(m_lineVertexArray);
 
     glGenBuffers(1, &m_lineVertexBuffer);
     glBindBuffer(GL_ARRAY_BUFFER, m_lineVertexBuffer);
@@ -33,7 +34,7 @@ DebugDrawer::DebugDrawer() :
     glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
 
     glGenVertexArrays(1, &m_pointVertexArray);
-    glBindVertexArray(m_pointVertexArray);
+    GLState::bindVertexArray(m_pointVertexArray);
 
     glGenBuffers(1, &m_pointVertexBuffer);
     glBindBuffer(GL_ARRAY_BUFFER, m_pointVertexBuffer);
@@ -47,13 +48,14 @@ DebugDrawer::DebugDrawer() :
     glEnableVertexAttribArray(1);
     glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
 
-    glBindVertexArray(0);
+    GLState::bindVertexArray(0);
 
     GameConfig& config = Game::getInstance().getConfig();
 
     m_pLineProgram = new Program();
     m_pLineProgram->setVerbose(true);
     m_pLineProgram->setShaderNames(config.resourceDirectory + "line_vertex.glsl", config.resourceDirectory + "line_fragment.glsl");
+    m_pLineProgram->addIncludeName(config.resourceDirectory + "view_uniforms.glsl");
 
     if (!m_pLineProgram->init())
     {
@@ -61,8 +63,6 @@ DebugDrawer::DebugDrawer() :
         return;
     }
 
-    m_pLineProgram->addUniform("P");
-    m_pLineProgram->addUniform("V");
     m_pLineProgram->addAttribute("vertexPosition");
     m_pLineProgram->addAttribute("vertexColor");
 }
@@ -90,11 +90,6 @@ void DebugDrawer::drawContactPoint(const btVector3& pointOnB, const btVector3& n
 
 void DebugDrawer::flushLines()
 {
-    Camera* pCamera = Game::getInstance().getScene()->getActiveCamera();
-
-    const glm::mat4& P = pCamera->getPerspectiveMatrix();
-    const glm::mat4& V = pCamera->getViewMatrix();
-
     int lineVertexCount = (int)m_lineVertices.size();
     int lineColorCount = (int)m_lineColors.size();
 
@@ -109,10 +104,7 @@ void DebugDrawer::flushLines()
 
     m_pLineProgram->bind();
 
-    glUniformMatrix4fv(m_pLineProgram->getUniform("P"), 1, GL_FALSE, &P[0][0]);
-    glUniformMatrix4fv(m_pLineProgram->getUniform("V"), 1, GL_FALSE, &V[0][0]);
-
-    glBindVertexArray(m_lineVertexArray);
+    GLState::bindVertexArray(m_lineVertexArray);
 
     glBindBuffer(GL_ARRAY_BUFFER, m_lineVertexBuffer);
 
@@ -126,7 +118,7 @@ void DebugDrawer::flushLines()
 
     glDrawArrays(GL_LINES, 0, lineVertexCount);
 
-    glBindVertexArray(m_pointVertexArray);
+    GLState::bindVertexArray(m_pointVertexArray);
 
     glBindBuffer(GL_ARRAY_BUFFER, m_pointVertexBuffer);
 
@@ -141,7 +133,7 @@ void DebugDrawer::flushLines()
     glPointSize(contactPointSize);
     glDrawArrays(GL_POINTS, 0, pointVertexCount);
 
-    glBindVertexArray(0);
+    GLState::bindVertexArray(0);
 
     m_pLineProgram->unbind();
 
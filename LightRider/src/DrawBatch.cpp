@@ -0,0 +1,196 @@
+#include "DrawBatch.h"
+
+#include "GLState.h"
+
+DrawBatch::DrawBatch(const GeometryArena& arena, int drawCapacity) :
+    m_vertexArray(0),
+    m_drawIndexBuffer(0),
+    m_commandBuffer(0),
+    m_drawDataBuffer(0),
+    m_boundsSlotBuffer(0),
+    m_pVisibilityShader(nullptr),
+    m_visibilityBuffer(0),
+    m_boundsSlot(0),
+    m_drawCapacity(drawCapacity),
+    m_isCullingEnabled(true),
+    m_commands(),
+    m_drawData(),
+    m_boundsSlots()
+{
+    m_commands.reserve(drawCapacity);
+    m_drawData.reserve(drawCapacity);
+    m_boundsSlots.reserve(drawCapacity);
+
+    std::vector<GLuint> drawIndices(drawCapacity);
+
+    for (int i = 0; i < drawCapacity; i++)
+        drawIndices[i] = i;
+
+    glGenBuffers(1, &m_drawIndexBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, m_drawIndexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, drawCapacity * sizeof(GLuint), drawIndices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glGenBuffers(1, &m_commandBuffer);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, drawCapacity * sizeof(DrawElementsIndirectCommand), nullptr, GL_STREAM_DRAW);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    glGenBuffers(1, &m_drawDataBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_drawDataBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, drawCapacity * sizeof(DrawData), nullptr, GL_STREAM_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    glGenBuffers(1, &m_boundsSlotBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_boundsSlotBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, drawCapacity * sizeof(GLuint), nullptr, GL_STREAM_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    // The vertex layout matches Shape's, reading every mesh from the arena's shared buffers.
+    glGenVertexArrays(1, &m_vertexArray);
+    GLState::bindVertexArray(m_vertexArray);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, arena.getElementBuffer());
+    glBindVertexBuffer(0, arena.getVertexBuffer(), 0, GeometryArena::VERTEX_SIZE);
+
+    glVertexAttribFormat(Shape::POSITION_LOCATION, 3, GL_FLOAT, GL_FALSE, 0);
+    glVertexAttribBinding(Shape::POSITION_LOCATION, 0);
+    glEnableVertexAttribArray(Shape::POSITION_LOCATION);
+
+    glVertexAttribFormat(Shape::NORMAL_LOCATION, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float));
+    glVertexAttribBinding(Shape::NORMAL_LOCATION, 0);
+    glEnableVertexAttribArray(Shape::NORMAL_LOCATION);
+
+    glVertexAttribFormat(Shape::TEXTURE_LOCATION, 2, GL_FLOAT, GL_FALSE, 6 * sizeof(float));
+    glVertexAttribBinding(Shape::TEXTURE_LOCATION, 0);
+    glEnableVertexAttribArray(Shape::TEXTURE_LOCATION);
+
+    // With a divisor of one, each command's base instance selects its own draw index.
+    glBindVertexBuffer(1, m_drawIndexBuffer, 0, sizeof(GLuint));
+    glVertexAttribIFormat(DRAW_INDEX_LOCATION, 1, GL_UNSIGNED_INT, 0);
+    glVertexAttribBinding(DRAW_INDEX_LOCATION, 1);
+    glVertexBindingDivisor(1, 1);
+    glEnableVertexAttribArray(DRAW_INDEX_LOCATION);
+
+    GLState::bindVertexArray(0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+DrawBatch::~DrawBatch()
+{
+    glDeleteVertexArrays(1, &m_vertexArray);
+    glDeleteBuffers(1, &m_drawIndexBuffer);
+    glDeleteBuffers(1, &m_commandBuffer);
+    glDeleteBuffers(1, &m_drawDataBuffer);
+    glDeleteBuffers(1, &m_boundsSlotBuffer);
+
+    GLState::invalidate();
+}
+
+bool DrawBatch::add(const Shape* pShape, const DrawData& drawData, bool isCullingEnabled)
+{
+    if (!pShape->isInArena() || pShape->usesInstancing())
+        return false;
+
+    if (isCullingEnabled != m_isCullingEnabled)
+    {
+        submit();
+        m_isCullingEnabled = isCullingEnabled;
+    }
+
+    for (int i = 0; i < pShape->getObjectCount(); i++)
+    {
+        if ((int)m_commands.size() == m_drawCapacity)
+            submit();
+
+        const GeometryRange& range = pShape->getGeometryRange(i);
+
+        m_commands.push_back({ range.indexCount, 1, range.firstIndex, range.baseVertex, (GLuint)m_commands.size() });
+        m_drawData.push_back(drawData);
+        m_boundsSlots.push_back(m_boundsSlot);
+    }
+
+    return true;
+}
+
+void DrawBatch::setVisibilityTest(ComputeProgram* pVisibilityShader, GLuint visibilityBuffer)
+{
+    submit();
+
+    m_pVisibilityShader = pVisibilityShader;
+    m_visibilityBuffer = pVisibilityShader ? visibilityBuffer : 0;
+}
+
+void DrawBatch::submit()
+{
+    if (m_commands.empty())
+        return;
+
+    // Respecifying the buffers lets the driver hand out fresh storage rather than waiting on earlier draws.
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, m_drawCapacity * sizeof(DrawElementsIndirectCommand), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, m_commands.size() * sizeof(DrawElementsIndirectCommand), m_commands.data());
+
+    // Hidden draws keep their commands, but with no instances. This runs before the draw data is bound,
+    // since the visibility shader uses the same storage bindings.
+    if (m_visibilityBuffer)
+    {
+        GLuint program = GLState::getProgram();
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_boundsSlotBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, m_drawCapacity * sizeof(GLuint), nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, m_boundsSlots.size() * sizeof(GLuint), m_boundsSlots.data());
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        m_pVisibilityShader->bind();
+        glUniform1ui(m_pVisibilityShader->getUniform("commandCount"), (GLuint)m_commands.size());
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_commandBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_boundsSlotBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_visibilityBuffer);
+        glDispatchCompute(((GLuint)m_commands.size() + VISIBILITY_WORK_GROUP_SIZE - 1) / VISIBILITY_WORK_GROUP_SIZE, 1, 1);
+        glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+        m_pVisibilityShader->unbind();
+
+        // The batch draws with the program that was current when it was submitted.
+        GLState::useProgram(program);
+    }
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_drawDataBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, m_drawCapacity * sizeof(DrawData), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, m_drawData.size() * sizeof(DrawData), m_drawData.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DRAW_DATA_STORAGE_BINDING, m_drawDataBuffer);
+
+    if (m_isCullingEnabled)
+    {
+        GLState::enable(GL_CULL_FACE);
+        GLState::cullFace(GL_BACK);
+    }
+    else
+    {
+        GLState::disable(GL_CULL_FACE);
+    }
+
+    GLState::bindVertexArray(m_vertexArray);
+    glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, (GLsizei)m_commands.size(), 0);
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    m_commands.clear();
+    m_drawData.clear();
+    m_boundsSlots.clear();
+}
+
+void DrawBatch::bindSingleDrawData(const DrawData& drawData)
+{
+    submit();
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_drawDataBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, m_drawCapacity * sizeof(DrawData), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(DrawData), &drawData);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DRAW_DATA_STORAGE_BINDING, m_drawDataBuffer);
+
+    // Vertex arrays without the draw index attribute read its current value, so point it at the first entry.
+    glVertexAttribI1ui(DRAW_INDEX_LOCATION, 0);
+}
@@ -0,0 +1,125 @@
+#include "DrawList.h"
+
+#include <iostream>
+
+#include "RadixSort.h"
+
+DrawList::DrawList() :
+    m_items(),
+    m_sortBuffer(),
+    m_indices(),
+    m_sortIds(),
+    m_unkeyedCount(0),
+    m_isDirty(false)
+{
+}
+
+void DrawList::add(Renderable* pRenderable, DrawPass passes, Program* pShaderProgram, Texture* pTexture, Program* pDepthProgram,
+    uint32_t boundsSlot)
+{
+    if (m_indices.find(pRenderable) != m_indices.end())
+        return;
+
+    m_indices[pRenderable] = m_items.size();
+    m_items.push_back({ 0, passes, pRenderable, pShaderProgram, pTexture, pDepthProgram, boundsSlot });
+
+    m_unkeyedCount++;
+    m_isDirty = true;
+}
+
+void DrawList::remove(Renderable* pRenderable)
+{
+    auto indexItr = m_indices.find(pRenderable);
+
+    if (indexItr == m_indices.end())
+        return;
+
+    m_items[indexItr->second].pRenderable = nullptr;
+    m_indices.erase(indexItr);
+
+    m_isDirty = true;
+}
+
+const DrawItem* DrawList::find(Renderable* pRenderable) const
+{
+    auto indexItr = m_indices.find(pRenderable);
+
+    if (indexItr == m_indices.end())
+        return nullptr;
+
+    return &m_items[indexItr->second];
+}
+
+const std::vector<DrawItem>& DrawList::getItems()
+{
+    if (m_isDirty)
+        sort();
+
+    return m_items;
+}
+
+uint32_t DrawList::getSortId(const void* pResource, int bits)
+{
+    if (!pResource)
+        return 0;
+
+    auto idItr = m_sortIds.find(pResource);
+
+    if (idItr != m_sortIds.end())
+        return idItr->second;
+
+    uint32_t id = (uint32_t)m_sortIds.size() + 1;
+
+    // IDs beyond the field width share the last value, which only costs some extra state changes.
+    if (id >= (1u << bits))
+    {
+        std::cerr << "Warning: draw list sort ID space exhausted!" << std::endl;
+        id = (1u << bits) - 1;
+    }
+
+    m_sortIds[pResource] = id;
+
+    return id;
+}
+
+void DrawList::computeKey(DrawItem& item)
+{
+    uint64_t passes = static_cast<unsigned>(item.passes);
+    uint64_t program = getSortId(item.pShaderProgram, PROGRAM_BITS);
+    uint64_t texture = getSortId(item.pTexture, TEXTURE_BITS);
+    uint64_t mesh = getSortId(item.pRenderable->getMesh(), MESH_BITS);
+
+    item.key = (passes << (PROGRAM_BITS + TEXTURE_BITS + MESH_BITS))
+        | (program << (TEXTURE_BITS + MESH_BITS))
+        | (texture << MESH_BITS)
+        | mesh;
+}
+
+void DrawList::sort()
+{
+    size_t firstUnkeyed = m_items.size() - m_unkeyedCount;
+    size_t liveCount = 0;
+
+    for (size_t i = 0; i < m_items.size(); i++)
+    {
+        DrawItem& item = m_items[i];
+
+        if (!item.pRenderable)
+            continue;
+
+        if (i >= firstUnkeyed)
+            computeKey(item);
+
+        m_items[liveCount++] = item;
+    }
+
+    m_items.resize(liveCount);
+    m_unkeyedCount = 0;
+
+    radixSort(m_items, m_sortBuffer, 64, [](const DrawItem& item) { return item.key; });
+
+    for (size_t i = 0; i < m_items.size(); i++)
+        m_indices[m_items[i].pRenderable] = i;
+
+    m_isDirty = false;
+}
@@ -10,10 +10,26 @@
 #include <iostream>
 #include <cstring>
 #include <cassert>
+#include <atomic>
 
 namespace GLSL
 {
 
+// The maximum depth of nested debug groups that are tracked for error reports.
+constexpr int MAX_DEBUG_GROUP_DEPTH = 16;
+
+// If true, the debug message callback has been installed.
+static bool s_isDebugOutputEnabled = false;
+
+// The names of the currently open debug groups. Only touched by the rendering thread.
+static const char *s_debugGroupNames[MAX_DEBUG_GROUP_DEPTH];
+
+// The number of currently open debug groups.
+static int s_debugGroupDepth = 0;
+
+// The name of the innermost open debug group. Read by the driver's callback thread.
+static std::atomic<const char *> s_currentDebugGroup(nullptr);
+
 const char * errorString(GLenum err)
 {
     switch (err) {
@@ -167,4 +183,102 @@ void vertexAttribPointer(const GLint handle, GLint size, GLenum type, GLboolean
     }
 }
 
+const char * debugTypeString(GLenum type)
+{
+    switch (type) {
+    case GL_DEBUG_TYPE_ERROR:
+        return "error";
+    case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR:
+        return "deprecated behavior";
+    case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR:
+        return "undefined behavior";
+    case GL_DEBUG_TYPE_PORTABILITY:
+        return "portability";
+    case GL_DEBUG_TYPE_PERFORMANCE:
+        return "performance";
+    default:
+        return "message";
+    }
+}
+
+void APIENTRY debugMessageCallback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar *message, const void *userParam)
+{
+    if (type == GL_DEBUG_TYPE_PUSH_GROUP || type == GL_DEBUG_TYPE_POP_GROUP || severity == GL_DEBUG_SEVERITY_NOTIFICATION)
+    {
+        return;
+    }
+
+    // In asynchronous mode the pass may have ended by the time the message arrives, so the name is a best guess.
+    const char *passName = s_currentDebugGroup.load();
+    printf("OpenGL %s in pass '%s' (id %u): %s\n", debugTypeString(type), passName ? passName : "none", id, message);
+}
+
+void enableDebugOutput(bool synchronous)
+{
+    GLint contextFlags;
+    glGetIntegerv(GL_CONTEXT_FLAGS, &contextFlags);
+
+    if (!(contextFlags & GL_CONTEXT_FLAG_DEBUG_BIT))
+    {
+        std::cerr << "OpenGL debug output requested, but the context is not a debug context." << std::endl;
+    }
+
+    glEnable(GL_DEBUG_OUTPUT);
+
+    if (synchronous)
+    {
+        glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+    }
+    else
+    {
+        glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+    }
+
+    glDebugMessageCallback(debugMessageCallback, nullptr);
+    glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION, 0, nullptr, GL_FALSE);
+
+    s_isDebugOutputEnabled = true;
+}
+
+void pushDebugGroup(const char *name)
+{
+    if (!s_isDebugOutputEnabled)
+    {
+        return;
+    }
+
+    glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, name);
+
+    if (s_debugGroupDepth < MAX_DEBUG_GROUP_DEPTH)
+    {
+        s_debugGroupNames[s_debugGroupDepth] = name;
+    }
+
+    s_debugGroupDepth++;
+    s_currentDebugGroup.store(name);
+}
+
+void popDebugGroup()
+{
+    if (!s_isDebugOutputEnabled || s_debugGroupDepth == 0)
+    {
+        return;
+    }
+
+    glPopDebugGroup();
+
+    s_debugGroupDepth--;
+
+    int parentIndex = s_debugGroupDepth - 1;
+
+    if (parentIndex < 0)
+    {
+        s_currentDebugGroup.store(nullptr);
+    }
+    else if (parentIndex < MAX_DEBUG_GROUP_DEPTH)
+    {
+        s_currentDebugGroup.store(s_debugGroupNames[parentIndex]);
+    }
+}
+
 }
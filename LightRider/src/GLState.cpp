@@ -0,0 +1,236 @@
+#include "GLState.h"
+
+namespace
+{
+    // The number of texture units whose bindings are tracked.
+    const int TRACKED_TEXTURE_UNITS = 16;
+
+    // The texture targets whose bindings are tracked.
+    const GLenum TRACKED_TEXTURE_TARGETS[] = { GL_TEXTURE_2D, GL_TEXTURE_3D, GL_TEXTURE_2D_ARRAY };
+    const int TRACKED_TEXTURE_TARGET_COUNT = sizeof(TRACKED_TEXTURE_TARGETS) / sizeof(GLenum);
+
+    // The capabilities whose enabled state is tracked.
+    const GLenum TRACKED_CAPABILITIES[] = { GL_BLEND, GL_CULL_FACE, GL_DEPTH_TEST };
+    const int TRACKED_CAPABILITY_COUNT = sizeof(TRACKED_CAPABILITIES) / sizeof(GLenum);
+
+    // The number of draw buffers whose blend functions are tracked.
+    const int TRACKED_DRAW_BUFFERS = 8;
+
+    // Marks a tracked value as unknown, forcing the next change to be issued.
+    const GLuint UNKNOWN = ~0u;
+
+    struct BlendFunction
+    {
+        GLenum sourceFactor;
+        GLenum destinationFactor;
+    };
+
+    GLuint s_program;
+    GLuint s_activeTextureUnit;
+    GLuint s_textures[TRACKED_TEXTURE_UNITS][TRACKED_TEXTURE_TARGET_COUNT];
+    GLuint s_vertexArray;
+    GLuint s_capabilities[TRACKED_CAPABILITY_COUNT];
+    GLuint s_cullFaceMode;
+    GLuint s_depthMask;
+    BlendFunction s_blendFunctions[TRACKED_DRAW_BUFFERS];
+
+    GLStateStats s_currentStats;
+    GLStateStats s_frameStats;
+
+    int findTextureTarget(GLenum target)
+    {
+        for (int i = 0; i < TRACKED_TEXTURE_TARGET_COUNT; i++)
+        {
+            if (TRACKED_TEXTURE_TARGETS[i] == target)
+                return i;
+        }
+
+        return -1;
+    }
+
+    int findCapability(GLenum capability)
+    {
+        for (int i = 0; i < TRACKED_CAPABILITY_COUNT; i++)
+        {
+            if (TRACKED_CAPABILITIES[i] == capability)
+                return i;
+        }
+
+        return -1;
+    }
+
+    // Updates a tracked value, returning true if the change needs to be issued to OpenGL.
+    bool track(GLuint& trackedValue, GLuint value, int& changes, int& changesAvoided)
+    {
+        if (trackedValue == value)
+        {
+            changesAvoided++;
+            return false;
+        }
+
+        trackedValue = value;
+        changes++;
+        return true;
+    }
+
+    void setCapability(GLenum capability, bool enabled)
+    {
+        int index = findCapability(capability);
+
+        if (index != -1 && !track(s_capabilities[index], enabled ? GL_TRUE : GL_FALSE,
+            s_currentStats.renderStateChanges, s_currentStats.renderStateChangesAvoided))
+        {
+            return;
+        }
+
+        if (index == -1)
+            s_currentStats.renderStateChanges++;
+
+        if (enabled)
+            glEnable(capability);
+        else
+            glDisable(capability);
+    }
+}
+
+namespace GLState
+{
+    void beginFrame()
+    {
+        s_frameStats = s_currentStats;
+        s_currentStats = GLStateStats();
+
+        invalidate();
+    }
+
+    void invalidate()
+    {
+        s_program = UNKNOWN;
+        s_activeTextureUnit = UNKNOWN;
+        s_vertexArray = UNKNOWN;
+        s_cullFaceMode = UNKNOWN;
+        s_depthMask = UNKNOWN;
+
+        for (int i = 0; i < TRACKED_TEXTURE_UNITS; i++)
+        {
+            for (int j = 0; j < TRACKED_TEXTURE_TARGET_COUNT; j++)
+                s_textures[i][j] = UNKNOWN;
+        }
+
+        for (int i = 0; i < TRACKED_CAPABILITY_COUNT; i++)
+            s_capabilities[i] = UNKNOWN;
+
+        for (int i = 0; i < TRACKED_DRAW_BUFFERS; i++)
+            s_blendFunctions[i] = { UNKNOWN, UNKNOWN };
+    }
+
+    const GLStateStats& getFrameStats()
+    {
+        return s_frameStats;
+    }
+
+    const GLStateStats& getCurrentStats()
+    {
+        return s_currentStats;
+    }
+
+    void writeStats(std::ostream& stream, const GLStateStats& stats)
+    {
+        stream << "programs " << stats.programChanges << " (" << stats.programChangesAvoided << " avoided)"
+            << " textures " << stats.textureChanges << " (" << stats.textureChangesAvoided << " avoided)"
+            << " vertex arrays " << stats.vertexArrayChanges << " (" << stats.vertexArrayChangesAvoided << " avoided)"
+            << " render state " << stats.renderStateChanges << " (" << stats.renderStateChangesAvoided << " avoided)";
+    }
+
+    void useProgram(GLuint program)
+    {
+        if (track(s_program, program, s_currentStats.programChanges, s_currentStats.programChangesAvoided))
+            glUseProgram(program);
+    }
+
+    GLuint getProgram()
+    {
+        return s_program;
+    }
+
+    void releaseProgram()
+    {
+        // Nothing is counted: a release was never a program change, so it isn't one avoided either.
+    }
+
+    void activeTexture(GLenum unit)
+    {
+        if (track(s_activeTextureUnit, unit, s_currentStats.textureChanges, s_currentStats.textureChangesAvoided))
+            glActiveTexture(unit);
+    }
+
+    void bindTexture(GLenum target, GLuint texture)
+    {
+        int unitIndex = s_activeTextureUnit == UNKNOWN ? -1 : (int)(s_activeTextureUnit - GL_TEXTURE0);
+        int targetIndex = findTextureTarget(target);
+
+        if (unitIndex < 0 || unitIndex >= TRACKED_TEXTURE_UNITS || targetIndex == -1)
+        {
+            // The binding can't be tracked, so the unit's tracked bindings become unknown.
+            if (unitIndex >= 0 && unitIndex < TRACKED_TEXTURE_UNITS)
+            {
+                for (int i = 0; i < TRACKED_TEXTURE_TARGET_COUNT; i++)
+                    s_textures[unitIndex][i] = UNKNOWN;
+            }
+
+            s_currentStats.textureChanges++;
+            glBindTexture(target, texture);
+            return;
+        }
+
+        if (track(s_textures[unitIndex][targetIndex], texture, s_currentStats.textureChanges, s_currentStats.textureChangesAvoided))
+            glBindTexture(target, texture);
+    }
+
+    void bindVertexArray(GLuint vertexArray)
+    {
+        if (track(s_vertexArray, vertexArray, s_currentStats.vertexArrayChanges, s_currentStats.vertexArrayChangesAvoided))
+            glBindVertexArray(vertexArray);
+    }
+
+    void enable(GLenum capability)
+    {
+        setCapability(capability, true);
+    }
+
+    void disable(GLenum capability)
+    {
+        setCapability(capability, false);
+    }
+
+    void cullFace(GLenum mode)
+    {
+        if (track(s_cullFaceMode, mode, s_currentStats.renderStateChanges, s_currentStats.renderStateChangesAvoided))
+            glCullFace(mode);
+    }
+
+    void depthMask(GLboolean flag)
+    {
+        if (track(s_depthMask, flag, s_currentStats.renderStateChanges, s_currentStats.renderStateChangesAvoided))
+            glDepthMask(flag);
+    }
+
+    void blendFunc(GLuint buffer, GLenum sourceFactor, GLenum destinationFactor)
+    {
+        if (buffer < TRACKED_DRAW_BUFFERS)
+        {
+            BlendFunction& blendFunction = s_blendFunctions[buffer];
+
+            if (blendFunction.sourceFactor == sourceFactor && blendFunction.destinationFactor == destinationFactor)
+            {
+                s_currentStats.renderStateChangesAvoided++;
+                return;
+            }
+
+            blendFunction = { sourceFactor, destinationFactor };
+        }
+
+        s_currentStats.renderStateChanges++;
+        glBlendFunci(buffer, sourceFactor, destinationFactor);
+    }
+}
@@ -5,6 +5,7 @@
 #include <glad/glad.h>
 
 #include "GLSL.h"
+#include "GLState.h"
 
 void glfwErrorCallback(int error, const char* description)
 {
@@ -31,6 +32,7 @@ bool Game::init(GameConfig config)
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
+    glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, config.glDebugOutput ? GL_TRUE : GL_FALSE);
 
     m_pWindow = glfwCreateWindow(config.initialWindowWidth, config.initialWindowHeight, config.windowTitle,
         config.initialIsFullscreen ? glfwGetPrimaryMonitor() : nullptr, nullptr);
@@ -53,6 +55,11 @@ bool Game::init(GameConfig config)
         return false;
     }
 
+    if (config.glDebugOutput)
+        GLSL::enableDebugOutput(config.glDebugOutputSynchronous);
+
+    GLState::invalidate();
+
     glfwSwapInterval(0);
 
     glfwSetWindowCloseCallback(m_pWindow, Game::glfwWindowCloseCallback);
@@ -138,6 +145,8 @@ void Game::run(Scene *pScene)
 
         m_pCurrentScene->update(deltaTime);
         m_pCurrentScene->postUpdate(deltaTime);
+
+        GLState::beginFrame();
         m_pCurrentScene->render();
 
         glfwSwapBuffers(m_pWindow);
@@ -0,0 +1,65 @@
+#include "GeometryArena.h"
+
+#include <iostream>
+
+GeometryArena::GeometryArena(GLsizei vertexCapacity, GLsizei indexCapacity) :
+    m_vertexBuffer(0),
+    m_elementBuffer(0),
+    m_vertexCapacity(vertexCapacity),
+    m_indexCapacity(indexCapacity),
+    m_vertexCount(0),
+    m_indexCount(0)
+{
+    glGenBuffers(1, &m_vertexBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)vertexCapacity * VERTEX_SIZE, nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // The element buffer is filled through GL_COPY_WRITE_BUFFER so that no vertex array's element binding is disturbed.
+    glGenBuffers(1, &m_elementBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_elementBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)indexCapacity * sizeof(unsigned int), nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+GeometryArena::~GeometryArena()
+{
+    glDeleteBuffers(1, &m_vertexBuffer);
+    glDeleteBuffers(1, &m_elementBuffer);
+}
+
+bool GeometryArena::hasRoom(GLsizei vertexCount, GLsizei indexCount) const
+{
+    if (m_vertexCount + vertexCount > m_vertexCapacity || m_indexCount + indexCount > m_indexCapacity)
+    {
+        std::cerr << "Geometry arena is full (" << m_vertexCount << "/" << m_vertexCapacity << " vertices, "
+            << m_indexCount << "/" << m_indexCapacity << " indices)!" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool GeometryArena::allocate(const float* pVertexData, GLsizei vertexCount, const unsigned int* pIndices, GLsizei indexCount,
+    GeometryRange& range)
+{
+    if (!hasRoom(vertexCount, indexCount))
+        return false;
+
+    range.firstIndex = m_indexCount;
+    range.indexCount = indexCount;
+    range.baseVertex = m_vertexCount;
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+    glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)m_vertexCount * VERTEX_SIZE, (GLsizeiptr)vertexCount * VERTEX_SIZE, pVertexData);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_elementBuffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)m_indexCount * sizeof(unsigned int), (GLsizeiptr)indexCount * sizeof(unsigned int), pIndices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    m_vertexCount += vertexCount;
+    m_indexCount += indexCount;
+
+    return true;
+}
@@ -0,0 +1,245 @@
+#include "OcclusionCuller.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "CullingBounds.h"
+#include "Game.h"
+#include "GLSL.h"
+#include "GLState.h"
+
+OcclusionCuller::OcclusionCuller() :
+    m_pDownsampleShader(nullptr),
+    m_pTestShader(nullptr),
+    m_pDrawVisibilityShader(nullptr),
+    m_pyramidTexture(0),
+    m_pyramidSize(0),
+    m_pyramidMipCount(0),
+    m_pyramidPvMatrix(1.0f),
+    m_isPyramidBuilt(false),
+    m_boundsBuffer(0),
+    m_resultBuffers(),
+    m_resultFences(),
+    m_resultCounts(),
+    m_resultGenerations(),
+    m_nextResultBuffer(0),
+    m_resultBuffer(0),
+    m_results(),
+    m_instanceHistoryBuffers()
+{
+    AssetManager* pAssets = Game::getInstance().getScene()->getAssetManager();
+    m_pDownsampleShader = pAssets->getComputeShaderProgram("hiZDownsampleCompute");
+    m_pTestShader = pAssets->getComputeShaderProgram("occlusionCullCompute");
+    m_pDrawVisibilityShader = pAssets->getComputeShaderProgram("drawVisibilityCompute");
+
+    glGenBuffers(1, &m_boundsBuffer);
+    glGenBuffers(RESULT_BUFFER_COUNT, m_resultBuffers);
+}
+
+OcclusionCuller::~OcclusionCuller()
+{
+    deletePyramid();
+
+    for (GLsync fence : m_resultFences)
+    {
+        if (fence)
+            glDeleteSync(fence);
+    }
+
+    for (auto& pair : m_instanceHistoryBuffers)
+        glDeleteBuffers(1, &pair.second);
+
+    glDeleteBuffers(1, &m_boundsBuffer);
+    glDeleteBuffers(RESULT_BUFFER_COUNT, m_resultBuffers);
+
+    GLState::invalidate();
+}
+
+void OcclusionCuller::resize(int width, int height)
+{
+    deletePyramid();
+
+    m_pyramidSize = glm::ivec2(width, height);
+    m_pyramidMipCount = 1 + (int)std::floor(std::log2((float)std::max(width, height)));
+
+    glGenTextures(1, &m_pyramidTexture);
+    GLState::bindTexture(GL_TEXTURE_2D, m_pyramidTexture);
+    glTexStorage2D(GL_TEXTURE_2D, m_pyramidMipCount, GL_R32F, width, height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    GLState::bindTexture(GL_TEXTURE_2D, 0);
+
+    // Instance histories were gathered at the old size, but they remain valid as a starting point.
+    m_isPyramidBuilt = false;
+}
+
+void OcclusionCuller::buildPyramid(GLuint depthTexture, const glm::mat4& pvMatrix)
+{
+    GLSL::pushDebugGroup("Depth pyramid");
+
+    m_pDownsampleShader->bind();
+    GLState::activeTexture(GL_TEXTURE0);
+
+    glm::ivec2 levelSize = m_pyramidSize;
+
+    for (int level = 0; level < m_pyramidMipCount; level++)
+    {
+        // Level 0 is copied from the depth buffer, and each later level reduces the one before it.
+        GLState::bindTexture(GL_TEXTURE_2D, level == 0 ? depthTexture : m_pyramidTexture);
+        glUniform1i(m_pDownsampleShader->getUniform("sourceLevel"), level - 1);
+        glBindImageTexture(0, m_pyramidTexture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+
+        glDispatchCompute((levelSize.x + WORK_GROUP_SIZE - 1) / WORK_GROUP_SIZE, (levelSize.y + WORK_GROUP_SIZE - 1) / WORK_GROUP_SIZE, 1);
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+        levelSize = glm::max(levelSize / 2, glm::ivec2(1));
+    }
+
+    m_pDownsampleShader->unbind();
+
+    m_pyramidPvMatrix = pvMatrix;
+    m_isPyramidBuilt = true;
+
+    GLSL::popDebugGroup();
+}
+
+void OcclusionCuller::bindPyramid(ComputeProgram* pProgram) const
+{
+    glm::vec2 pyramidSize = glm::vec2(m_pyramidSize);
+
+    GLState::activeTexture(GL_TEXTURE0);
+    GLState::bindTexture(GL_TEXTURE_2D, m_pyramidTexture);
+
+    glUniformMatrix4fv(pProgram->getUniform("pyramidPvMatrix"), 1, GL_FALSE, &m_pyramidPvMatrix[0][0]);
+    glUniform2fv(pProgram->getUniform("pyramidSize"), 1, &pyramidSize[0]);
+    glUniform1i(pProgram->getUniform("pyramidMipCount"), m_pyramidMipCount);
+}
+
+void OcclusionCuller::testBounds(const CullingBounds& cullingBounds)
+{
+    const AabbList& bounds = cullingBounds.getBounds();
+    size_t boxCount = bounds.minX.size();
+    int resultBuffer = m_nextResultBuffer;
+
+    // Results are only applied in the frame after their test, so any that were never read back are dropped.
+    for (GLsync& fence : m_resultFences)
+    {
+        if (fence)
+        {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+
+    m_resultBuffer = 0;
+
+    if (!m_isPyramidBuilt || boxCount == 0)
+        return;
+
+    const std::vector<float>* components[6] = { &bounds.minX, &bounds.minY, &bounds.minZ, &bounds.maxX, &bounds.maxY, &bounds.maxZ };
+    GLsizeiptr componentSize = (GLsizeiptr)(boxCount * sizeof(float));
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_boundsBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, componentSize * 6, nullptr, GL_STREAM_DRAW);
+
+    for (int i = 0; i < 6; i++)
+        glBufferSubData(GL_COPY_WRITE_BUFFER, componentSize * i, componentSize, components[i]->data());
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_resultBuffers[resultBuffer]);
+    glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)(boxCount * sizeof(GLuint)), nullptr, GL_STREAM_READ);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    m_pTestShader->bind();
+    bindPyramid(m_pTestShader);
+    glUniform1ui(m_pTestShader->getUniform("boxCount"), (GLuint)boxCount);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_boundsBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_resultBuffers[resultBuffer]);
+
+    glDispatchCompute(((GLuint)boxCount + TEST_WORK_GROUP_SIZE - 1) / TEST_WORK_GROUP_SIZE, 1, 1);
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+    m_pTestShader->unbind();
+
+    m_resultFences[resultBuffer] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_resultCounts[resultBuffer] = boxCount;
+    m_resultGenerations[resultBuffer] = cullingBounds.getGenerations();
+    m_resultBuffer = m_resultBuffers[resultBuffer];
+    m_nextResultBuffer = (resultBuffer + 1) % RESULT_BUFFER_COUNT;
+}
+
+void OcclusionCuller::removeOccluded(const CullingBounds& cullingBounds, std::vector<uint8_t>& visibility,
+    std::vector<uint8_t>& occluded)
+{
+    occluded.assign(visibility.size(), 0);
+
+    // Only the previous frame's test is applied. If it hasn't finished, nothing is culled this frame rather
+    // than hiding slots on anything older.
+    int resultBuffer = (m_nextResultBuffer - 1 + RESULT_BUFFER_COUNT) % RESULT_BUFFER_COUNT;
+    GLsync fence = m_resultFences[resultBuffer];
+
+    if (!fence)
+        return;
+
+    GLenum status = glClientWaitSync(fence, 0, 0);
+
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+        return;
+
+    glDeleteSync(fence);
+    m_resultFences[resultBuffer] = nullptr;
+
+    m_results.resize(m_resultCounts[resultBuffer]);
+
+    glBindBuffer(GL_COPY_READ_BUFFER, m_resultBuffers[resultBuffer]);
+    glGetBufferSubData(GL_COPY_READ_BUFFER, 0, (GLsizeiptr)(m_results.size() * sizeof(GLuint)), m_results.data());
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+    // A slot released since the test may belong to a new Renderable, which the result says nothing about.
+    const std::vector<uint32_t>& generations = cullingBounds.getGenerations();
+    const std::vector<uint32_t>& testedGenerations = m_resultGenerations[resultBuffer];
+    size_t count = std::min(std::min(visibility.size(), m_results.size()), std::min(generations.size(), testedGenerations.size()));
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!m_results[i] && visibility[i] && generations[i] == testedGenerations[i])
+        {
+            visibility[i] = 0;
+            occluded[i] = 1;
+        }
+    }
+}
+
+GLuint OcclusionCuller::getInstanceHistoryBuffer(const InstanceCuller* pInstanceCuller, size_t instanceCount)
+{
+    auto bufferItr = m_instanceHistoryBuffers.find(pInstanceCuller);
+
+    if (bufferItr != m_instanceHistoryBuffers.end())
+        return bufferItr->second;
+
+    std::vector<GLuint> history(instanceCount, 1);
+    GLuint buffer;
+
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)(history.size() * sizeof(GLuint)), history.data(), GL_DYNAMIC_COPY);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    m_instanceHistoryBuffers[pInstanceCuller] = buffer;
+
+    return buffer;
+}
+
+void OcclusionCuller::deletePyramid()
+{
+    if (!m_pyramidTexture)
+        return;
+
+    glDeleteTextures(1, &m_pyramidTexture);
+    m_pyramidTexture = 0;
+    m_isPyramidBuilt = false;
+
+    // The deleted name may be reused, so tracked bindings can no longer be trusted.
+    GLState::invalidate();
+}
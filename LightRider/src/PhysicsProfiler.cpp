@@ -0,0 +1,240 @@
+#include "PhysicsProfiler.h"
+
+#include <iostream>
+#include <cstring>
+
+#include "Game.h"
+
+PhysicsProfiler* PhysicsProfiler::s_pActiveProfiler = nullptr;
+btEnterProfileZoneFunc* PhysicsProfiler::s_pPreviousEnterFunc = nullptr;
+btLeaveProfileZoneFunc* PhysicsProfiler::s_pPreviousLeaveFunc = nullptr;
+std::vector<PhysicsProfiler::ProfileZone> PhysicsProfiler::s_zoneStack;
+
+PhysicsProfiler::PhysicsProfiler(int logSize) :
+    m_logSize(logSize),
+    m_tickCount(0),
+    m_isEnabled(true),
+    m_spikeThreshold(0.0f),
+    m_currentTickStats(),
+    m_lastTickStats()
+{
+    installZoneCallbacks();
+    resetCurrentTickStats();
+}
+
+PhysicsProfiler::~PhysicsProfiler()
+{
+    if (s_pActiveProfiler == this)
+        s_pActiveProfiler = nullptr;
+}
+
+void PhysicsProfiler::recordEvent(const std::string& event)
+{
+    if (!m_isEnabled)
+        return;
+
+    m_currentTickStats.events.push_back(event);
+}
+
+void PhysicsProfiler::recordTrailSegments(int trailSegments)
+{
+    m_currentTickStats.trailSegments += trailSegments;
+}
+
+void PhysicsProfiler::recordChunksSpawned(int chunksSpawned)
+{
+    m_currentTickStats.chunksSpawned += chunksSpawned;
+}
+
+void PhysicsProfiler::beginTick()
+{
+    if (!m_isEnabled)
+        return;
+
+    s_pActiveProfiler = this;
+    m_tickStartTime = Clock::now();
+    m_callbackStartTime = m_tickStartTime;
+    m_callbackEndTime = m_tickStartTime;
+}
+
+void PhysicsProfiler::sampleWorld(btDiscreteDynamicsWorld* pDynamicsWorld)
+{
+    if (!m_isEnabled)
+        return;
+
+    btDispatcher* pDispatcher = pDynamicsWorld->getDispatcher();
+    int numManifolds = pDispatcher->getNumManifolds();
+
+    m_currentTickStats.overlappingPairs = pDynamicsWorld->getBroadphase()->getOverlappingPairCache()->getNumOverlappingPairs();
+    m_currentTickStats.manifolds = numManifolds;
+
+    for (int i = 0; i < numManifolds; i++)
+        m_currentTickStats.contactPoints += pDispatcher->getManifoldByIndexInternal(i)->getNumContacts();
+
+    const btCollisionObjectArray& collisionObjects = pDynamicsWorld->getCollisionObjectArray();
+
+    for (int i = 0; i < collisionObjects.size(); i++)
+    {
+        const btCollisionObject* pCollisionObject = collisionObjects[i];
+
+        if (pCollisionObject->isStaticOrKinematicObject())
+            continue;
+
+        if (pCollisionObject->getActivationState() == ISLAND_SLEEPING)
+            m_currentTickStats.sleepingBodies++;
+        else
+            m_currentTickStats.activeBodies++;
+    }
+}
+
+void PhysicsProfiler::beginCollisionCallbacks()
+{
+    if (!m_isEnabled)
+        return;
+
+    m_callbackStartTime = Clock::now();
+}
+
+void PhysicsProfiler::endCollisionCallbacks()
+{
+    if (!m_isEnabled)
+        return;
+
+    m_callbackEndTime = Clock::now();
+    m_currentTickStats.collisionCallbackTime = elapsedMilliseconds(m_callbackStartTime, m_callbackEndTime);
+}
+
+void PhysicsProfiler::endTick()
+{
+    if (s_pActiveProfiler != this)
+        return;
+
+    s_pActiveProfiler = nullptr;
+
+    Clock::time_point endTime = Clock::now();
+
+    m_currentTickStats.tick = m_tickCount++;
+    m_currentTickStats.frame = Game::getInstance().getTick();
+    m_currentTickStats.gameObjectTickTime = elapsedMilliseconds(m_callbackEndTime, endTime);
+    m_currentTickStats.totalTime = elapsedMilliseconds(m_tickStartTime, endTime);
+
+    m_lastTickStats = m_currentTickStats;
+
+    m_log.push_back(m_currentTickStats);
+
+    while ((int)m_log.size() > m_logSize)
+        m_log.pop_front();
+
+    if (m_spikeThreshold > 0.0f && m_lastTickStats.totalTime > m_spikeThreshold)
+    {
+        std::cerr << "Physics spike: ";
+        writeTickStats(std::cerr, m_lastTickStats);
+        std::cerr << std::endl;
+    }
+
+    m_currentTickStats.events.clear();
+    resetCurrentTickStats();
+}
+
+void PhysicsProfiler::writeTickStats(std::ostream& stream, const PhysicsTickStats& stats)
+{
+    stream << "tick " << stats.tick
+        << " frame " << stats.frame
+        << " | pairs " << stats.overlappingPairs
+        << " manifolds " << stats.manifolds
+        << " contacts " << stats.contactPoints
+        << " iterations " << stats.solverIterations
+        << " trail " << stats.trailSegments
+        << " chunks " << stats.chunksSpawned
+        << " bodies " << stats.activeBodies << "/" << stats.sleepingBodies
+        << " | broadphase " << stats.broadphaseTime
+        << "ms narrowphase " << stats.narrowphaseTime
+        << "ms solver " << stats.solverTime
+        << "ms integrate " << stats.integrationTime
+        << "ms callbacks " << stats.collisionCallbackTime
+        << "ms objects " << stats.gameObjectTickTime
+        << "ms total " << stats.totalTime << "ms";
+
+    for (const std::string& event : stats.events)
+        stream << " [" << event << "]";
+}
+
+void PhysicsProfiler::dumpLog(std::ostream& stream) const
+{
+    for (const PhysicsTickStats& stats : m_log)
+    {
+        writeTickStats(stream, stats);
+        stream << std::endl;
+    }
+}
+
+void PhysicsProfiler::resetCurrentTickStats()
+{
+    std::vector<std::string> pendingEvents;
+    pendingEvents.swap(m_currentTickStats.events);
+
+    m_currentTickStats = PhysicsTickStats();
+    m_currentTickStats.events.swap(pendingEvents);
+}
+
+void PhysicsProfiler::accumulateZone(const ProfileZone& zone, Clock::time_point endTime)
+{
+    float elapsedTime = elapsedMilliseconds(zone.startTime, endTime);
+
+    if (std::strcmp(zone.name, "calculateOverlappingPairs") == 0)
+        m_currentTickStats.broadphaseTime += elapsedTime;
+    else if (std::strcmp(zone.name, "dispatchAllCollisionPairs") == 0)
+        m_currentTickStats.narrowphaseTime += elapsedTime;
+    else if (std::strcmp(zone.name, "solveConstraints") == 0)
+        m_currentTickStats.solverTime += elapsedTime;
+    else if (std::strcmp(zone.name, "integrateTransforms") == 0)
+        m_currentTickStats.integrationTime += elapsedTime;
+}
+
+float PhysicsProfiler::elapsedMilliseconds(Clock::time_point startTime, Clock::time_point endTime)
+{
+    return std::chrono::duration<float, std::milli>(endTime - startTime).count();
+}
+
+void PhysicsProfiler::installZoneCallbacks()
+{
+    if (s_pPreviousEnterFunc)
+        return;
+
+    s_pPreviousEnterFunc = btGetCurrentEnterProfileZoneFunc();
+    s_pPreviousLeaveFunc = btGetCurrentLeaveProfileZoneFunc();
+
+    btSetCustomEnterProfileZoneFunc(enterProfileZone);
+    btSetCustomLeaveProfileZoneFunc(leaveProfileZone);
+}
+
+void PhysicsProfiler::enterProfileZone(const char* name)
+{
+    // Keep Bullet's own CProfileManager tree working when it is compiled in.
+    s_pPreviousEnterFunc(name);
+
+    if (!s_pActiveProfiler)
+    {
+        s_zoneStack.push_back({ name, Clock::time_point() });
+        return;
+    }
+
+    if (std::strcmp(name, "solveSingleIteration") == 0)
+        s_pActiveProfiler->m_currentTickStats.solverIterations++;
+
+    s_zoneStack.push_back({ name, Clock::now() });
+}
+
+void PhysicsProfiler::leaveProfileZone()
+{
+    s_pPreviousLeaveFunc();
+
+    if (s_zoneStack.empty())
+        return;
+
+    ProfileZone zone = s_zoneStack.back();
+    s_zoneStack.pop_back();
+
+    if (s_pActiveProfiler && zone.startTime != Clock::time_point())
+        s_pActiveProfiler->accumulateZone(zone, Clock::now());
+}
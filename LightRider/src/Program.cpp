@@ -4,8 +4,11 @@
 #include <cassert>
 #include <fstream>
 #include <sstream>
+#include <cstring>
+#include <algorithm>
 
 #include "GLSL.h"
+#include "GLState.h"
 
 
 std::string readFileAsString(const std::string &fileName)
@@ -22,6 +25,84 @@ std::string readFileAsString(const std::string &fileName)
     return result;
 }
 
+UniformId findUniformId(const std::string& name)
+{
+    uint32_t hash = hashUniformName(name.c_str());
+
+    for (unsigned i = 0; i < (unsigned)UniformId::COUNT; i++)
+    {
+        if (uniformIdHashes[i] == hash && std::strcmp(uniformIdNames[i], name.c_str()) == 0)
+            return (UniformId)i;
+    }
+
+    return UniformId::COUNT;
+}
+
+// Renames each output of the vertex shader, and defines the geometry shader macros that declare the
+// renamed outputs as inputs and pass them on to the fragment shader under their original names.
+static void passVertexOutputsThrough(std::string& vShaderString, std::string& gShaderString)
+{
+    std::istringstream vShaderStream(vShaderString);
+    std::string line;
+    std::string renames;
+    std::string declarations;
+    std::string copies;
+
+    while (std::getline(vShaderStream, line))
+    {
+        std::istringstream lineStream(line);
+        std::string word;
+        std::string qualifier;
+
+        lineStream >> word;
+
+        if (word == "flat" || word == "smooth" || word == "noperspective")
+        {
+            qualifier = word + " ";
+            lineStream >> word;
+        }
+
+        std::string type;
+        std::string name;
+
+        if (word != "out" || !(lineStream >> type >> name) || name.back() != ';')
+            continue;
+
+        name.pop_back();
+
+        renames += "#define " + name + " _vertex_" + name + "\n";
+        declarations += qualifier + "in " + type + " _vertex_" + name + "[]; " + qualifier + "out " + type + " " + name + "; ";
+        copies += name + " = _vertex_" + name + "[i]; ";
+    }
+
+    // Definitions must follow the #version directive on the first line.
+    vShaderString.insert(vShaderString.find('\n') + 1, renames);
+    gShaderString.insert(gShaderString.find('\n') + 1,
+        "#define VERTEX_OUTPUTS " + declarations + "\n#define COPY_VERTEX_OUTPUTS(i) " + copies + "\n");
+}
+
+// Inserts the included source after the #version directive on the first line, restoring the line numbers
+// that follow so that compile errors still point at the right line.
+static void insertIncludes(std::string& shaderString, const std::string& includeString)
+{
+    shaderString.insert(shaderString.find('\n') + 1, includeString + "#line 2\n");
+}
+
+ProgramVariant Program::selectedVariant = ProgramVariant::DEFAULT;
+
+Program::Program()
+{
+    std::fill(std::begin(uniformTable), std::end(uniformTable), -1);
+}
+
+Program::~Program()
+{
+    for (Program* pVariant : variants)
+    {
+        delete pVariant;
+    }
+}
+
 void Program::setShaderNames(const std::string &v, const std::string &f)
 {
     vShaderName = v;
@@ -34,6 +115,36 @@ void Program::setShaderNames(const std::string &v, const std::vector<std::string
     fShaderNames = f;
 }
 
+void Program::setGeometryShaderName(const std::string &g)
+{
+    gShaderName = g;
+}
+
+void Program::addIncludeName(const std::string &i)
+{
+    includeNames.push_back(i);
+}
+
+void Program::setVariant(ProgramVariant variant, Program* pProgram)
+{
+    // The default variant is always the program itself.
+    if (variant == ProgramVariant::DEFAULT)
+        return;
+
+    delete variants[(unsigned)variant];
+    variants[(unsigned)variant] = pProgram;
+}
+
+Program* Program::getVariant(ProgramVariant variant) const
+{
+    return variant == ProgramVariant::DEFAULT ? const_cast<Program*>(this) : variants[(unsigned)variant];
+}
+
+void Program::selectVariant(ProgramVariant variant)
+{
+    selectedVariant = variant;
+}
+
 bool Program::init()
 {
     GLint rc;
@@ -51,6 +162,33 @@ bool Program::init()
     // Read shader sources
     std::string vShaderString = readFileAsString(vShaderName);
     //std::string fShaderString = readFileAsString(fShaderName);
+    std::string gShaderString;
+
+    if (!gShaderName.empty())
+    {
+        gShaderString = readFileAsString(gShaderName);
+    }
+
+    if (!includeNames.empty())
+    {
+        std::string includeString;
+        for (auto& fileName : includeNames)
+        {
+            includeString += readFileAsString(fileName);
+        }
+
+        insertIncludes(vShaderString, includeString);
+        insertIncludes(fShaderString, includeString);
+
+        if (!gShaderName.empty())
+            insertIncludes(gShaderString, includeString);
+    }
+
+    if (!gShaderName.empty())
+    {
+        passVertexOutputsThrough(vShaderString, gShaderString);
+    }
+
     const char *vshader = vShaderString.c_str();
     const char *fshader = fShaderString.c_str();
 
@@ -91,10 +229,36 @@ bool Program::init()
         return false;
     }
 
+    // Compile geometry shader
+    GLuint GS = 0;
+
+    if (!gShaderName.empty())
+    {
+        const char *gshader = gShaderString.c_str();
+
+        GS = glCreateShader(GL_GEOMETRY_SHADER);
+        CHECKED_GL_CALL(glShaderSource(GS, 1, &gshader, NULL));
+        CHECKED_GL_CALL(glCompileShader(GS));
+        CHECKED_GL_CALL(glGetShaderiv(GS, GL_COMPILE_STATUS, &rc));
+        if (!rc)
+        {
+            if (isVerbose())
+            {
+                GLSL::printShaderInfoLog(GS);
+                std::cout << "Error compiling geometry shader " << gShaderName << std::endl;
+            }
+            return false;
+        }
+    }
+
     // Create the program and link
     pid = glCreateProgram();
     CHECKED_GL_CALL(glAttachShader(pid, VS));
     CHECKED_GL_CALL(glAttachShader(pid, FS));
+
+    if (GS != 0)
+        CHECKED_GL_CALL(glAttachShader(pid, GS));
+
     CHECKED_GL_CALL(glLinkProgram(pid));
     CHECKED_GL_CALL(glGetProgramiv(pid, GL_LINK_STATUS, &rc));
     if (!rc)
@@ -119,28 +283,48 @@ bool Program::init()
 
 void Program::bind()
 {
-    CHECKED_GL_CALL(glUseProgram(pid));
+    CHECKED_GL_CALL(GLState::useProgram(getSelectedVariant().pid));
 }
 
 void Program::unbind()
 {
-    CHECKED_GL_CALL(glUseProgram(0));
+    // The program stays current until another one is bound.
+    GLState::releaseProgram();
 }
 
 void Program::addAttribute(const std::string &name)
 {
     attributes[name] = GLSL::getAttribLocation(pid, name.c_str(), isVerbose());
+
+    for (Program* pVariant : variants)
+    {
+        if (pVariant)
+            pVariant->addAttribute(name);
+    }
 }
 
 void Program::addUniform(const std::string &name)
 {
-    uniforms[name] = GLSL::getUniformLocation(pid, name.c_str(), isVerbose());
+    GLint location = GLSL::getUniformLocation(pid, name.c_str(), isVerbose());
+    uniforms[name] = location;
+
+    UniformId id = findUniformId(name);
+
+    if (id != UniformId::COUNT)
+        uniformTable[(unsigned)id] = location;
+
+    for (Program* pVariant : variants)
+    {
+        if (pVariant)
+            pVariant->addUniform(name);
+    }
 }
 
 GLint Program::getAttribute(const std::string &name) const
 {
-    std::map<std::string, GLint>::const_iterator attribute = attributes.find(name.c_str());
-    if (attribute == attributes.end())
+    const std::map<std::string, GLint>& selectedAttributes = getSelectedVariant().attributes;
+    std::map<std::string, GLint>::const_iterator attribute = selectedAttributes.find(name.c_str());
+    if (attribute == selectedAttributes.end())
     {
         if (isVerbose())
         {
@@ -153,8 +337,9 @@ GLint Program::getAttribute(const std::string &name) const
 
 GLint Program::getUniform(const std::string &name) const
 {
-    std::map<std::string, GLint>::const_iterator uniform = uniforms.find(name.c_str());
-    if (uniform == uniforms.end())
+    const std::map<std::string, GLint>& selectedUniforms = getSelectedVariant().uniforms;
+    std::map<std::string, GLint>::const_iterator uniform = selectedUniforms.find(name.c_str());
+    if (uniform == selectedUniforms.end())
     {
         if (isVerbose())
         {
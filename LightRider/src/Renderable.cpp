@@ -2,11 +2,14 @@
 
 #include "Game.h"
 
-Renderable::Renderable(const std::string& shaderProgramId, const std::string& primaryTextureId, bool useBlending, bool useDetailedShadows) :
+Renderable::Renderable(const std::string& shaderProgramId, const std::string& primaryTextureId, bool useBlending, bool useDetailedShadows,
+    const std::string& depthProgramId, bool isStatic) :
     m_shaderProgramId(shaderProgramId),
     m_imageTextureId(primaryTextureId),
     m_useBlending(useBlending),
-    m_useDetailedShadows(useDetailedShadows)
+    m_useDetailedShadows(useDetailedShadows),
+    m_depthProgramId(depthProgramId),
+    m_isStatic(isStatic)
 {
     Game::getInstance().getScene()->getAssetManager()->_registerRenderable(this);
 }
@@ -20,3 +23,9 @@ float Renderable::getDepth(Camera* pCamera) const
 {
     return glm::length(getTransform()->getPosition() - pCamera->getTransform()->getPosition());
 }
+
+float Renderable::getSortDepth(Camera* pCamera) const
+{
+    glm::vec3 offset = getTransform()->getPosition() - pCamera->getTransform()->getPosition();
+    return glm::dot(offset, offset);
+}
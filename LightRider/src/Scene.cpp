@@ -37,7 +37,9 @@ Scene::Scene() :
     m_pOverlappingPairCache(nullptr),
     m_pSolver(nullptr),
     m_pDynamicsWorld(nullptr),
-    m_pDebugDrawer(nullptr)
+    m_pDebugDrawer(nullptr),
+    m_pPhysicsProfiler(nullptr),
+    m_pShadowMapService(nullptr)
 {
     gContactAddedCallback = fixEdgeContacts;
 }
@@ -51,6 +53,8 @@ Scene::~Scene()
     delete m_pDispatcher;
     delete m_pCollisionConfiguration;
     delete m_pDebugDrawer;
+    delete m_pPhysicsProfiler;
+    delete m_pShadowMapService;
     delete m_pAssetManager;
 }
 
@@ -66,6 +70,9 @@ void Scene::initialize()
 
     m_pDebugDrawer = new DebugDrawer();
 
+    m_pPhysicsProfiler = new PhysicsProfiler(Game::getInstance().getConfig().physicsStatsLogSize);
+    m_pPhysicsProfiler->setSpikeThreshold(Game::getInstance().getConfig().physicsSpikeThreshold);
+
     m_pDynamicsWorld = new btDiscreteDynamicsWorld(m_pDispatcher, m_pOverlappingPairCache, m_pSolver, m_pCollisionConfiguration);
     m_pDynamicsWorld->setInternalTickCallback(physicsPreTickCallback, nullptr, true);
     m_pDynamicsWorld->setInternalTickCallback(physicsTickCallback, nullptr, false);
@@ -100,12 +107,39 @@ void Scene::prePhysicsTick(float physicsTimeStep)
 
 void Scene::physicsTick(float physicsTimeStep)
 {
+    m_pPhysicsProfiler->sampleWorld(m_pDynamicsWorld);
+
+    m_pPhysicsProfiler->beginCollisionCallbacks();
     invokeCollisionCallbacks();
+    m_pPhysicsProfiler->endCollisionCallbacks();
+
     m_pGameObjects->physicsTick(physicsTimeStep);
 }
 
+ShadowMapService* Scene::getShadowMapService()
+{
+    if (!m_pShadowMapService)
+        m_pShadowMapService = new ShadowMapService();
+
+    return m_pShadowMapService;
+}
+
 void Scene::render()
 {
+    // Shadows are rendered once for every camera before any camera renders the scene.
+    if (m_pShadowMapService)
+    {
+        m_pShadowMapService->beginFrame();
+
+        for (Camera* pCamera : m_cameras)
+        {
+            if (pCamera->usesSharedShadowMap())
+                m_pShadowMapService->addView(pCamera);
+        }
+
+        m_pShadowMapService->render();
+    }
+
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     for (Camera* pCamera : m_cameras)
@@ -206,6 +240,7 @@ void Scene::invokeCollisionHandlerCallback(btPersistentManifold* pContactManifol
 void Scene::physicsPreTickCallback(btDynamicsWorld* pDynamicsWorld, btScalar timeStep)
 {
     Scene* pWorldScene = static_cast<Scene*>(pDynamicsWorld->getWorldUserInfo());
+    pWorldScene->m_pPhysicsProfiler->beginTick();
     pWorldScene->prePhysicsTick((float)timeStep);
 }
 
@@ -213,6 +248,7 @@ void Scene::physicsTickCallback(btDynamicsWorld* pDynamicsWorld, btScalar timeSt
 {
     Scene* pWorldScene = static_cast<Scene*>(pDynamicsWorld->getWorldUserInfo());
     pWorldScene->physicsTick((float)timeStep);
+    pWorldScene->m_pPhysicsProfiler->endTick();
 }
 
 bool Scene::cameraComparator(const Camera* c1, const Camera* c2)
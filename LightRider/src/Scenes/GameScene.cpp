@@ -74,7 +74,7 @@ void GameScene::initialize()
     containerGroupBuilder.addGroup(glm::vec2(-50.0f, -100.0f), glm::ivec3(1, 1, 1));
 
     // Build all containers
-    containerGroupBuilder.build("containerShader", "containerTexture", "containerShape");
+    containerGroupBuilder.build("containerShader", "containerTexture", "containerShape", "instancedShadowShader");
 
     initScene();
 }
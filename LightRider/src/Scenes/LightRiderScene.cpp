@@ -1,46 +1,58 @@
 #include "Scenes/LightRiderScene.h"
 #include "ComputeProgram.h"
 #include "ProgramMetadata.h"
+#include "GameConstants.h"
+#include "Game.h"
+#include "GLState.h"
+
+namespace GC = GameConstants;
+
+// Sets the texture unit of a sampler uniform in every variant of the given program.
+static void setSamplerUnit(Program* pProgram, const std::string& name, GLint unit)
+{
+    for (unsigned i = 0; i < (unsigned)ProgramVariant::COUNT; i++)
+    {
+        Program* pVariant = pProgram->getVariant((ProgramVariant)i);
+
+        if (!pVariant)
+            continue;
+
+        GLState::useProgram(pVariant->getPid());
+        glUniform1i(pVariant->getUniform(name), unit);
+    }
+}
 
 void LightRiderScene::loadAssets()
 {
     AssetManager* pAssets = getAssetManager();
 
-    // Bike assets.
-    Program* pBikeShader = loadShaderProgramWithDynamicOutput("bikeShader", "bike_vertex.glsl", "bike_fragment.glsl");
-    pBikeShader->addUniform("playerId");
-    pBikeShader->addUniform("transitionAmount");
+    // Bike assets. Programs flagged with USES_DRAW_DATA read their model matrix and per-object parameters
+    // from the DrawBatch storage buffer rather than from uniforms.
+    Program* pBikeShader = loadShaderProgramWithDynamicOutput("bikeShader", "bike_vertex.glsl", "bike_fragment.glsl",
+        ShaderUniform::TEXTURE_0 | ShaderUniform::DRAW_DATA);
+    addProgramMetadata(pBikeShader, ProgramMetadata::USES_DRAW_DATA);
 
-    Program* pTrailShader = loadShaderProgramWithDynamicOutput("trailShader", "trail_vertex.glsl", "trail_fragment.glsl",
-        ShaderUniform::P_MATRIX
-      | ShaderUniform::V_MATRIX
-    );
+    Program* pTrailShader = loadShaderProgramWithDynamicOutput("trailShader", "trail_vertex.glsl", "trail_fragment.glsl", ShaderUniform::NONE);
     pTrailShader->addUniform("playerId");
     pTrailShader->addUniform("noiseSeed");
     pTrailShader->addUniform("currentTime");
+    pTrailShader->addUniform("useNoiseVolume");
 
     pAssets->loadTexture("bikeTexture", "light_cycle_texture.png", TextureType::IMAGE);
     pAssets->loadShape("bikeShape", "light_cycle.shape");
 
     Program* pChunkShader = loadShaderProgramWithDynamicOutput("chunkShader", "chunk_vertex.glsl", "chunk_fragment.glsl",
-        ShaderUniform::P_MATRIX
-      | ShaderUniform::V_MATRIX
-      | ShaderUniform::M_MATRIX
-      | ShaderUniform::TEXTURE_0);
-    pChunkShader->addUniform("playerId");
+        ShaderUniform::TEXTURE_0 | ShaderUniform::DRAW_DATA);
+    addProgramMetadata(pChunkShader, ProgramMetadata::USES_DRAW_DATA);
 
     pAssets->loadTexture("chunkTexture", "chunk_texture.png", TextureType::IMAGE);
     pAssets->loadShape("chunkShape", "chunk_particle.shape");
 
     // Ground assets.
     Program* pGroundShader = loadShaderProgramWithDynamicOutput("groundShader", "ground_vertex.glsl", "ground_fragment.glsl",
-        ShaderUniform::P_MATRIX
-      | ShaderUniform::V_MATRIX
-      | ShaderUniform::M_MATRIX
+        ShaderUniform::M_MATRIX
       | ShaderUniform::TEXTURE_0
       | ShaderUniform::TEXTURE_3);
-    pGroundShader->addUniform("lightPV");
-    pGroundShader->addUniform("campos");
     pGroundShader->bind();
     glUniform1i(pGroundShader->getUniform("texture3"), 3);
     pGroundShader->unbind();
@@ -48,16 +60,12 @@ void LightRiderScene::loadAssets()
     pAssets->loadTexture("groundTexture", "ground_texture.png", TextureType::IMAGE);
 
     Program* pRampShader = loadShaderProgramWithDynamicOutput("rampShader", "ramp_vertex.glsl", "ramp_fragment.glsl",
-        ShaderUniform::P_MATRIX
-      | ShaderUniform::V_MATRIX
-      | ShaderUniform::M_MATRIX);
-    pRampShader->addUniform("time");
+        ShaderUniform::DRAW_DATA);
+    addProgramMetadata(pRampShader, ProgramMetadata::USES_DRAW_DATA);
 
     // Container assets.
     loadShaderProgramWithDynamicOutput("containerShader", "container_vertex.glsl", "container_fragment.glsl",
-        ShaderUniform::P_MATRIX
-      | ShaderUniform::V_MATRIX
-      | ShaderUniform::M_MATRIX
+        ShaderUniform::M_MATRIX
       | ShaderUniform::TEXTURE_0);
       //| ShaderUniform::TEXTURE_2);
     pAssets->loadTexture("containerTexture", "container_color_texture.png", TextureType::IMAGE);
@@ -66,39 +74,46 @@ void LightRiderScene::loadAssets()
 
     // Sky assets.
     pAssets->loadShaderProgram("skyShader", "sky_vertex.glsl", "sky_fragment.glsl",
-        ShaderUniform::P_MATRIX
-      | ShaderUniform::V_MATRIX
-      | ShaderUniform::M_MATRIX
+        ShaderUniform::M_MATRIX
       | ShaderUniform::TEXTURE_3
+      | ShaderUniform::VIEW_UNIFORMS
     );
     pAssets->loadTexture("skyTexture", "sky.jpg", TextureType::BACKGROUND);
 
     // Miscellaneous assets.
     Program* pShadowShader = pAssets->loadShaderProgram("shadowShader", "shadow_vertex.glsl", "shadow_fragment.glsl",
-        ShaderUniform::P_MATRIX
-      | ShaderUniform::V_MATRIX
-      | ShaderUniform::M_MATRIX);
+        ShaderUniform::M_MATRIX | ShaderUniform::VIEW_UNIFORMS);
     pShadowShader->addAttribute("vertexPosition");
 
-    Program* pDeferredShader = pAssets->loadShaderProgram("deferredShader", "deferred_vertex.glsl", std::vector<std::string>{ "deferred_fragment.glsl", "materials.glsl" }, ShaderUniform::NONE);
+    Program* pInstancedShadowShader = pAssets->loadShaderProgram("instancedShadowShader", "instanced_shadow_vertex.glsl", "shadow_fragment.glsl",
+        ShaderUniform::M_MATRIX | ShaderUniform::VIEW_UNIFORMS);
+    pInstancedShadowShader->addAttribute("vertexPosition");
+    pInstancedShadowShader->addAttribute("instanceData");
+
+    // Depth-only program for shadow casters whose shader programs read per-draw data.
+    Program* pDrawDataShadowShader = pAssets->loadShaderProgram("drawDataShadowShader", "draw_data_shadow_vertex.glsl", "shadow_fragment.glsl",
+        ShaderUniform::VIEW_UNIFORMS | ShaderUniform::DRAW_DATA);
+    pDrawDataShadowShader->addAttribute("vertexPosition");
+    addProgramMetadata(pDrawDataShadowShader, ProgramMetadata::USES_DRAW_DATA);
+
+    Program* pDeferredShader = pAssets->loadShaderProgram("deferredShader", "deferred_vertex.glsl", std::vector<std::string>{ "deferred_fragment.glsl", "materials.glsl" }, ShaderUniform::VIEW_UNIFORMS);
     pDeferredShader->addUniform("gColor");
     pDeferredShader->addUniform("gPosition");
     pDeferredShader->addUniform("gNormal");
     pDeferredShader->addUniform("gMaterial");
     pDeferredShader->addUniform("shadowMap");
     pDeferredShader->addUniform("skyTexture");
-    pDeferredShader->addUniform("campos");
-    pDeferredShader->addUniform("lightPV");
 
     Program* pGiShader = pAssets->loadShaderProgram("giShader", "gi_vertex.glsl", "gi_fragment.glsl", ShaderUniform::NONE);
     pGiShader->addUniform("gPosition");
     pGiShader->addUniform("gNormal");
     pGiShader->addUniform("gMaterial");
     pGiShader->addUniform("noise");
-    pGiShader->addUniform("voxelMap");
+    pGiShader->addUniform("voxelMaps");
     pGiShader->addUniform("view");
     pGiShader->addUniform("focalLength");
     pGiShader->addUniform("voxelCenterPosition");
+    pGiShader->addUniform("voxelLevelMin");
 
     Program* pBlendedDeferredShader = pAssets->loadShaderProgram("blendedDeferredShader", "blended_deferred_vertex.glsl", "blended_deferred_fragment.glsl", ShaderUniform::NONE);
     pBlendedDeferredShader->addUniform("gColor");
@@ -132,6 +147,29 @@ void LightRiderScene::loadAssets()
     pLuminanceProgram->addBuffer("result", sizeof(glm::vec4));
     pLuminanceProgram->addUniform("colorImage");
 
+    ComputeProgram* pInstanceCullProgram = pAssets->loadComputeShaderProgram("instanceCullCompute", "instance_cull_compute.glsl");
+    pInstanceCullProgram->addUniform("frustumPlanes");
+    pInstanceCullProgram->addUniform("M");
+    pInstanceCullProgram->addUniform("boundsMin");
+    pInstanceCullProgram->addUniform("boundsMax");
+    pInstanceCullProgram->addUniform("instanceCount");
+    pInstanceCullProgram->addUniform("occlusionPhase");
+    pInstanceCullProgram->addUniform("pyramidPvMatrix");
+    pInstanceCullProgram->addUniform("pyramidSize");
+    pInstanceCullProgram->addUniform("pyramidMipCount");
+
+    ComputeProgram* pHiZDownsampleProgram = pAssets->loadComputeShaderProgram("hiZDownsampleCompute", "hiz_downsample_compute.glsl");
+    pHiZDownsampleProgram->addUniform("sourceLevel");
+
+    ComputeProgram* pOcclusionCullProgram = pAssets->loadComputeShaderProgram("occlusionCullCompute", "occlusion_cull_compute.glsl");
+    pOcclusionCullProgram->addUniform("boxCount");
+    pOcclusionCullProgram->addUniform("pyramidPvMatrix");
+    pOcclusionCullProgram->addUniform("pyramidSize");
+    pOcclusionCullProgram->addUniform("pyramidMipCount");
+
+    ComputeProgram* pDrawVisibilityProgram = pAssets->loadComputeShaderProgram("drawVisibilityCompute", "draw_visibility_compute.glsl");
+    pDrawVisibilityProgram->addUniform("commandCount");
+
     ComputeProgram* pVoxelClearProgram = pAssets->loadComputeShaderProgram("voxelClear", "voxel_clear.glsl");
     pVoxelClearProgram->addUniform("voxelMapR");
     pVoxelClearProgram->addUniform("voxelMapG");
@@ -143,11 +181,46 @@ void LightRiderScene::loadAssets()
     pVoxelCombineProgram->addUniform("voxelMapG");
     pVoxelCombineProgram->addUniform("voxelMapB");
     pVoxelCombineProgram->addUniform("voxelMapA");
+    pVoxelCombineProgram->addUniform("voxelMap");
+    pVoxelCombineProgram->addUniform("staticVoxelMap");
+
+    ComputeProgram* pVoxelStoreStaticProgram = pAssets->loadComputeShaderProgram("voxelStoreStatic", "voxel_store_static.glsl");
+    pVoxelStoreStaticProgram->addUniform("voxelMapR");
+    pVoxelStoreStaticProgram->addUniform("voxelMapG");
+    pVoxelStoreStaticProgram->addUniform("voxelMapB");
+    pVoxelStoreStaticProgram->addUniform("voxelMapA");
+    pVoxelStoreStaticProgram->addUniform("staticVoxelMap");
+    pVoxelStoreStaticProgram->addUniform("regionMin");
+
+    ComputeProgram* pVoxelClearPackedProgram = pAssets->loadComputeShaderProgram("voxelClearPacked", "voxel_clear_packed.glsl");
+    pVoxelClearPackedProgram->addUniform("voxelMapPacked");
+    pVoxelClearPackedProgram->addUniform("regionMin");
+    pVoxelClearPackedProgram->addUniform("dimension");
+
+    ComputeProgram* pVoxelCombinePackedProgram = pAssets->loadComputeShaderProgram("voxelCombinePacked", "voxel_combine_packed.glsl");
+    pVoxelCombinePackedProgram->addUniform("voxelMap");
+    pVoxelCombinePackedProgram->addUniform("staticVoxelMapPacked");
+    pVoxelCombinePackedProgram->addUniform("voxelMapPacked");
 
     ComputeProgram* pVoxelMipmapProgram = pAssets->loadComputeShaderProgram("voxelMipmap", "voxel_mipmap.glsl");
     pVoxelMipmapProgram->addUniform("inMip");
     pVoxelMipmapProgram->addUniform("outMip");
 
+    ComputeProgram* pVoxelCoverageProgram = pAssets->loadComputeShaderProgram("voxelCoverage", "voxel_coverage.glsl");
+    pVoxelCoverageProgram->addBuffer("result", sizeof(GLuint));
+    pVoxelCoverageProgram->addUniform("voxelMap");
+
+    // The trail noise volume is generated once here rather than evaluating 4D noise for every trail fragment.
+    Texture* pTrailNoiseTexture = pAssets->createVolumeTexture("trailNoiseTexture", GC::trailNoiseVolumeDimension, GL_R16F);
+    ComputeProgram* pTrailNoiseProgram = pAssets->loadComputeShaderProgram("trailNoiseCompute", "trail_noise_compute.glsl");
+    pTrailNoiseProgram->addUniform("noiseVolume");
+
+    pTrailNoiseProgram->bind();
+    glBindImageTexture(0, pTrailNoiseTexture->getTextureId(), 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_R16F);
+    glDispatchCompute((GC::trailNoiseVolumeDimension + 7) / 8, (GC::trailNoiseVolumeDimension + 3) / 4, (GC::trailNoiseVolumeDimension + 3) / 4);
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    pTrailNoiseProgram->unbind();
+
     pAssets->loadShape("sphereShape", "sphere.shape");
     pAssets->loadShape("planeShape", "plane.shape");
     pAssets->loadShape("rampShape", "ramp.shape");
@@ -157,23 +230,20 @@ void LightRiderScene::loadAssets()
 Program* LightRiderScene::loadShaderProgramWithDynamicOutput(const std::string& id, const std::string& vertexShaderFileName,
     const std::string& fragmentShaderFileName, ShaderUniform defaultUniforms)
 {
-    Program* pProgram = getAssetManager()->loadShaderProgram(id, vertexShaderFileName, { "output.glsl", "materials.glsl", fragmentShaderFileName}, defaultUniforms);
-    pProgram->addUniform("_outputMode");
-    pProgram->addUniform("_voxelCenterPosition");
-    pProgram->addUniform("_cameraPosition");
-    pProgram->addUniform("_lightPV");
+    // Every program gets a voxelization variant, so single-pass voxelization can be switched on and off at runtime.
+    Program* pProgram = getAssetManager()->loadShaderProgram(id, vertexShaderFileName, { "output.glsl", "materials.glsl", fragmentShaderFileName},
+        defaultUniforms | ShaderUniform::VIEW_UNIFORMS, "voxelize_geometry.glsl");
     pProgram->addUniform("_shadowMap");
     pProgram->addUniform("_skyTexture");
     pProgram->addUniform("_voxelMapR");
     pProgram->addUniform("_voxelMapG");
     pProgram->addUniform("_voxelMapB");
     pProgram->addUniform("_voxelMapA");
-    pProgram->setUserPointer((void*)ProgramMetadata::USES_DYNAMIC_OUTPUT);
+    pProgram->addUniform("_voxelMapPacked");
+    addProgramMetadata(pProgram, ProgramMetadata::USES_DYNAMIC_OUTPUT);
 
-    pProgram->bind();
-    glUniform1i(pProgram->getUniform("_shadowMap"), 4);
-    glUniform1i(pProgram->getUniform("_skyTexture"), 5);
-    pProgram->unbind();
+    setSamplerUnit(pProgram, "_shadowMap", 4);
+    setSamplerUnit(pProgram, "_skyTexture", 5);
 
     return pProgram;
 }
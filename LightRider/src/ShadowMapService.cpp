@@ -0,0 +1,432 @@
+#include "ShadowMapService.h"
+
+#include <algorithm>
+#include <iostream>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "Game.h"
+#include "GLSL.h"
+#include "ViewFrustum.h"
+#include "ProgramOutputMode.h"
+
+ShadowMapService::ShadowMapService() :
+    m_pShadowShader(nullptr),
+    m_frameBuffer(0),
+    m_depthTexture(0),
+    m_staticDepthTexture(0),
+    m_staticLayers(),
+    m_layerCount(0),
+    m_viewUniformBuffer(sizeof(ViewUniforms), MAX_VIEWS * SHADOW_CASCADE_COUNT),
+    m_views(),
+    m_cameraViews(),
+    m_hasReportedViewOverflow(false),
+    m_visibility(),
+    m_depthProgramCasters(),
+    m_detailedCasters(),
+    m_stats(),
+    m_statsFrameCount(0)
+{
+    m_pShadowShader = Game::getInstance().getScene()->getAssetManager()->getShaderProgram("shadowShader");
+
+    glGenTextures(1, &m_depthTexture);
+    glGenTextures(1, &m_staticDepthTexture);
+
+    GLState::bindTexture(GL_TEXTURE_2D_ARRAY, m_depthTexture);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+    glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, glm::value_ptr(glm::vec4(1.0f)));
+
+    // The static shadow map is only ever copied from, never sampled.
+    GLState::bindTexture(GL_TEXTURE_2D_ARRAY, m_staticDepthTexture);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    reserveLayers(SHADOW_CASCADE_COUNT);
+
+    glGenFramebuffers(1, &m_frameBuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_frameBuffer);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_depthTexture, 0, 0);
+
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+
+    GLenum frameBufferStatus = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+
+    if (frameBufferStatus != GL_FRAMEBUFFER_COMPLETE)
+        std::cerr << "Unable to create shadow map frame buffer: " << frameBufferStatus << std::endl;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+ShadowMapService::~ShadowMapService()
+{
+    glDeleteFramebuffers(1, &m_frameBuffer);
+    glDeleteTextures(1, &m_depthTexture);
+    glDeleteTextures(1, &m_staticDepthTexture);
+
+    GLState::invalidate();
+}
+
+void ShadowMapService::beginFrame()
+{
+    m_views.clear();
+    m_cameraViews.clear();
+}
+
+void ShadowMapService::addView(const Camera* pCamera)
+{
+    ShadowView view;
+    view.firstLayer = 0;
+
+    // Splits blend uniform and logarithmic spacing, so near cascades stay small without the far ones
+    // growing too large.
+    float shadowNear = pCamera->getNearPlane();
+    float shadowFar = glm::min(SHADOW_DISTANCE, pCamera->getFarPlane());
+    float sliceNear = shadowNear;
+
+    for (int i = 0; i < SHADOW_CASCADE_COUNT; i++)
+    {
+        float fraction = (float)(i + 1) / SHADOW_CASCADE_COUNT;
+        float uniformSplit = shadowNear + (shadowFar - shadowNear) * fraction;
+        float logarithmicSplit = shadowNear * glm::pow(shadowFar / shadowNear, fraction);
+        float sliceFar = glm::mix(uniformSplit, logarithmicSplit, SPLIT_LAMBDA);
+
+        fitCascade(pCamera, sliceNear, sliceFar, view.cascades[i]);
+        sliceNear = sliceFar;
+    }
+
+    int nearestView = -1;
+    float nearestOffset = 0.0f;
+
+    for (int i = 0; i < (int)m_views.size(); i++)
+    {
+        float offset = 0.0f;
+
+        for (int j = 0; j < SHADOW_CASCADE_COUNT; j++)
+        {
+            const ShadowCascade& cascade = view.cascades[j];
+            offset = glm::max(offset, glm::distance(m_views[i].cascades[j].center, cascade.center) / cascade.radius);
+        }
+
+        if (nearestView == -1 || offset < nearestOffset)
+        {
+            nearestView = i;
+            nearestOffset = offset;
+        }
+    }
+
+    // Cameras beyond the view limit share the nearest view, falling back to coarser cascades away from it.
+    if (nearestView != -1 && (nearestOffset < VIEW_MERGE_TOLERANCE || (int)m_views.size() == MAX_VIEWS))
+    {
+        if (nearestOffset >= VIEW_MERGE_TOLERANCE && !m_hasReportedViewOverflow)
+        {
+            std::cerr << "Shadow map view limit (" << (int)MAX_VIEWS << ") reached; extra cameras share the nearest view." << std::endl;
+            m_hasReportedViewOverflow = true;
+        }
+        m_cameraViews[pCamera] = nearestView;
+        return;
+    }
+
+    m_cameraViews[pCamera] = (int)m_views.size();
+    m_views.push_back(view);
+}
+
+void ShadowMapService::render()
+{
+    if (m_views.empty())
+        return;
+
+    reserveLayers((int)m_views.size() * SHADOW_CASCADE_COUNT);
+
+    GLSL::pushDebugGroup("Shadow map");
+
+    GLStateStats startStats = GLState::getCurrentStats();
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_frameBuffer);
+    glViewport(0, 0, CASCADE_SIZE, CASCADE_SIZE);
+
+    GLState::disable(GL_BLEND);
+    GLState::enable(GL_DEPTH_TEST);
+    GLState::depthMask(GL_TRUE);
+
+    for (int i = 0; i < (int)m_views.size(); i++)
+    {
+        ShadowView& view = m_views[i];
+        view.firstLayer = i * SHADOW_CASCADE_COUNT;
+
+        for (int j = 0; j < SHADOW_CASCADE_COUNT; j++)
+            renderCascade(view.cascades[j], view.firstLayer + j);
+    }
+
+    GLState::disable(GL_CULL_FACE);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    m_stats = GLState::getCurrentStats() - startStats;
+
+    const GameConfig& config = Game::getInstance().getConfig();
+
+    if (config.shadowStatsReportInterval > 0 && ++m_statsFrameCount >= config.shadowStatsReportInterval)
+    {
+        std::cout << "Shadow pass (" << (config.groupShadowCasters ? "grouped" : "ungrouped") << " casters, "
+            << m_views.size() << " views): ";
+        GLState::writeStats(std::cout, m_stats);
+        std::cout << std::endl;
+
+        m_statsFrameCount = 0;
+    }
+
+    GLSL::popDebugGroup();
+}
+
+const ShadowView* ShadowMapService::getView(const Camera* pCamera) const
+{
+    auto viewItr = m_cameraViews.find(pCamera);
+
+    if (viewItr == m_cameraViews.end())
+        return nullptr;
+
+    return &m_views[viewItr->second];
+}
+
+void ShadowMapService::reserveLayers(int layerCount)
+{
+    if (layerCount <= m_layerCount)
+        return;
+
+    m_layerCount = layerCount;
+
+    GLState::bindTexture(GL_TEXTURE_2D_ARRAY, m_depthTexture);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT32, CASCADE_SIZE, CASCADE_SIZE, m_layerCount, 0,
+        GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+
+    GLState::bindTexture(GL_TEXTURE_2D_ARRAY, m_staticDepthTexture);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT32, CASCADE_SIZE, CASCADE_SIZE, m_layerCount, 0,
+        GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+
+    m_staticLayers.assign(m_layerCount, StaticShadowLayer());
+
+    for (StaticShadowLayer& staticLayer : m_staticLayers)
+        staticLayer.isValid = false;
+}
+
+void ShadowMapService::fitCascade(const Camera* pCamera, float sliceNear, float sliceFar, ShadowCascade& cascade) const
+{
+    glm::mat4& cameraMatrix = pCamera->getGameObject()->getTransform()->getTransformMatrix();
+    glm::vec3 cameraPosition = glm::vec3(cameraMatrix[3]);
+    glm::vec3 cameraForward = -glm::normalize(glm::vec3(cameraMatrix[2]));
+
+    // The squared ratio between the frustum's half-diagonal and its depth, from the camera's latest projection.
+    const glm::mat4& perspectiveMatrix = pCamera->getPerspectiveMatrix();
+    float slopeSquared =
+        1.0f / (perspectiveMatrix[0][0] * perspectiveMatrix[0][0]) +
+        1.0f / (perspectiveMatrix[1][1] * perspectiveMatrix[1][1]);
+
+    // The smallest sphere around the slice sits on the view axis, equidistant from the near and far corners
+    // unless that would put it past the far plane. Its radius only depends on the projection, so it stays
+    // constant as the camera moves and turns.
+    float centerDepth = glm::min(sliceFar, 0.5f * (sliceNear + sliceFar) * (1.0f + slopeSquared));
+    float nearOffset = centerDepth - sliceNear;
+    float farOffset = sliceFar - centerDepth;
+
+    cascade.radius = glm::sqrt(glm::max(
+        nearOffset * nearOffset + sliceNear * sliceNear * slopeSquared,
+        farOffset * farOffset + sliceFar * sliceFar * slopeSquared));
+
+    // The cascade moves in steps of whole texels, which keeps shadow edges from shimmering and lets static
+    // casters stay cached until a step is taken. The sphere is padded so that it still covers the slice
+    // anywhere within a step of its snapped center.
+    float stepFraction = 2.0f * glm::sqrt(3.0f) * CASCADE_STEP_TEXELS / CASCADE_SIZE;
+    cascade.radius /= 1.0f - stepFraction;
+
+    glm::vec3 sunDirection = pCamera->getSunDirection();
+    glm::mat4 sunRotation = glm::lookAt(glm::vec3(0.0f), sunDirection, glm::vec3(0.0f, 1.0f, 0.0f));
+    float stepSize = 2.0f * cascade.radius / CASCADE_SIZE * CASCADE_STEP_TEXELS;
+
+    glm::vec3 sunSpaceCenter = glm::vec3(sunRotation * glm::vec4(cameraPosition + cameraForward * centerDepth, 1.0f));
+    sunSpaceCenter = glm::floor(sunSpaceCenter / stepSize) * stepSize;
+
+    cascade.center = glm::vec3(glm::inverse(sunRotation) * glm::vec4(sunSpaceCenter, 1.0f));
+
+    // The sun stays far enough back to catch casters outside the slice.
+    float sunDistance = pCamera->getSunDistance();
+    glm::vec3 sunPosition = cascade.center - sunDirection * sunDistance;
+
+    cascade.pMatrix = glm::ortho(-cascade.radius, cascade.radius, -cascade.radius, cascade.radius, 0.1f, sunDistance + cascade.radius);
+    cascade.vMatrix = glm::lookAt(sunPosition, cascade.center, glm::vec3(0.0f, 1.0f, 0.0f));
+    cascade.pvMatrix = cascade.pMatrix * cascade.vMatrix;
+}
+
+void ShadowMapService::renderCascade(const ShadowCascade& cascade, int layer)
+{
+    AssetManager* pAssets = Game::getInstance().getScene()->getAssetManager();
+    ViewFrustum frustum(cascade.pvMatrix);
+
+    pAssets->getCullingBounds().cull(frustum, m_visibility);
+    pAssets->cullInstances(frustum);
+
+    ViewUniforms viewUniforms;
+    viewUniforms.projectionMatrix = cascade.pMatrix;
+    viewUniforms.viewMatrix = cascade.vMatrix;
+    viewUniforms.outputMode = (GLint)ProgramOutputMode::STATIC;
+
+    m_viewUniformBuffer.update(&viewUniforms, layer);
+    m_viewUniformBuffer.bind(UniformBlockBinding::VIEW, layer);
+
+    StaticShadowLayer& staticLayer = m_staticLayers[layer];
+
+    if (!staticLayer.isValid || staticLayer.pvMatrix != cascade.pvMatrix || staticLayer.staticRevision != pAssets->getStaticRevision())
+    {
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_staticDepthTexture, 0, layer);
+        glClear(GL_DEPTH_BUFFER_BIT);
+
+        renderCasters(true);
+
+        staticLayer.isValid = true;
+        staticLayer.pvMatrix = cascade.pvMatrix;
+        staticLayer.staticRevision = pAssets->getStaticRevision();
+    }
+
+    glCopyImageSubData(
+        m_staticDepthTexture, GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer,
+        m_depthTexture, GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer,
+        CASCADE_SIZE, CASCADE_SIZE, 1);
+
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_depthTexture, 0, layer);
+
+    renderCasters(false);
+}
+
+void ShadowMapService::renderCasters(bool renderStatic)
+{
+    if (!Game::getInstance().getConfig().groupShadowCasters)
+    {
+        renderUngroupedCasters(renderStatic);
+        return;
+    }
+
+    m_depthProgramCasters.clear();
+    m_detailedCasters.clear();
+
+    // Most casters share the shadow shader and are drawn in a single run. The rest are gathered and drawn
+    // afterwards, grouped by program, so that each program is bound only once.
+    m_pShadowShader->bind();
+
+    for (const DrawItem& item : Game::getInstance().getScene()->getAssetManager()->getDrawList().getItems())
+    {
+        if (!(item.passes & DrawPass::SHADOW) || !item.pRenderable || item.pRenderable->isStatic() != renderStatic)
+            continue;
+
+        if (item.boundsSlot < m_visibility.size() && !m_visibility[item.boundsSlot])
+            continue;
+
+        if (item.passes & DrawPass::SHADOW_DETAILED)
+        {
+            if (item.pShaderProgram)
+                m_detailedCasters.push_back(&item);
+        }
+        else if (item.pDepthProgram)
+        {
+            m_depthProgramCasters.push_back(&item);
+        }
+        else
+        {
+            item.pRenderable->renderDepth(m_pShadowShader);
+        }
+    }
+
+    m_pShadowShader->unbind();
+
+    renderCasterGroup(m_depthProgramCasters, true);
+    renderCasterGroup(m_detailedCasters, false);
+}
+
+void ShadowMapService::renderUngroupedCasters(bool renderStatic)
+{
+    m_pShadowShader->bind();
+
+    // Casters sort by program, so the shadow shader is only swapped out around runs of detailed casters
+    // and casters with their own depth program.
+    Program* pShaderProgram = m_pShadowShader;
+
+    for (const DrawItem& item : Game::getInstance().getScene()->getAssetManager()->getDrawList().getItems())
+    {
+        if (!(item.passes & DrawPass::SHADOW) || !item.pRenderable || item.pRenderable->isStatic() != renderStatic)
+            continue;
+
+        if (item.boundsSlot < m_visibility.size() && !m_visibility[item.boundsSlot])
+            continue;
+
+        if ((item.passes & DrawPass::SHADOW_DETAILED) && !item.pShaderProgram)
+            continue;
+
+        if (item.passes & DrawPass::SHADOW_DETAILED)
+        {
+            if (pShaderProgram != item.pShaderProgram)
+            {
+                pShaderProgram->unbind();
+                pShaderProgram = item.pShaderProgram;
+                pShaderProgram->bind();
+            }
+
+            item.pRenderable->render();
+        }
+        else
+        {
+            Program* pDepthProgram = item.pDepthProgram ? item.pDepthProgram : m_pShadowShader;
+
+            if (pShaderProgram != pDepthProgram)
+            {
+                pShaderProgram->unbind();
+                pShaderProgram = pDepthProgram;
+                pShaderProgram->bind();
+            }
+
+            item.pRenderable->renderDepth(pDepthProgram);
+        }
+    }
+
+    pShaderProgram->unbind();
+}
+
+void ShadowMapService::renderCasterGroup(std::vector<const DrawItem*>& casters, bool useDepthPrograms)
+{
+    auto getProgram = [useDepthPrograms](const DrawItem* pItem)
+    {
+        return useDepthPrograms ? pItem->pDepthProgram : pItem->pShaderProgram;
+    };
+
+    // The draw list is already sorted by shader program, but not by depth program.
+    if (useDepthPrograms)
+    {
+        std::stable_sort(casters.begin(), casters.end(), [&getProgram](const DrawItem* pA, const DrawItem* pB)
+        {
+            return getProgram(pA) < getProgram(pB);
+        });
+    }
+
+    Program* pShaderProgram = nullptr;
+
+    for (const DrawItem* pItem : casters)
+    {
+        if (pShaderProgram != getProgram(pItem))
+        {
+            if (pShaderProgram)
+                pShaderProgram->unbind();
+
+            pShaderProgram = getProgram(pItem);
+            pShaderProgram->bind();
+        }
+
+        if (useDepthPrograms)
+            pItem->pRenderable->renderDepth(pShaderProgram);
+        else
+            pItem->pRenderable->render();
+    }
+
+    if (pShaderProgram)
+        pShaderProgram->unbind();
+}
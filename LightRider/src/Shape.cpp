@@ -1,7 +1,10 @@
 #include "Shape.h"
 #include <iostream>
+#include <algorithm>
+#include <limits>
 
 #include "GLSL.h"
+#include "GLState.h"
 #include "Program.h"
 #define TINYOBJLOADER_IMPLEMENTATION
 #include "tiny_obj_loader.h"
@@ -37,9 +40,7 @@ void Shape::loadMesh(const string &meshName, string *mtlpath, unsigned char *(lo
         eleBuf = new std::vector<unsigned int>[shapes.size()];
 
         eleBufID = new unsigned int[shapes.size()];
-        posBufID = new unsigned int[shapes.size()];
-        norBufID = new unsigned int[shapes.size()];
-        texBufID = new unsigned int[shapes.size()];
+        vertexBufID = new unsigned int[shapes.size()];
         vaoID = new unsigned int[shapes.size()];
         materialIDs = new unsigned int[shapes.size()];
 
@@ -77,8 +78,8 @@ void Shape::loadMesh(const string &meshName, string *mtlpath, unsigned char *(lo
 
             unsigned char* data = loadimage(filepath, &width, &height, &channels, 4);
             glGenTextures(1, &textureIDs[i]);
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, textureIDs[i]);
+            GLState::activeTexture(GL_TEXTURE0);
+            GLState::bindTexture(GL_TEXTURE_2D, textureIDs[i]);
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
@@ -157,186 +158,158 @@ void Shape::resize()
         }
 }
 
-void Shape::init()
+void Shape::init(GeometryArena* pArena)
 {
-    for (int i = 0; i < obj_count; i++)
-    {
-        // Initialize the vertex array object
-        glGenVertexArrays(1, &vaoID[i]);
-        glBindVertexArray(vaoID[i]);
-
-        // Send the position array to the GPU
-        glGenBuffers(1, &posBufID[i]);
-        glBindBuffer(GL_ARRAY_BUFFER, posBufID[i]);
-        glBufferData(GL_ARRAY_BUFFER, posBuf[i].size() * sizeof(float), posBuf[i].data(), GL_STATIC_DRAW);
+    geometryRanges.resize(obj_count);
 
-        // Send the normal array to the GPU
-        if (norBuf[i].empty())
-        {
-            norBufID[i] = 0;
-        }
-        else
-        {
-            glGenBuffers(1, &norBufID[i]);
-            glBindBuffer(GL_ARRAY_BUFFER, norBufID[i]);
-            glBufferData(GL_ARRAY_BUFFER, norBuf[i].size() * sizeof(float), norBuf[i].data(), GL_STATIC_DRAW);
-        }
+    // Record the local bounds of every object, used to cull the shape when it is drawn.
+    boundsMin = glm::vec3(std::numeric_limits<float>::max());
+    boundsMax = glm::vec3(-std::numeric_limits<float>::max());
 
-        // Send the texture array to the GPU
-        if (texBuf[i].empty())
-        {
-            texBufID[i] = 0;
-        }
-        else
+    for (int i = 0; i < obj_count; i++)
+        for (size_t v = 0; v < posBuf[i].size() / 3; v++)
         {
-            glGenBuffers(1, &texBufID[i]);
-            glBindBuffer(GL_ARRAY_BUFFER, texBufID[i]);
-            glBufferData(GL_ARRAY_BUFFER, texBuf[i].size() * sizeof(float), texBuf[i].data(), GL_STATIC_DRAW);
+            glm::vec3 position(posBuf[i][3 * v + 0], posBuf[i][3 * v + 1], posBuf[i][3 * v + 2]);
+            boundsMin = glm::min(boundsMin, position);
+            boundsMax = glm::max(boundsMax, position);
         }
 
-        // Send the element array to the GPU
-        glGenBuffers(1, &eleBufID[i]);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, eleBufID[i]);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, eleBuf[i].size() * sizeof(unsigned int), eleBuf[i].data(), GL_STATIC_DRAW);
-
-        // Unbind the arrays
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    // A shape is packed into the arena whole or not at all, since it is batched as a whole.
+    GLsizei totalVertexCount = 0;
+    GLsizei totalIndexCount = 0;
 
-        assert(glGetError() == GL_NO_ERROR);
+    for (int i = 0; i < obj_count; i++)
+    {
+        totalVertexCount += (GLsizei)(posBuf[i].size() / 3);
+        totalIndexCount += (GLsizei)eleBuf[i].size();
     }
-}
 
-void Shape::draw(const Program* prog) const
-{
+    inArena = pArena && pArena->hasRoom(totalVertexCount, totalIndexCount);
+
     for (int i = 0; i < obj_count; i++)
     {
-        int h_pos, h_nor, h_tex;
-        h_pos = h_nor = h_tex = -1;
-
-        glBindVertexArray(vaoID[i]);
-        // Bind position buffer
-        h_pos = prog->getAttribute("vertexPosition");
-        GLSL::enableVertexAttribArray(h_pos);
-        glBindBuffer(GL_ARRAY_BUFFER, posBufID[i]);
-        glVertexAttribPointer(h_pos, 3, GL_FLOAT, GL_FALSE, 0, (const void *)0);
-
-        // Bind normal buffer
-        h_nor = prog->getAttribute("vertexNormal");
-        if (h_nor != -1 && norBufID[i] != 0)
-        {
-            GLSL::enableVertexAttribArray(h_nor);
-            glBindBuffer(GL_ARRAY_BUFFER, norBufID[i]);
-            glVertexAttribPointer(h_nor, 3, GL_FLOAT, GL_FALSE, 0, (const void *)0);
-        }
+        size_t vertexCount = posBuf[i].size() / 3;
+        bool hasNormals = !norBuf[i].empty();
+        bool hasTexcoords = !texBuf[i].empty();
 
-        if (texBufID[i] != 0)
+        // Interleave the position, normal and texture coordinates of each vertex, using the arena's layout.
+        // Missing normals and texture coordinates are left as zero, matching a disabled attribute.
+        vector<float> vertexData(vertexCount * GeometryArena::VERTEX_COMPONENTS, 0.0f);
+
+        for (size_t v = 0; v < vertexCount; v++)
         {
-            // Bind texcoords buffer
-            h_tex = prog->getAttribute("vertexTexture");
-            if (h_tex != -1 && texBufID[i] != 0)
-            {
-                GLSL::enableVertexAttribArray(h_tex);
-                glBindBuffer(GL_ARRAY_BUFFER, texBufID[i]);
-                glVertexAttribPointer(h_tex, 2, GL_FLOAT, GL_FALSE, 0, (const void *)0);
-            }
-        }
+            float* pVertex = &vertexData[v * GeometryArena::VERTEX_COMPONENTS];
 
-        // Bind element buffer
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, eleBufID[i]);
+            std::copy(&posBuf[i][3 * v], &posBuf[i][3 * v] + 3, pVertex);
 
-        //texture
-        
-        // Commented out because we bind textures separately from shapes for optimization purposes.
+            if (hasNormals)
+                std::copy(&norBuf[i][3 * v], &norBuf[i][3 * v] + 3, pVertex + 3);
 
-        //int textureindex = materialIDs[i];
-        //if (textureindex >= 0)
-        //{
-        //	glActiveTexture(GL_TEXTURE0);
-        //	glBindTexture(GL_TEXTURE_2D, textureIDs[textureindex]);
-        //}
+            if (hasTexcoords)
+                std::copy(&texBuf[i][2 * v], &texBuf[i][2 * v] + 2, pVertex + 6);
+        }
+
+        GLuint vertexBuffer;
+        GLuint elementBuffer;
+        GeometryRange& range = geometryRanges[i];
 
-        // Draw
-        if (usesInstancing())
+        if (inArena)
         {
-            drawInstanced(i, prog);
+            // The room was checked for the whole shape above, so this can't fail.
+            pArena->allocate(vertexData.data(), (GLsizei)vertexCount, eleBuf[i].data(), (GLsizei)eleBuf[i].size(), range);
+
+            // The arena owns the buffers, so the shape doesn't create its own.
+            vertexBufID[i] = 0;
+            eleBufID[i] = 0;
+            vertexBuffer = pArena->getVertexBuffer();
+            elementBuffer = pArena->getElementBuffer();
         }
         else
         {
-            glDrawElements(GL_TRIANGLES, (int)eleBuf[i].size(), GL_UNSIGNED_INT, (const void *)0);
+            range.firstIndex = 0;
+            range.indexCount = (GLuint)eleBuf[i].size();
+            range.baseVertex = 0;
+
+            // Send the vertex data to the GPU
+            glGenBuffers(1, &vertexBufID[i]);
+            glBindBuffer(GL_ARRAY_BUFFER, vertexBufID[i]);
+            glBufferData(GL_ARRAY_BUFFER, vertexData.size() * sizeof(float), vertexData.data(), GL_STATIC_DRAW);
+
+            // Send the element array to the GPU
+            glGenBuffers(1, &eleBufID[i]);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, eleBufID[i]);
+            glBufferData(GL_COPY_WRITE_BUFFER, eleBuf[i].size() * sizeof(unsigned int), eleBuf[i].data(), GL_STATIC_DRAW);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+            vertexBuffer = vertexBufID[i];
+            elementBuffer = eleBufID[i];
         }
 
-        // Disable and unbind
-        if (h_tex != -1)
-        {
-            GLSL::disableVertexAttribArray(h_tex);
-        }
-        if (h_nor != -1)
-        {
-            GLSL::disableVertexAttribArray(h_nor);
-        }
-        GLSL::disableVertexAttribArray(h_pos);
+        // Initialize the vertex array object. Its layout is fixed from here on, so a draw only needs to bind it.
+        glGenVertexArrays(1, &vaoID[i]);
+        GLState::bindVertexArray(vaoID[i]);
+
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementBuffer);
+        glBindVertexBuffer(VERTEX_BINDING, vertexBuffer, (GLintptr)range.baseVertex * GeometryArena::VERTEX_SIZE, GeometryArena::VERTEX_SIZE);
+
+        glVertexAttribFormat(POSITION_LOCATION, 3, GL_FLOAT, GL_FALSE, 0);
+        glVertexAttribBinding(POSITION_LOCATION, VERTEX_BINDING);
+        glEnableVertexAttribArray(POSITION_LOCATION);
+
+        glVertexAttribFormat(NORMAL_LOCATION, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float));
+        glVertexAttribBinding(NORMAL_LOCATION, VERTEX_BINDING);
+        glEnableVertexAttribArray(NORMAL_LOCATION);
+
+        glVertexAttribFormat(TEXTURE_LOCATION, 2, GL_FLOAT, GL_FALSE, 6 * sizeof(float));
+        glVertexAttribBinding(TEXTURE_LOCATION, VERTEX_BINDING);
+        glEnableVertexAttribArray(TEXTURE_LOCATION);
+
+        // Unbind the vertex array before the buffers so the element buffer stays attached to it
+        GLState::bindVertexArray(0);
         glBindBuffer(GL_ARRAY_BUFFER, 0);
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+        assert(glGetError() == GL_NO_ERROR);
     }
 }
 
-void Shape::drawInstanced(int shapeId, const Program* prog) const
+void Shape::draw(const Program* prog) const
 {
-    if (instancedPrograms.find(prog->getPid()) == instancedPrograms.end())
+    for (int i = 0; i < obj_count; i++)
     {
-        GLuint pid = prog->getPid();
-        GLint instanceDataLocation = glGetAttribLocation(pid, "instanceData");
-
-        if (instanceDataLocation < 0)
-        {
-            std::cerr << "Missing 'instanceData' attribute." << std::endl;
-            return;
-        }
-
-        glBindBuffer(GL_ARRAY_BUFFER, instanceBufID[shapeId]);
-        glVertexAttribPointer(
-            instanceDataLocation,
-            instanceElementComponentCount,
-            instanceElementType,
-            GL_FALSE,
-            instanceElementSize,
-            nullptr);
-
-        glEnableVertexAttribArray(instanceDataLocation);
-        glVertexAttribDivisor(instanceDataLocation, 1);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-        glGetError();
-
-        instancedPrograms.insert(pid);
+        // Textures are bound separately from shapes for optimization purposes, so materialIDs are ignored here.
+        drawObject(i);
     }
-
-    glDrawElementsInstanced(GL_TRIANGLES, (int)eleBuf[shapeId].size(), GL_UNSIGNED_INT, nullptr, instanceCount);
 }
 
 void Shape::drawDepth(const Program* prog) const
 {
+    // Depth programs read the same instance attribute, so instanced shapes are drawn just like in draw().
     for (int i = 0; i < obj_count; i++)
     {
-        int h_pos;
-        h_pos = -1;
-
-        glBindVertexArray(vaoID[i]);
-        // Bind position buffer
-        h_pos = prog->getAttribute("vertexPosition");
-        GLSL::enableVertexAttribArray(h_pos);
-        glBindBuffer(GL_ARRAY_BUFFER, posBufID[i]);
-        glVertexAttribPointer(h_pos, 3, GL_FLOAT, GL_FALSE, 0, (const void*)0);
+        drawObject(i);
+    }
+}
 
-        // Bind element buffer
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, eleBufID[i]);
+void Shape::drawObject(int i) const
+{
+    GLState::bindVertexArray(vaoID[i]);
 
-        // Draw
-        glDrawElements(GL_TRIANGLES, (int)eleBuf[i].size(), GL_UNSIGNED_INT, (const void*)0);
+    const GeometryRange& range = geometryRanges[i];
+    const void* indices = (const void*)(range.firstIndex * sizeof(unsigned int));
 
-        GLSL::disableVertexAttribArray(h_pos);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    if (usesInstancing() && indirectBufID)
+    {
+        // Each command is a DrawElementsIndirectCommand of five 32-bit values.
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBufID);
+        glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (const void*)(i * 5 * sizeof(GLuint)));
+    }
+    else if (usesInstancing())
+    {
+        glDrawElementsInstanced(GL_TRIANGLES, (GLsizei)range.indexCount, GL_UNSIGNED_INT, indices, (GLsizei)instanceCount);
+    }
+    else
+    {
+        glDrawElements(GL_TRIANGLES, (GLsizei)range.indexCount, GL_UNSIGNED_INT, indices);
     }
 }
@@ -0,0 +1,134 @@
+#include "Tests/DrawBenchmarkScene.h"
+
+#include <iostream>
+#include <cmath>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "Game.h"
+#include "GLState.h"
+#include "Shape.h"
+#include "Program.h"
+#include "UniformId.h"
+
+DrawBenchmarkScene::DrawBenchmarkScene(int drawCount, int reportInterval) :
+    m_drawCount(drawCount),
+    m_reportInterval(reportInterval),
+    m_frameCount(0),
+    m_cpuTime(0.0),
+    m_gpuTime(0.0),
+    m_gpuTimedFrameCount(0),
+    m_timerQueries(),
+    m_currentQuery(0),
+    m_hasPreviousQuery(false),
+    m_viewUniformBuffer(sizeof(ViewUniforms))
+{
+}
+
+DrawBenchmarkScene::~DrawBenchmarkScene()
+{
+    glDeleteQueries(2, m_timerQueries);
+}
+
+void DrawBenchmarkScene::initialize()
+{
+    LightRiderScene::initialize();
+
+    loadAssets();
+
+    glGenQueries(2, m_timerQueries);
+
+    std::cout << "Draw benchmark: " << m_drawCount << " draws per frame." << std::endl;
+}
+
+void DrawBenchmarkScene::render()
+{
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    Game& game = Game::getInstance();
+    int width = game.getWindowWidth();
+    int height = game.getWindowHeight();
+
+    if (width == 0 || height == 0)
+        return;
+
+    glViewport(0, 0, width, height);
+    GLState::enable(GL_DEPTH_TEST);
+
+    int gridSize = (int)std::ceil(std::sqrt((float)m_drawCount));
+
+    ViewUniforms viewUniforms;
+    viewUniforms.projectionMatrix = glm::perspective(glm::radians(60.0f), (float)width / height, 0.1f, gridSize * 4.0f);
+    viewUniforms.viewMatrix = glm::lookAt(glm::vec3(0.0f, gridSize * 1.5f, gridSize * 1.5f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    viewUniforms.outputMode = 0;
+
+    m_viewUniformBuffer.update(&viewUniforms);
+    m_viewUniformBuffer.bind(UniformBlockBinding::VIEW);
+
+    AssetManager* pAssets = getAssetManager();
+    Program* pProgram = pAssets->getShaderProgram("shadowShader");
+    Shape* pShape = pAssets->getShape("sphereShape");
+    GLint modelLocation = pProgram->getUniform(UniformId::M);
+
+    glBeginQuery(GL_TIME_ELAPSED, m_timerQueries[m_currentQuery]);
+
+    Clock::time_point startTime = Clock::now();
+
+    pProgram->bind();
+
+    for (int i = 0; i < m_drawCount; i++)
+    {
+        glm::vec3 position(i % gridSize - gridSize * 0.5f, 0.0f, i / gridSize - gridSize * 0.5f);
+        glm::mat4 modelMatrix = glm::translate(glm::mat4(1.0f), position * 2.0f);
+
+        glUniformMatrix4fv(modelLocation, 1, GL_FALSE, glm::value_ptr(modelMatrix));
+        pShape->draw(pProgram);
+    }
+
+    pProgram->unbind();
+
+    Clock::time_point endTime = Clock::now();
+
+    glEndQuery(GL_TIME_ELAPSED);
+
+    m_cpuTime += std::chrono::duration<double, std::milli>(endTime - startTime).count();
+
+    // Read the previous frame's query, which has had a full frame to complete.
+    m_currentQuery = 1 - m_currentQuery;
+
+    GLint isAvailable = GL_FALSE;
+
+    if (m_hasPreviousQuery)
+        glGetQueryObjectiv(m_timerQueries[m_currentQuery], GL_QUERY_RESULT_AVAILABLE, &isAvailable);
+
+    m_hasPreviousQuery = true;
+
+    if (isAvailable)
+    {
+        GLuint64 elapsedTime = 0;
+        glGetQueryObjectui64v(m_timerQueries[m_currentQuery], GL_QUERY_RESULT, &elapsedTime);
+        m_gpuTime += elapsedTime / 1000000.0;
+        m_gpuTimedFrameCount++;
+    }
+
+    if (++m_frameCount < m_reportInterval)
+        return;
+
+    std::cout << "Draw benchmark: cpu " << m_cpuTime / m_frameCount << "ms gpu ";
+
+    // Only frames whose query was read count towards the GPU average.
+    if (m_gpuTimedFrameCount > 0)
+        std::cout << m_gpuTime / m_gpuTimedFrameCount << "ms";
+    else
+        std::cout << "n/a";
+
+    std::cout << " per frame | cpu " << m_cpuTime * 1000000.0 / ((double)m_frameCount * m_drawCount)
+        << "ns per draw | ";
+    GLState::writeStats(std::cout, GLState::getFrameStats());
+    std::cout << std::endl;
+
+    m_frameCount = 0;
+    m_cpuTime = 0.0;
+    m_gpuTime = 0.0;
+    m_gpuTimedFrameCount = 0;
+}
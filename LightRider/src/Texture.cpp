@@ -2,6 +2,8 @@
 
 #include "stb_image.h"
 
+#include "GLState.h"
+
 void Texture::init(std::string fileName, TextureType textureType)
 {
     m_textureType = textureType;
@@ -10,8 +12,8 @@ void Texture::init(std::string fileName, TextureType textureType)
     unsigned char* pData = stbi_load(fileName.c_str(), &m_width, &m_height, &channels, 4);
 
     glGenTextures(1, &m_textureId);
-    glActiveTexture((GLenum)textureType);
-    glBindTexture(GL_TEXTURE_2D, m_textureId);
+    GLState::activeTexture((GLenum)textureType);
+    GLState::bindTexture(GL_TEXTURE_2D, m_textureId);
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
@@ -20,3 +22,23 @@ void Texture::init(std::string fileName, TextureType textureType)
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, m_width, m_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pData);
     glGenerateMipmap(GL_TEXTURE_2D);
 }
+
+void Texture::initVolume(int dimension, GLenum internalFormat)
+{
+    m_target = GL_TEXTURE_3D;
+    m_width = dimension;
+    m_height = dimension;
+    m_depth = dimension;
+
+    glGenTextures(1, &m_textureId);
+    GLState::bindTexture(GL_TEXTURE_3D, m_textureId);
+
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexStorage3D(GL_TEXTURE_3D, 1, internalFormat, dimension, dimension, dimension);
+
+    GLState::bindTexture(GL_TEXTURE_3D, 0);
+}
@@ -0,0 +1,34 @@
+#include "UniformBuffer.h"
+
+UniformBuffer::UniformBuffer(GLsizeiptr size, int slotCount) :
+    m_buffer(0),
+    m_size(size),
+    m_slotStride(size)
+{
+    GLint offsetAlignment;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &offsetAlignment);
+
+    m_slotStride = (size + offsetAlignment - 1) / offsetAlignment * offsetAlignment;
+
+    glGenBuffers(1, &m_buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+    glBufferData(GL_UNIFORM_BUFFER, m_slotStride * slotCount, nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+UniformBuffer::~UniformBuffer()
+{
+    glDeleteBuffers(1, &m_buffer);
+}
+
+void UniformBuffer::update(const void* pData, int slot)
+{
+    glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, m_slotStride * slot, m_size, pData);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void UniformBuffer::bind(UniformBlockBinding binding, int slot) const
+{
+    glBindBufferRange(GL_UNIFORM_BUFFER, (GLuint)binding, m_buffer, m_slotStride * slot, m_size);
+}
@@ -0,0 +1,137 @@
+#include "ViewFrustum.h"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define VIEW_FRUSTUM_USE_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace
+{
+    // A coordinate far enough out to act as infinity without overflowing when multiplied by a plane normal.
+    constexpr float EMPTY_BOX_EXTENT = 1e30f;
+}
+
+void AabbList::resize(size_t newCount)
+{
+    size_t paddedCount = (newCount + 3) & ~(size_t)3;
+
+    minX.resize(paddedCount, EMPTY_BOX_EXTENT);
+    minY.resize(paddedCount, EMPTY_BOX_EXTENT);
+    minZ.resize(paddedCount, EMPTY_BOX_EXTENT);
+    maxX.resize(paddedCount, -EMPTY_BOX_EXTENT);
+    maxY.resize(paddedCount, -EMPTY_BOX_EXTENT);
+    maxZ.resize(paddedCount, -EMPTY_BOX_EXTENT);
+
+    for (size_t i = newCount; i < count; i++)
+        setEmpty(i);
+
+    count = newCount;
+}
+
+void AabbList::set(size_t index, const glm::vec3& min, const glm::vec3& max)
+{
+    minX[index] = min.x;
+    minY[index] = min.y;
+    minZ[index] = min.z;
+    maxX[index] = max.x;
+    maxY[index] = max.y;
+    maxZ[index] = max.z;
+}
+
+void AabbList::setEmpty(size_t index)
+{
+    set(index, glm::vec3(EMPTY_BOX_EXTENT), glm::vec3(-EMPTY_BOX_EXTENT));
+}
+
+ViewFrustum::ViewFrustum()
+{
+    for (glm::vec4& plane : m_planes)
+        plane = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+ViewFrustum::ViewFrustum(const glm::mat4& pvMatrix)
+{
+    // Planes are extracted from the rows of the clip matrix (Gribb & Hartmann).
+    glm::vec4 row0(pvMatrix[0][0], pvMatrix[1][0], pvMatrix[2][0], pvMatrix[3][0]);
+    glm::vec4 row1(pvMatrix[0][1], pvMatrix[1][1], pvMatrix[2][1], pvMatrix[3][1]);
+    glm::vec4 row2(pvMatrix[0][2], pvMatrix[1][2], pvMatrix[2][2], pvMatrix[3][2]);
+    glm::vec4 row3(pvMatrix[0][3], pvMatrix[1][3], pvMatrix[2][3], pvMatrix[3][3]);
+
+    m_planes[0] = row3 + row0;
+    m_planes[1] = row3 - row0;
+    m_planes[2] = row3 + row1;
+    m_planes[3] = row3 - row1;
+    m_planes[4] = row3 + row2;
+    m_planes[5] = row3 - row2;
+}
+
+ViewFrustum::ViewFrustum(const glm::vec3& min, const glm::vec3& max)
+{
+    m_planes[0] = glm::vec4(1.0f, 0.0f, 0.0f, -min.x);
+    m_planes[1] = glm::vec4(-1.0f, 0.0f, 0.0f, max.x);
+    m_planes[2] = glm::vec4(0.0f, 1.0f, 0.0f, -min.y);
+    m_planes[3] = glm::vec4(0.0f, -1.0f, 0.0f, max.y);
+    m_planes[4] = glm::vec4(0.0f, 0.0f, 1.0f, -min.z);
+    m_planes[5] = glm::vec4(0.0f, 0.0f, -1.0f, max.z);
+}
+
+bool ViewFrustum::intersectsAabb(const glm::vec3& min, const glm::vec3& max) const
+{
+    for (const glm::vec4& plane : m_planes)
+    {
+        // Test the corner of the box furthest along the plane normal.
+        glm::vec3 corner(
+            plane.x >= 0.0f ? max.x : min.x,
+            plane.y >= 0.0f ? max.y : min.y,
+            plane.z >= 0.0f ? max.z : min.z);
+
+        if (plane.x * corner.x + plane.y * corner.y + plane.z * corner.z + plane.w < 0.0f)
+            return false;
+    }
+
+    return true;
+}
+
+void ViewFrustum::intersectAabbs(const AabbList& boxes, std::vector<uint8_t>& results) const
+{
+    size_t paddedCount = boxes.minX.size();
+
+    results.resize(paddedCount);
+
+#ifdef VIEW_FRUSTUM_USE_SSE
+    const __m128 zero = _mm_setzero_ps();
+
+    for (size_t i = 0; i < paddedCount; i += 4)
+    {
+        __m128 inside = _mm_cmpeq_ps(zero, zero);
+
+        for (const glm::vec4& plane : m_planes)
+        {
+            // The furthest corner along the normal is the same for every box, so it is selected per plane.
+            __m128 cornerX = _mm_loadu_ps(plane.x >= 0.0f ? &boxes.maxX[i] : &boxes.minX[i]);
+            __m128 cornerY = _mm_loadu_ps(plane.y >= 0.0f ? &boxes.maxY[i] : &boxes.minY[i]);
+            __m128 cornerZ = _mm_loadu_ps(plane.z >= 0.0f ? &boxes.maxZ[i] : &boxes.minZ[i]);
+
+            __m128 distance = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.x), cornerX), _mm_mul_ps(_mm_set1_ps(plane.y), cornerY)),
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.z), cornerZ), _mm_set1_ps(plane.w)));
+
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, zero));
+        }
+
+        int mask = _mm_movemask_ps(inside);
+
+        results[i + 0] = (uint8_t)(mask & 1);
+        results[i + 1] = (uint8_t)((mask >> 1) & 1);
+        results[i + 2] = (uint8_t)((mask >> 2) & 1);
+        results[i + 3] = (uint8_t)((mask >> 3) & 1);
+    }
+#else
+    for (size_t i = 0; i < paddedCount; i++)
+    {
+        results[i] = intersectsAabb(
+            glm::vec3(boxes.minX[i], boxes.minY[i], boxes.minZ[i]),
+            glm::vec3(boxes.maxX[i], boxes.maxY[i], boxes.maxZ[i])) ? 1 : 0;
+    }
+#endif
+}
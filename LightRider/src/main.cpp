@@ -5,6 +5,7 @@
 #include "Scenes/GameScene.h"
 #include "Scenes/MenuScene.h"
 #include "Tests/TestScene.h"
+#include "Tests/DrawBenchmarkScene.h"
 
 // IDEA for blending with mulitple platforms:
 // We would add a few stages in the rendering pipeline:
@@ -31,6 +32,19 @@ int main(int argc, char** argv)
     config.windowTitle = "LightRider";
     config.physicsTickInterval = 1.0f / 60.0f;
     config.maxPhysicsSubSteps = 10;
+    config.physicsStatsLogSize = 600;
+    config.physicsSpikeThreshold = 8.0f;
+    config.shadowStatsReportInterval = 0;
+    config.groupShadowCasters = true;
+#ifndef DISABLE_OPENGL_ERROR_CHECKS
+    // Debug output needs a debug context, which Release builds go without.
+    config.glDebugOutput = true;
+    config.glDebugOutputSynchronous = false;
+#endif
+    config.singlePassVoxelization = true;
+    config.voxelTimingReportInterval = 0;
+    config.compareVoxelModes = false;
+    config.packedVoxelStorage = true;
     config.resourceDirectory = "../LightRider/resources/";
 
     // Initialize and run the game.
@@ -39,6 +53,7 @@ int main(int argc, char** argv)
     game.run(new MenuScene());
     //game.run(new GameScene());
     //game.run(new TestScene());
+    //game.run(new DrawBenchmarkScene());
 
     return 0;
 }